@@ -0,0 +1,152 @@
+#include <cstdio>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+#include <benchmark/benchmark.h>
+
+#include "OrderBook.hxx"
+#include "CommandProcessor.hxx"
+#include "OutputSink.hxx"
+#include "OrderFlow.hxx"
+
+using namespace trading;
+
+namespace
+{
+    const std::size_t FLOW_SIZE = 100000;
+}
+
+// text commands through CommandProcessor::handle, from parsing to the buffered response, on a synthetic
+// flow built up to the given depth and orders per level, with the given percentage of cancels
+template <typename Book>
+static void BM_ReplayCommands(benchmark::State& state)
+{
+    FlowConfig config;
+    config.levels = state.range(0);
+    config.ordersPerLevel = state.range(1);
+    config.cancelPercent = state.range(2);
+    OrderFlow flow(config);
+    std::vector<std::string> commands;
+    flow.generate(FLOW_SIZE, commands);
+
+    // the responses are formatted and buffered, but go nowhere
+    std::ostream nowhere(nullptr);
+    OutputSink out(nowhere);
+    for (auto _: state)
+    {
+        state.PauseTiming();
+        Book book(OrderFlow::TICK_SIZE);
+        BasicCommandProcessor<Book> processor(book, out);
+        for (const auto& command: flow.setup())
+        {
+            processor.handle(command);
+        }
+        state.ResumeTiming();
+
+        for (const auto& command: commands)
+        {
+            processor.handle(command);
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * commands.size());
+}
+BENCHMARK_TEMPLATE(BM_ReplayCommands, OrderBook)->ArgsProduct({ { 10, 100 }, { 1, 10 }, { 10, 50 } })
+    ->Unit(benchmark::kMillisecond);
+BENCHMARK_TEMPLATE(BM_ReplayCommands, LadderOrderBook)->ArgsProduct({ { 10, 100 }, { 1, 10 }, { 10, 50 } })
+    ->Unit(benchmark::kMillisecond);
+
+// Bursts of 1000 quote replacements, each a cancel of a random resting quote and a new one on a random level of
+// the same side, on a book of 100 levels a side with the given orders per level. The burst goes as text through
+// CommandProcessor::handle (0), as single try* calls on the book (1) or as one BasicOrderBook::apply (2).
+template <typename Book>
+static void BM_QuoteReplaceBurst(benchmark::State& state)
+{
+    const int LEVELS = 100;
+    const int MID = OrderFlow::MID_TICKS;
+    const std::size_t BURST = 1000;
+    const auto mode = state.range(1);
+
+    Book book(OrderFlow::TICK_SIZE);
+    book.reserve(2 * LEVELS * state.range(0) + BURST);
+    // the resting quotes
+    std::vector<std::pair<int, Side>> quotes;
+    int id = 0;
+    for (const auto side: { Side::Buy, Side::Sell })
+    {
+        for (int level = 1; level <= LEVELS; ++level)
+        {
+            for (int i = 0; i < state.range(0); ++i)
+            {
+                book.add(LimitOrder { ++id, side, side == Side::Buy ? MID - level : MID + level, 10, 0 });
+                quotes.emplace_back(id, side);
+            }
+        }
+    }
+
+    std::ostream nowhere(nullptr);
+    OutputSink out(nowhere);
+    BasicCommandProcessor<Book> processor(book, out);
+    std::mt19937 random(42);
+    std::vector<BatchCommand> burst(BURST);
+    std::vector<BatchResult> results(BURST);
+    std::vector<std::string> text(BURST);
+    FillBuffer fills(16);
+    const auto ignore = [](void*, const Fill&) {};
+    for (auto _: state)
+    {
+        state.PauseTiming();
+        for (std::size_t i = 0; i < BURST; i += 2)
+        {
+            auto& quote = quotes[random() % quotes.size()];
+            const auto side = quote.second;
+            const auto level = 1 + static_cast<int>(random() % LEVELS);
+            const auto price = side == Side::Buy ? MID - level : MID + level;
+            burst[i] = BatchCommand { BatchOp::Cancel, side, quote.first, 0, 0 };
+            burst[i + 1] = BatchCommand { BatchOp::Add, side, ++id, price, 10 };
+            quote.first = id;
+            if (mode == 0)
+            {
+                char line[64];
+                std::snprintf(line, sizeof(line), "cancel %d", burst[i].id);
+                text[i] = line;
+                // a tick is 0.05
+                std::snprintf(line, sizeof(line), "order %d %s 10 %d.%02d", id, side == Side::Buy ? "buy" : "sell",
+                    price / 20, price % 20 * 5);
+                text[i + 1] = line;
+            }
+        }
+        state.ResumeTiming();
+
+        switch (mode)
+        {
+            case 0:
+                for (const auto& command: text)
+                {
+                    processor.handle(command);
+                }
+                break;
+
+            case 1:
+                for (const auto& command: burst)
+                {
+                    if (command.op == BatchOp::Cancel)
+                    {
+                        book.tryCancel(command.id);
+                    }
+                    else
+                    {
+                        book.tryAdd(LimitOrder { command.id, command.side, command.price, command.quantity, 0 },
+                            ignore, nullptr);
+                    }
+                }
+                break;
+
+            default:
+                book.apply(burst.data(), burst.size(), results.data(), fills);
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * BURST);
+}
+BENCHMARK_TEMPLATE(BM_QuoteReplaceBurst, OrderBook)->ArgsProduct({ { 10, 1000 }, { 0, 1, 2 } });
+BENCHMARK_TEMPLATE(BM_QuoteReplaceBurst, LadderOrderBook)->ArgsProduct({ { 10, 1000 }, { 0, 1, 2 } });
@@ -0,0 +1,93 @@
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+#include <benchmark/benchmark.h>
+
+#include "Engine.hxx"
+#include "OrderFlow.hxx"
+
+using namespace trading;
+
+namespace
+{
+    const int SYMBOLS = 64;
+    const std::size_t FLOW_SIZE = 4000;
+
+    // every symbol gets its own seeded flow, the commands are dealt out a symbol at a time
+    struct MultiSymbolFlow
+    {
+        std::vector<std::string> setup;
+        std::vector<std::string> commands;
+
+        MultiSymbolFlow()
+        {
+            std::vector<std::vector<std::string>> flows(SYMBOLS);
+            for (int symbol = 0; symbol < SYMBOLS; ++symbol)
+            {
+                const auto name = "S" + std::to_string(symbol);
+                setup.push_back("symbol " + name + " 0.05");
+
+                FlowConfig config;
+                config.seed = symbol + 1;
+                OrderFlow flow(config);
+                for (const auto& command: flow.setup())
+                {
+                    setup.push_back(name + " " + command);
+                }
+                flow.generate(FLOW_SIZE, flows[symbol]);
+                for (auto& command: flows[symbol])
+                {
+                    command = name + " " + command;
+                }
+            }
+            for (std::size_t i = 0; i < FLOW_SIZE; ++i)
+            {
+                for (const auto& flow: flows)
+                {
+                    commands.push_back(flow[i]);
+                }
+            }
+        }
+    };
+}
+
+// the same 64 symbol replay over a growing number of shards, from the dispatcher's handle() until every
+// shard is done; items per second should grow with the shards, as long as there are cores for them
+template <typename Book>
+static void BM_MultiSymbolReplay(benchmark::State& state)
+{
+    static const MultiSymbolFlow flow;
+
+    std::ostream nowhere(nullptr);
+    EngineConfig config;
+    config.shards = state.range(0);
+    config.pinThreads = true;
+    for (auto _: state)
+    {
+        state.PauseTiming();
+        std::unique_ptr<BasicEngine<Book>> engine(new BasicEngine<Book>(nowhere, config));
+        for (const auto& command: flow.setup)
+        {
+            engine->handle(command);
+        }
+        engine->drain();
+        state.ResumeTiming();
+
+        for (const auto& command: flow.commands)
+        {
+            engine->handle(command);
+        }
+        engine->drain();
+
+        // stopping the threads isn't part of it
+        state.PauseTiming();
+        engine.reset();
+        state.ResumeTiming();
+    }
+    state.SetItemsProcessed(state.iterations() * flow.commands.size());
+}
+BENCHMARK_TEMPLATE(BM_MultiSymbolReplay, OrderBook)->RangeMultiplier(2)->Range(1, 8)
+    ->Unit(benchmark::kMillisecond)->UseRealTime();
+BENCHMARK_TEMPLATE(BM_MultiSymbolReplay, LadderOrderBook)->RangeMultiplier(2)->Range(1, 8)
+    ->Unit(benchmark::kMillisecond)->UseRealTime();
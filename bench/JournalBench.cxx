@@ -0,0 +1,179 @@
+#include <cstdio>
+#include <filesystem>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+#include <benchmark/benchmark.h>
+
+#include "OrderBook.hxx"
+#include "CommandProcessor.hxx"
+#include "Journal.hxx"
+#include "Snapshot.hxx"
+#include "OutputSink.hxx"
+#include "OrderFlow.hxx"
+
+using namespace trading;
+
+namespace
+{
+    const std::size_t FLOW_SIZE = 100000;
+    // commands per group commit, like a block of input
+    const std::size_t BATCH = 64;
+
+    std::string journalPath(const char* name)
+    {
+        const auto path = (std::filesystem::temp_directory_path() / name).string();
+        std::remove(path.c_str());
+        return path;
+    }
+
+    std::vector<std::string> makeFlow(std::vector<std::string>& setup)
+    {
+        FlowConfig config;
+        config.levels = 100;
+        config.ordersPerLevel = 10;
+        OrderFlow flow(config);
+        std::vector<std::string> commands;
+        flow.generate(FLOW_SIZE, commands);
+        setup = flow.setup();
+        return commands;
+    }
+}
+
+// the synthetic flow through CommandProcessor without a journal (-1), or journaled with the durability given,
+// committing every BATCH commands: the cost of journaling on the matching thread
+static void BM_JournaledCommands(benchmark::State& state)
+{
+    std::vector<std::string> setup;
+    const auto commands = makeFlow(setup);
+    const auto path = journalPath("journal_bench_commands.journal");
+    std::ostream nowhere(nullptr);
+    OutputSink out(nowhere);
+
+    for (auto _: state)
+    {
+        state.PauseTiming();
+        OrderBook book(OrderFlow::TICK_SIZE);
+        CommandProcessor processor(book, out);
+        std::unique_ptr<Journal> journal;
+        if (state.range(0) >= 0)
+        {
+            std::remove(path.c_str());
+            JournalConfig config;
+            config.durability = static_cast<Durability>(state.range(0));
+            journal.reset(new Journal(path, book.getScale(), config));
+            processor.setJournal(journal.get());
+        }
+        for (const auto& command: setup)
+        {
+            processor.handle(command);
+        }
+        state.ResumeTiming();
+
+        for (std::size_t i = 0; i < commands.size(); ++i)
+        {
+            processor.handle(commands[i]);
+            if (journal && i % BATCH == BATCH - 1)
+            {
+                journal->commit();
+            }
+        }
+
+        state.PauseTiming();
+        journal.reset();
+        state.ResumeTiming();
+    }
+    state.SetItemsProcessed(state.iterations() * commands.size());
+    std::remove(path.c_str());
+}
+BENCHMARK(BM_JournaledCommands)->Arg(-1)->Arg(static_cast<int>(Durability::None))
+    ->Arg(static_cast<int>(Durability::Batch))->Unit(benchmark::kMillisecond);
+
+// recovery: the journal of the flow replayed into an empty book, per journaled command
+template <typename Book>
+static void BM_ReplayJournal(benchmark::State& state)
+{
+    std::vector<std::string> setup;
+    const auto commands = makeFlow(setup);
+    const auto path = journalPath("journal_bench_replay.journal");
+    {
+        std::ostream nowhere(nullptr);
+        OutputSink out(nowhere);
+        OrderBook book(OrderFlow::TICK_SIZE);
+        CommandProcessor processor(book, out);
+        JournalConfig config;
+        config.durability = Durability::None;
+        Journal journal(path, book.getScale(), config);
+        processor.setJournal(&journal);
+        for (const auto& command: setup)
+        {
+            processor.handle(command);
+        }
+        for (const auto& command: commands)
+        {
+            processor.handle(command);
+        }
+    }
+
+    Journal journal(path, OrderFlow::TICK_SIZE);
+    std::size_t replayed = 0;
+    for (auto _: state)
+    {
+        state.PauseTiming();
+        std::unique_ptr<Book> book(new Book(OrderFlow::TICK_SIZE));
+        state.ResumeTiming();
+
+        replayed += journal.replay(*book);
+
+        state.PauseTiming();
+        book.reset();
+        state.ResumeTiming();
+    }
+    state.SetItemsProcessed(replayed);
+    state.SetBytesProcessed(state.iterations() * journal.size());
+    std::remove(path.c_str());
+}
+BENCHMARK_TEMPLATE(BM_ReplayJournal, OrderBook)->Unit(benchmark::kMillisecond);
+BENCHMARK_TEMPLATE(BM_ReplayJournal, LadderOrderBook)->Unit(benchmark::kMillisecond);
+
+// restart from a snapshot: a book of the given depth with ten orders per level loaded into an empty one,
+// per restored order
+template <typename Book>
+static void BM_LoadSnapshot(benchmark::State& state)
+{
+    const auto path = journalPath("journal_bench.snapshot");
+    const auto levels = static_cast<int>(state.range(0));
+    std::size_t orders = 0;
+    {
+        Book book(OrderFlow::TICK_SIZE);
+        int id = 0;
+        for (int level = 0; level < levels; ++level)
+        {
+            for (int i = 0; i < 10; ++i)
+            {
+                book.add(LimitOrder { ++id, Side::Buy, OrderFlow::MID_TICKS - 1 - level, 10, 0 });
+                book.add(LimitOrder { ++id, Side::Sell, OrderFlow::MID_TICKS + 1 + level, 10, 0 });
+            }
+        }
+        orders = id;
+        saveSnapshot(book, path);
+    }
+
+    for (auto _: state)
+    {
+        state.PauseTiming();
+        std::unique_ptr<Book> book(new Book(OrderFlow::TICK_SIZE));
+        state.ResumeTiming();
+
+        loadSnapshot(path, *book);
+
+        state.PauseTiming();
+        book.reset();
+        state.ResumeTiming();
+    }
+    state.SetItemsProcessed(state.iterations() * orders);
+    std::remove(path.c_str());
+}
+BENCHMARK_TEMPLATE(BM_LoadSnapshot, OrderBook)->Arg(100)->Arg(1000)->Unit(benchmark::kMillisecond);
+BENCHMARK_TEMPLATE(BM_LoadSnapshot, LadderOrderBook)->Arg(100)->Arg(1000)->Unit(benchmark::kMillisecond);
@@ -0,0 +1,503 @@
+#include <iostream>
+#include <memory>
+#include <random>
+#include <vector>
+#include <benchmark/benchmark.h>
+
+#include "Common.hxx"
+#include "OrderBook.hxx"
+#include "MarketData.hxx"
+
+using namespace trading;
+
+namespace
+{
+    // prices are in ticks of 0.05
+    auto makeOrder(const int id, const Side side, const int price, const int quantity = 10)
+    {
+        return LimitOrder { id, side, price, quantity, 0 };
+    }
+
+    // a single level with the given number of resting orders
+    template <typename Book>
+    int fillLevel(Book& book, const int depth)
+    {
+        int id = 0;
+        for (; id < depth; ++id)
+        {
+            book.add(makeOrder(id, Side::Buy, 200));
+        }
+        return id;
+    }
+
+    const int MID = 2000;
+
+    // levels on both sides around MID with the given number of orders each, returns the ids of the bids
+    // and of the asks, bids first
+    template <typename Book>
+    std::vector<int> buildBook(Book& book, const int levels, const int ordersPerLevel, int& id)
+    {
+        std::vector<int> ids;
+        for (const auto side: { Side::Buy, Side::Sell })
+        {
+            const auto direction = side == Side::Buy ? -1 : 1;
+            for (int level = 0; level < levels; ++level)
+            {
+                for (int i = 0; i < ordersPerLevel; ++i)
+                {
+                    book.add(makeOrder(++id, side, MID + direction * (1 + level)));
+                    ids.push_back(id);
+                }
+            }
+        }
+        return ids;
+    }
+
+    // fixed seed, so that every run picks the same
+    std::vector<int> randomPicks(const int count, const int high)
+    {
+        std::mt19937 random(42);
+        std::vector<int> picks(count);
+        for (auto& pick: picks)
+        {
+            pick = static_cast<int>(random() % static_cast<unsigned>(high));
+        }
+        return picks;
+    }
+
+    const int PICKS = 4096;
+
+    // book depth in levels per side, orders per level
+    void bookShapes(benchmark::internal::Benchmark* benchmark)
+    {
+        benchmark->ArgsProduct({ { 1, 10, 100, 1000 }, { 1, 10, 100 } });
+    }
+}
+
+// adds to a deep level and cancels that most recent order, the worst case for a search from the front
+template <typename Book>
+static void BM_CancelBackOfDeepQueue(benchmark::State& state)
+{
+    Book book(0.05);
+    auto id = fillLevel(book, state.range(0));
+    for (auto _: state)
+    {
+        book.add(makeOrder(++id, Side::Buy, 200));
+        book.cancel(id);
+    }
+}
+BENCHMARK_TEMPLATE(BM_CancelBackOfDeepQueue, OrderBook)->RangeMultiplier(8)->Range(8, 32 << 10);
+BENCHMARK_TEMPLATE(BM_CancelBackOfDeepQueue, LadderOrderBook)->RangeMultiplier(8)->Range(8, 32 << 10);
+
+// cancels of orders which were filled already, through the throwing cancel (0) or tryCancel (1);
+// stderr is switched off, the cost of the message is there without the write
+template <typename Book>
+static void BM_RejectedCancel(benchmark::State& state)
+{
+    Book book(0.05);
+    const auto depth = fillLevel(book, 100);
+    book.add(makeOrder(depth, Side::Sell, 200, 10 * depth));
+    const auto errors = std::cerr.rdbuf(nullptr);
+    int id = 0;
+    for (auto _: state)
+    {
+        if (state.range(0) == 0)
+        {
+            try
+            {
+                book.cancel(id);
+            }
+            catch (const TradingError&)
+            {}
+        }
+        else
+        {
+            benchmark::DoNotOptimize(book.tryCancel(id));
+        }
+        id = (id + 1) % depth;
+    }
+    std::cerr.rdbuf(errors);
+    std::cerr.clear();
+}
+BENCHMARK_TEMPLATE(BM_RejectedCancel, OrderBook)->Arg(0)->Arg(1);
+
+// queue position of random orders of one level of the given depth, which should not depend on the depth
+template <typename Book>
+static void BM_QueryPosition(benchmark::State& state)
+{
+    Book book(0.05);
+    const auto depth = fillLevel(book, state.range(0));
+    const auto picks = randomPicks(PICKS, depth);
+    std::size_t i = 0;
+    for (auto _: state)
+    {
+        benchmark::DoNotOptimize(book.query(picks[i]).quantityAhead);
+        if (++i == picks.size())
+        {
+            i = 0;
+        }
+    }
+}
+BENCHMARK_TEMPLATE(BM_QueryPosition, OrderBook)->RangeMultiplier(8)->Range(8, 128 << 10);
+BENCHMARK_TEMPLATE(BM_QueryPosition, LadderOrderBook)->RangeMultiplier(8)->Range(8, 128 << 10);
+
+// amending up moves the order to the back of its level
+template <typename Book>
+static void BM_AmendUpInDeepQueue(benchmark::State& state)
+{
+    Book book(0.05);
+    const auto depth = fillLevel(book, state.range(0));
+    int quantity = 10;
+    int id = 0;
+    for (auto _: state)
+    {
+        book.amend(id, ++quantity);
+        id = (id + 1) % depth;
+    }
+}
+BENCHMARK_TEMPLATE(BM_AmendUpInDeepQueue, OrderBook)->RangeMultiplier(8)->Range(8, 32 << 10);
+BENCHMARK_TEMPLATE(BM_AmendUpInDeepQueue, LadderOrderBook)->RangeMultiplier(8)->Range(8, 32 << 10);
+
+// an aggressive order taking one resting order at the touch, with a number of levels behind it
+// which must not be touched
+template <typename Book>
+static void BM_SweepTouchOverDeepBook(benchmark::State& state)
+{
+    Book book(0.05);
+    int id = 0;
+    for (int level = 0; level < state.range(0); ++level)
+    {
+        book.add(makeOrder(++id, Side::Buy, 1000 - level));
+    }
+    for (auto _: state)
+    {
+        book.add(makeOrder(++id, Side::Buy, 1001));
+        book.add(makeOrder(++id, Side::Sell, 800));
+    }
+}
+BENCHMARK_TEMPLATE(BM_SweepTouchOverDeepBook, OrderBook)->RangeMultiplier(8)->Range(8, 512);
+BENCHMARK_TEMPLATE(BM_SweepTouchOverDeepBook, LadderOrderBook)->RangeMultiplier(8)->Range(8, 512);
+
+// the top ten levels of both sides, with deep levels
+template <typename Book>
+static void BM_DepthTopTen(benchmark::State& state)
+{
+    Book book(0.05);
+    int id = 0;
+    for (int level = 0; level < 20; ++level)
+    {
+        for (int i = 0; i < state.range(0); ++i)
+        {
+            book.add(makeOrder(++id, Side::Buy, 1000 - level));
+            book.add(makeOrder(++id, Side::Sell, 1020 + level));
+        }
+    }
+    DepthSnapshot snapshot;
+    for (auto _: state)
+    {
+        book.depth(10, snapshot);
+        benchmark::DoNotOptimize(snapshot.bids.data());
+    }
+}
+BENCHMARK_TEMPLATE(BM_DepthTopTen, OrderBook)->RangeMultiplier(8)->Range(1, 512);
+BENCHMARK_TEMPLATE(BM_DepthTopTen, LadderOrderBook)->RangeMultiplier(8)->Range(1, 512);
+
+// resting orders at random levels of both sides, the book is put back between batches
+template <typename Book>
+static void BM_AddPassive(benchmark::State& state)
+{
+    Book book(0.05);
+    int id = 0;
+    const auto levels = static_cast<int>(state.range(0));
+    buildBook(book, levels, state.range(1), id);
+    const auto picks = randomPicks(PICKS, 2 * levels);
+
+    std::size_t i = 0;
+    for (auto _: state)
+    {
+        const auto pick = picks[i];
+        const auto side = pick < levels ? Side::Buy : Side::Sell;
+        const auto level = pick % levels;
+        book.add(makeOrder(++id, side, side == Side::Buy ? MID - 1 - level : MID + 1 + level));
+        if (++i == picks.size())
+        {
+            state.PauseTiming();
+            for (int back = id - PICKS + 1; back <= id; ++back)
+            {
+                book.cancel(back);
+            }
+            i = 0;
+            state.ResumeTiming();
+        }
+    }
+}
+BENCHMARK_TEMPLATE(BM_AddPassive, OrderBook)->Apply(bookShapes);
+BENCHMARK_TEMPLATE(BM_AddPassive, LadderOrderBook)->Apply(bookShapes);
+BENCHMARK_TEMPLATE(BM_AddPassive, SequentialIdOrderBook)->Apply(bookShapes);
+
+// a buy taking the first order of the best ask, then a sell putting the same back at the end of the level
+template <typename Book>
+static void BM_AddAggressive(benchmark::State& state)
+{
+    Book book(0.05);
+    int id = 0;
+    buildBook(book, state.range(0), state.range(1), id);
+    for (auto _: state)
+    {
+        benchmark::DoNotOptimize(book.add(makeOrder(++id, Side::Buy, MID + 1)));
+        book.add(makeOrder(++id, Side::Sell, MID + 1));
+    }
+}
+BENCHMARK_TEMPLATE(BM_AddAggressive, OrderBook)->Apply(bookShapes);
+BENCHMARK_TEMPLATE(BM_AddAggressive, LadderOrderBook)->Apply(bookShapes);
+
+// a buy sweeping the whole ask side of the given depth, ten orders a level, with the fills returned
+// in a list (0) or taken into a FillBuffer (1); putting the asks back is timed too, the same for both
+template <typename Book>
+static void BM_SweepFills(benchmark::State& state)
+{
+    Book book(0.05);
+    const auto levels = static_cast<int>(state.range(0));
+    book.reserve(20 * levels + 2);
+    FillBuffer fills(10 * levels);
+    int id = 0;
+    for (auto _: state)
+    {
+        for (int level = 0; level < levels; ++level)
+        {
+            for (int i = 0; i < 10; ++i)
+            {
+                book.add(makeOrder(++id, Side::Sell, MID + 1 + level));
+            }
+        }
+
+        const auto sweep = makeOrder(++id, Side::Buy, MID + levels, 100 * levels);
+        if (state.range(1) == 0)
+        {
+            benchmark::DoNotOptimize(book.add(sweep));
+        }
+        else
+        {
+            book.add(sweep, fills);
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * 10 * levels);
+}
+BENCHMARK_TEMPLATE(BM_SweepFills, OrderBook)->ArgsProduct({ { 10, 100 }, { 0, 1 } });
+BENCHMARK_TEMPLATE(BM_SweepFills, LadderOrderBook)->ArgsProduct({ { 10, 100 }, { 0, 1 } });
+
+// the same with the book's events kept in an L2Book, the cost of the market data
+template <typename Book>
+static void BM_AddAggressiveWithL2(benchmark::State& state)
+{
+    Book book(0.05);
+    L2Book l2;
+    book.setListener(&L2Book::onEvent, &l2);
+    int id = 0;
+    buildBook(book, state.range(0), state.range(1), id);
+    for (auto _: state)
+    {
+        benchmark::DoNotOptimize(book.add(makeOrder(++id, Side::Buy, MID + 1)));
+        book.add(makeOrder(++id, Side::Sell, MID + 1));
+    }
+}
+BENCHMARK_TEMPLATE(BM_AddAggressiveWithL2, OrderBook)->Apply(bookShapes);
+BENCHMARK_TEMPLATE(BM_AddAggressiveWithL2, LadderOrderBook)->Apply(bookShapes);
+
+// cancels a random resting order and puts a new one on the same level, so the shape stays
+template <typename Book>
+static void BM_Cancel(benchmark::State& state)
+{
+    Book book(0.05);
+    int id = 0;
+    auto ids = buildBook(book, state.range(0), state.range(1), id);
+    const auto picks = randomPicks(PICKS, ids.size());
+
+    std::size_t i = 0;
+    for (auto _: state)
+    {
+        auto& victim = ids[picks[i]];
+        const auto& order = *book.query(victim).order;
+        const auto side = order.side;
+        const auto price = order.price;
+        book.cancel(victim);
+        victim = ++id;
+        book.add(makeOrder(id, side, price));
+        i = (i + 1) % picks.size();
+    }
+}
+BENCHMARK_TEMPLATE(BM_Cancel, OrderBook)->Apply(bookShapes);
+BENCHMARK_TEMPLATE(BM_Cancel, LadderOrderBook)->Apply(bookShapes);
+BENCHMARK_TEMPLATE(BM_Cancel, SequentialIdOrderBook)->Apply(bookShapes);
+
+// amends random resting orders, alternately up (to the back of the level) and down (in place)
+template <typename Book>
+static void BM_Amend(benchmark::State& state)
+{
+    Book book(0.05);
+    int id = 0;
+    const auto ids = buildBook(book, state.range(0), state.range(1), id);
+    const auto picks = randomPicks(PICKS, ids.size());
+
+    std::size_t i = 0;
+    int quantity = 10;
+    for (auto _: state)
+    {
+        quantity = quantity == 10 ? 20 : 10;
+        book.amend(ids[picks[i]], quantity);
+        i = (i + 1) % picks.size();
+    }
+}
+BENCHMARK_TEMPLATE(BM_Amend, OrderBook)->Apply(bookShapes);
+BENCHMARK_TEMPLATE(BM_Amend, LadderOrderBook)->Apply(bookShapes);
+
+// price and total size of a random level
+template <typename Book>
+static void BM_PriceAndSizeAt(benchmark::State& state)
+{
+    Book book(0.05);
+    int id = 0;
+    const auto levels = static_cast<int>(state.range(0));
+    buildBook(book, levels, state.range(1), id);
+    const auto picks = randomPicks(PICKS, levels);
+
+    std::size_t i = 0;
+    for (auto _: state)
+    {
+        const auto side = i % 2 ? Side::Buy : Side::Sell;
+        benchmark::DoNotOptimize(book.priceAt(side, picks[i]));
+        benchmark::DoNotOptimize(book.sizeAt(side, picks[i]));
+        i = (i + 1) % picks.size();
+    }
+}
+BENCHMARK_TEMPLATE(BM_PriceAndSizeAt, OrderBook)->Apply(bookShapes);
+BENCHMARK_TEMPLATE(BM_PriceAndSizeAt, LadderOrderBook)->Apply(bookShapes);
+
+// status and queue position of a random resting order
+template <typename Book>
+static void BM_Query(benchmark::State& state)
+{
+    Book book(0.05);
+    int id = 0;
+    const auto ids = buildBook(book, state.range(0), state.range(1), id);
+    const auto picks = randomPicks(PICKS, ids.size());
+
+    std::size_t i = 0;
+    for (auto _: state)
+    {
+        benchmark::DoNotOptimize(book.query(ids[picks[i]]));
+        i = (i + 1) % picks.size();
+    }
+}
+BENCHMARK_TEMPLATE(BM_Query, OrderBook)->Apply(bookShapes);
+BENCHMARK_TEMPLATE(BM_Query, LadderOrderBook)->Apply(bookShapes);
+
+// pulls every bid of a book of 100 levels a side with the given orders per level, one cancel at a time (0) or with
+// one mass cancel of the side (1)
+template <typename Book>
+static void BM_CancelSide(benchmark::State& state)
+{
+    const auto ordersPerLevel = static_cast<int>(state.range(0));
+    for (auto _: state)
+    {
+        state.PauseTiming();
+        auto book = std::make_unique<Book>(0.05);
+        int id = 0;
+        buildBook(*book, 100, ordersPerLevel, id);
+        state.ResumeTiming();
+
+        if (state.range(1) == 0)
+        {
+            // the bids have the first ids
+            for (int bid = 1; bid <= 100 * ordersPerLevel; ++bid)
+            {
+                book->tryCancel(bid);
+            }
+        }
+        else
+        {
+            int cancelled = 0;
+            book->tryCancelAll(MassCancel { CancelScope::Side, Side::Buy, 0, 0 }, cancelled);
+        }
+
+        // the book goes outside of the timing
+        state.PauseTiming();
+        book.reset();
+        state.ResumeTiming();
+    }
+    state.SetItemsProcessed(state.iterations() * 100 * ordersPerLevel);
+}
+BENCHMARK_TEMPLATE(BM_CancelSide, OrderBook)->ArgsProduct({ { 10, 100 }, { 0, 1 } })->Unit(benchmark::kMicrosecond);
+BENCHMARK_TEMPLATE(BM_CancelSide, LadderOrderBook)->ArgsProduct({ { 10, 100 }, { 0, 1 } })->Unit(benchmark::kMicrosecond);
+
+// the given number of resting orders spread over 1000 levels a side, built once; the counters are the bytes
+// per resting order of each structure, see MemoryUsage
+template <typename Book>
+static void BM_RestingFootprint(benchmark::State& state)
+{
+    const auto count = static_cast<int>(state.range(0));
+    MemoryUsage usage;
+    for (auto _: state)
+    {
+        Book book(0.05);
+        for (int id = 1; id <= count; ++id)
+        {
+            const auto level = id % 1000;
+            book.add(makeOrder(id, id % 2 ? Side::Buy : Side::Sell, id % 2 ? MID - 1 - level : MID + 1 + level));
+        }
+        usage = book.memoryUsage();
+    }
+    const auto perOrder = [count](const std::size_t bytes) { return static_cast<double>(bytes) / count; };
+    state.counters["orders"] = perOrder(usage.orders);
+    state.counters["index"] = perOrder(usage.index);
+    state.counters["levels"] = perOrder(usage.levels);
+    state.counters["total"] = perOrder(usage.total());
+}
+BENCHMARK_TEMPLATE(BM_RestingFootprint, OrderBook)->Arg(1000000)->Iterations(1)->Unit(benchmark::kMillisecond);
+BENCHMARK_TEMPLATE(BM_RestingFootprint, LadderOrderBook)->Arg(1000000)->Iterations(1)->Unit(benchmark::kMillisecond);
+
+// the id index alone under a sliding window of the given number of resting orders with sequential ids: each
+// round adds the next id, looks up one at random and retires the oldest, of which one in 64 rests a thousand
+// rounds longer
+template <typename Index>
+static void BM_IdIndexChurn(benchmark::State& state)
+{
+    Index index;
+    const auto live = static_cast<int>(state.range(0));
+    index.reserve(live + 2000);
+    const auto picks = randomPicks(PICKS, live);
+    std::vector<int> stale;
+    int next = 1;
+    for (; next <= live; ++next)
+    {
+        index.insert(next, static_cast<OrderHandle>(next));
+    }
+
+    std::size_t i = 0;
+    for (auto _: state)
+    {
+        const auto id = next++;
+        benchmark::DoNotOptimize(index.find(id));
+        index.insert(id, static_cast<OrderHandle>(id));
+        benchmark::DoNotOptimize(index.find(id - picks[i]));
+        const auto oldest = id - live;
+        if (oldest % 64 == 0)
+        {
+            stale.push_back(oldest);
+        }
+        else
+        {
+            index.erase(oldest);
+        }
+        if (!stale.empty() && stale.front() < oldest - 1000)
+        {
+            index.erase(stale.front());
+            stale.erase(stale.begin());
+        }
+        i = (i + 1) % picks.size();
+    }
+}
+BENCHMARK_TEMPLATE(BM_IdIndexChurn, FlatIdIndex)->Arg(1000)->Arg(100000)->Arg(1000000);
+BENCHMARK_TEMPLATE(BM_IdIndexChurn, RingIdIndex)->Arg(1000)->Arg(100000)->Arg(1000000);
+
+BENCHMARK_MAIN();
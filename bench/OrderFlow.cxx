@@ -0,0 +1,82 @@
+#include <cstdio>
+
+#include "OrderFlow.hxx"
+
+namespace trading
+{
+    constexpr double OrderFlow::TICK_SIZE;
+
+    OrderFlow::OrderFlow(const FlowConfig& _config):
+        config(_config),
+        random(config.seed),
+        book(TICK_SIZE)
+    {
+        for (int level = 0; level < config.levels; ++level)
+        {
+            for (int i = 0; i < config.ordersPerLevel; ++i)
+            {
+                initial.push_back(order(Side::Buy, MID_TICKS - 1 - level, randomInt(1, 100)));
+                initial.push_back(order(Side::Sell, MID_TICKS + 1 + level, randomInt(1, 100)));
+            }
+        }
+    }
+
+    const std::vector<std::string>& OrderFlow::setup() const
+    {
+        return initial;
+    }
+
+    void OrderFlow::generate(const std::size_t count, std::vector<std::string>& commands)
+    {
+        while (commands.size() < count)
+        {
+            if (randomInt(0, 99) < config.cancelPercent && !resting.empty())
+            {
+                // swap the victim out of the middle, filled ones are dropped on the way
+                const auto pos = randomInt(0, static_cast<int>(resting.size()) - 1);
+                const auto id = resting[pos];
+                resting[pos] = resting.back();
+                resting.pop_back();
+                if (book.query(id).position >= 0)
+                {
+                    book.cancel(id);
+                    commands.push_back("cancel " + std::to_string(id));
+                }
+                continue;
+            }
+
+            const auto side = randomInt(0, 1) == 0 ? Side::Buy : Side::Sell;
+            const auto direction = side == Side::Buy ? -1 : 1;
+            int ticks;
+            if (randomInt(0, 99) < config.aggressivePercent)
+            {
+                // through the touch of the other side by up to a few levels
+                ticks = MID_TICKS - direction * randomInt(1, 3);
+            }
+            else
+            {
+                ticks = MID_TICKS + direction * randomInt(1, config.levels);
+            }
+            commands.push_back(order(side, ticks, randomInt(1, 100)));
+        }
+    }
+
+    std::string OrderFlow::order(const Side side, const int ticks, const int quantity)
+    {
+        const auto id = ++nextId;
+        book.add(LimitOrder { id, side, ticks, quantity, 0 });
+        resting.push_back(id);
+
+        // ticks of 0.05 have two decimals
+        char text[64];
+        std::snprintf(text, sizeof(text), "order %d %s %d %d.%02d", id, side == Side::Buy ? "buy" : "sell", quantity,
+            ticks / 20, ticks % 20 * 5);
+        return text;
+    }
+
+    int OrderFlow::randomInt(const int low, const int high)
+    {
+        // not uniform_int_distribution, whose output differs between standard libraries
+        return low + static_cast<int>(random() % static_cast<std::uint64_t>(high - low + 1));
+    }
+}
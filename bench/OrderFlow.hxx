@@ -0,0 +1,58 @@
+#pragma once
+
+#include <cstdint>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "OrderBook.hxx"
+
+namespace trading
+{
+    struct FlowConfig
+    {
+        // price levels on each side of the book
+        int levels = 10;
+        // resting orders on each level to begin with
+        int ordersPerLevel = 10;
+        // percent of the commands which cancel a resting order
+        int cancelPercent = 30;
+        // percent of the new orders which cross the spread
+        int aggressivePercent = 10;
+        std::uint64_t seed = 42;
+    };
+
+    // A reproducible stream of text commands for a book with a tick of TICK_SIZE: first the orders
+    // building a book of the configured depth, then random new orders, aggressive orders and cancels.
+    // It replays the commands on a book of its own, so that it only cancels orders which are still open
+    // and the flow has no rejections in it.
+    class OrderFlow
+    {
+    public:
+        static constexpr double TICK_SIZE = 0.05;
+
+        // bids are below this, asks above
+        static const int MID_TICKS = 2000;
+
+        explicit OrderFlow(const FlowConfig& _config);
+
+        // the commands building the initial book
+        const std::vector<std::string>& setup() const;
+
+        // appends the next count commands
+        void generate(const std::size_t count, std::vector<std::string>& commands);
+
+    private:
+        const FlowConfig config;
+        std::mt19937_64 random;
+        OrderBook book;
+        std::vector<std::string> initial;
+        // ids of orders which may still rest in the book
+        std::vector<int> resting;
+        int nextId = 0;
+
+        std::string order(const Side side, const int ticks, const int quantity);
+
+        int randomInt(const int low, const int high);
+    };
+}
@@ -0,0 +1,40 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include "LimitOrder.hxx"
+#include "Reject.hxx"
+
+namespace trading
+{
+    enum class BatchOp: std::uint8_t
+    {
+        Add,
+        Cancel,
+        Amend
+    };
+
+    // One command of a batch, see BasicOrderBook::apply. An add uses all the fields and the price is in ticks;
+    // a cancel only uses the id; an amend uses the id and the new quantity.
+    struct BatchCommand
+    {
+        BatchOp op;
+        Side side;
+        int id;
+        int price;
+        int quantity;
+    };
+
+    // BasicOrderBook::apply looks the commands' ids up ahead, and prefetches, only in a book with at least this
+    // many resting orders; a smaller one is in the cache anyway
+    constexpr std::size_t BATCH_LOOK_AHEAD_ORDERS = 1 << 14;
+
+    // what became of one command of a batch
+    struct BatchResult
+    {
+        Reject reason;
+        // the fills of an add, which follow those of the commands before it in the batch's FillBuffer
+        std::uint32_t fills;
+    };
+}
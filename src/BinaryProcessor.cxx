@@ -0,0 +1,195 @@
+#include "Common.hxx"
+#include "BinaryProtocol.hxx"
+#include "BinaryProcessor.hxx"
+#include "Report.hxx"
+
+namespace trading
+{
+	template <typename Book>
+	BasicBinaryProcessor<Book>::BasicBinaryProcessor(Book& _book, OutputSink& _out):
+		book(_book),
+		out(_out)
+	{}
+
+	template <typename Book>
+	Reject BasicBinaryProcessor<Book>::handle(const char* data)
+	{
+		using namespace binary;
+
+		switch (static_cast<MessageType>(data[0]))
+		{
+			case MessageType::Order:
+			{
+				OrderMessage message;
+				decode(data, message);
+				// already in ticks
+				const LimitOrder order { message.id, static_cast<Side>(message.side), message.price, message.quantity };
+				fills.clear();
+				// the fills are answered as they happen, journaled after the match
+				const auto reason = book.tryAdd(order, &onFill, this);
+				if (reason != Reject::None)
+				{
+					return rejected(CommandType::Order, message.id, reason);
+				}
+				if (journal != nullptr)
+				{
+					journal->order(order, fills.data(), fills.size());
+				}
+				break;
+			}
+			case MessageType::Amend:
+			{
+				AmendMessage message;
+				decode(data, message);
+				const auto reason = book.tryAmend(message.id, message.quantity);
+				if (reason != Reject::None)
+				{
+					return rejected(CommandType::Amend, message.id, reason);
+				}
+				if (journal != nullptr)
+				{
+					journal->amend(message.id, message.quantity);
+				}
+				break;
+			}
+			case MessageType::Cancel:
+			{
+				CancelMessage message;
+				decode(data, message);
+				const auto reason = book.tryCancel(message.id);
+				if (reason != Reject::None)
+				{
+					return rejected(CommandType::Cancel, message.id, reason);
+				}
+				if (journal != nullptr)
+				{
+					journal->cancel(message.id);
+				}
+				break;
+			}
+			case MessageType::MassCancel:
+			{
+				MassCancelMessage message;
+				decode(data, message);
+				const MassCancel request { static_cast<CancelScope>(message.scope), static_cast<Side>(message.side),
+					message.from, message.to };
+				int cancelled = 0;
+				const auto reason = book.tryCancelAll(request, cancelled);
+				if (reason != Reject::None)
+				{
+					return rejected(CommandType::MassCancel, message.from, reason);
+				}
+				if (journal != nullptr)
+				{
+					journal->massCancel(request);
+				}
+				break;
+			}
+			case MessageType::QueryLevel:
+			{
+				QueryLevelMessage message;
+				decode(data, message);
+				const auto side = static_cast<Side>(message.side);
+				int price = 0;
+				int totalSize = 0;
+				const auto reason = book.tryLevel(side, message.level, price, totalSize);
+				if (reason != Reject::None)
+				{
+					return rejected(CommandType::QueryLevel, message.level, reason);
+				}
+				reportLevel(out, book.getScale(), side == Side::Buy ? "bid" : "ask", message.level, price, totalSize);
+				break;
+			}
+			case MessageType::QueryOrder:
+			{
+				QueryOrderMessage message;
+				decode(data, message);
+				QueryResult result;
+				const auto reason = book.tryQuery(message.id, result);
+				if (reason != Reject::None)
+				{
+					return rejected(CommandType::QueryOrder, message.id, reason);
+				}
+				reportOrder(out, result);
+				break;
+			}
+			case MessageType::QueryDepth:
+			{
+				QueryDepthMessage message;
+				decode(data, message);
+				const auto reason = book.tryDepth(message.levels, snapshot);
+				if (reason != Reject::None)
+				{
+					return rejected(CommandType::QueryDepth, message.levels, reason);
+				}
+				reportDepth(out, book.getScale(), snapshot);
+				break;
+			}
+			default:
+				LOG_AND_THROW("Unknown binary message type " << static_cast<int>(data[0]));
+		}
+		return Reject::None;
+	}
+
+	template <typename Book>
+	Reject BasicBinaryProcessor<Book>::rejected(const CommandType command, const int id, const Reject reason)
+	{
+		if (rejectLog != nullptr)
+		{
+			rejectLog->log(Rejection { reason, command, id });
+		}
+		return reason;
+	}
+
+	template <typename Book>
+	void BasicBinaryProcessor<Book>::onFill(void* processor, const Fill& fill)
+	{
+		auto& self = *static_cast<BasicBinaryProcessor*>(processor);
+		if (self.journal != nullptr)
+		{
+			self.fills.push_back(fill);
+		}
+		reportFill(self.out, self.book.getScale(), fill);
+	}
+
+	template <typename Book>
+	std::size_t BasicBinaryProcessor<Book>::handleAll(const char* data, const std::size_t size)
+	{
+		std::size_t pos = 0;
+		while (pos < size)
+		{
+			const auto messageSize = binary::messageSize(data + pos);
+			if (messageSize == 0)
+			{
+				LOG_AND_THROW("Unknown binary message type " << static_cast<int>(data[pos]) << " at offset " << pos);
+			}
+			if (pos + messageSize > size)
+			{
+				break;
+			}
+			try
+			{
+				handle(data + pos);
+			}
+			catch (const TradingError&)
+			{} // the book's rejections are returned, not thrown; like the text commands we carry on with the next one
+			pos += messageSize;
+		}
+		return pos;
+	}
+
+	template <typename Book>
+	void BasicBinaryProcessor<Book>::setJournal(Journal* _journal)
+	{
+		journal = _journal;
+	}
+
+	template <typename Book>
+	void BasicBinaryProcessor<Book>::setRejectLog(RejectLog* _rejectLog)
+	{
+		rejectLog = _rejectLog;
+	}
+
+	template class BasicBinaryProcessor<OrderBook>;
+	template class BasicBinaryProcessor<LadderOrderBook>;
+}
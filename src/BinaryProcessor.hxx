@@ -0,0 +1,52 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+#include "Journal.hxx"
+#include "OrderBook.hxx"
+#include "OutputSink.hxx"
+#include "RejectLog.hxx"
+
+namespace trading
+{
+	// Applies binary protocol messages (see BinaryProtocol.hxx) to a book, answering in the same text as CommandProcessor
+	template <typename Book>
+	class BasicBinaryProcessor
+	{
+	public:
+		BasicBinaryProcessor(Book& _book, OutputSink& _out);
+
+		// handles the single message at the front of data, which must be complete; Reject::None,
+		// or why the book refused it
+		Reject handle(const char* data);
+
+		// handles all complete messages in the buffer and returns how many bytes they took, the rest is
+		// an incomplete message to be completed by the next read. Messages rejected by the book are skipped,
+		// an unknown message type throws, since there is no way to find the next message after it.
+		std::size_t handleAll(const char* data, const std::size_t size);
+
+		// the accepted commands and their fills go to the journal too, nullptr stops that
+		void setJournal(Journal* _journal);
+
+		// the rejected messages go to the log, nullptr stops that
+		void setRejectLog(RejectLog* _rejectLog);
+
+	private:
+		Book& book;
+		OutputSink& out;
+		Journal* journal = nullptr;
+		DepthSnapshot snapshot;
+		RejectLog* rejectLog = nullptr;
+		// the fills of the order being added, journaled once the book is done with it
+		std::vector<Fill> fills;
+
+		// logs the rejection and returns it
+		Reject rejected(const CommandType command, const int id, const Reject reason);
+
+		// answers a fill of the order being added and keeps it for the journal
+		static void onFill(void* processor, const Fill& fill);
+	};
+
+	using BinaryProcessor = BasicBinaryProcessor<OrderBook>;
+}
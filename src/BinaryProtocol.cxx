@@ -0,0 +1,215 @@
+#include <cstring>
+
+#include "Common.hxx"
+#include "LimitOrder.hxx"
+#include "BinaryProtocol.hxx"
+#include "TextParser.hxx"
+
+namespace trading
+{
+    namespace binary
+    {
+        static_assert(sizeof(OrderMessage) == 14, "OrderMessage must be packed");
+        static_assert(sizeof(AmendMessage) == 9, "AmendMessage must be packed");
+        static_assert(sizeof(CancelMessage) == 5, "CancelMessage must be packed");
+        static_assert(sizeof(QueryLevelMessage) == 6, "QueryLevelMessage must be packed");
+        static_assert(sizeof(QueryOrderMessage) == 5, "QueryOrderMessage must be packed");
+        static_assert(sizeof(QueryDepthMessage) == 5, "QueryDepthMessage must be packed");
+        static_assert(sizeof(MassCancelMessage) == 11, "MassCancelMessage must be packed");
+
+        namespace
+        {
+            // the wire is little-endian, swap only on big-endian hosts
+            std::int32_t littleEndian(const std::int32_t value)
+            {
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+                return static_cast<std::int32_t>(__builtin_bswap32(static_cast<std::uint32_t>(value)));
+#else
+                return value;
+#endif
+            }
+
+            template <typename Message>
+            Message read(const char* data)
+            {
+                Message message;
+                std::memcpy(&message, data, sizeof(Message));
+                return message;
+            }
+
+            template <typename Message>
+            std::size_t write(const Message& message, const MessageType type, char* out)
+            {
+                std::memcpy(out, &message, sizeof(Message));
+                out[0] = static_cast<char>(type);
+                return sizeof(Message);
+            }
+        }
+
+        std::size_t messageSize(const char* data)
+        {
+            switch (static_cast<MessageType>(data[0]))
+            {
+                case MessageType::Order:
+                    return sizeof(OrderMessage);
+                case MessageType::Amend:
+                    return sizeof(AmendMessage);
+                case MessageType::Cancel:
+                    return sizeof(CancelMessage);
+                case MessageType::QueryLevel:
+                    return sizeof(QueryLevelMessage);
+                case MessageType::QueryOrder:
+                    return sizeof(QueryOrderMessage);
+                case MessageType::QueryDepth:
+                    return sizeof(QueryDepthMessage);
+                case MessageType::MassCancel:
+                    return sizeof(MassCancelMessage);
+                default:
+                    return 0;
+            }
+        }
+
+        void decode(const char* data, OrderMessage& message)
+        {
+            message = read<OrderMessage>(data);
+            message.id = littleEndian(message.id);
+            message.quantity = littleEndian(message.quantity);
+            message.price = littleEndian(message.price);
+        }
+
+        void decode(const char* data, AmendMessage& message)
+        {
+            message = read<AmendMessage>(data);
+            message.id = littleEndian(message.id);
+            message.quantity = littleEndian(message.quantity);
+        }
+
+        void decode(const char* data, CancelMessage& message)
+        {
+            message = read<CancelMessage>(data);
+            message.id = littleEndian(message.id);
+        }
+
+        void decode(const char* data, QueryLevelMessage& message)
+        {
+            message = read<QueryLevelMessage>(data);
+            message.level = littleEndian(message.level);
+        }
+
+        void decode(const char* data, QueryOrderMessage& message)
+        {
+            message = read<QueryOrderMessage>(data);
+            message.id = littleEndian(message.id);
+        }
+
+        void decode(const char* data, QueryDepthMessage& message)
+        {
+            message = read<QueryDepthMessage>(data);
+            message.levels = littleEndian(message.levels);
+        }
+
+        void decode(const char* data, MassCancelMessage& message)
+        {
+            message = read<MassCancelMessage>(data);
+            message.from = littleEndian(message.from);
+            message.to = littleEndian(message.to);
+        }
+
+        std::size_t encode(const OrderMessage& message, char* out)
+        {
+            auto wire = message;
+            wire.id = littleEndian(wire.id);
+            wire.quantity = littleEndian(wire.quantity);
+            wire.price = littleEndian(wire.price);
+            return write(wire, MessageType::Order, out);
+        }
+
+        std::size_t encode(const AmendMessage& message, char* out)
+        {
+            auto wire = message;
+            wire.id = littleEndian(wire.id);
+            wire.quantity = littleEndian(wire.quantity);
+            return write(wire, MessageType::Amend, out);
+        }
+
+        std::size_t encode(const CancelMessage& message, char* out)
+        {
+            auto wire = message;
+            wire.id = littleEndian(wire.id);
+            return write(wire, MessageType::Cancel, out);
+        }
+
+        std::size_t encode(const QueryLevelMessage& message, char* out)
+        {
+            auto wire = message;
+            wire.level = littleEndian(wire.level);
+            return write(wire, MessageType::QueryLevel, out);
+        }
+
+        std::size_t encode(const QueryOrderMessage& message, char* out)
+        {
+            auto wire = message;
+            wire.id = littleEndian(wire.id);
+            return write(wire, MessageType::QueryOrder, out);
+        }
+
+        std::size_t encode(const QueryDepthMessage& message, char* out)
+        {
+            auto wire = message;
+            wire.levels = littleEndian(wire.levels);
+            return write(wire, MessageType::QueryDepth, out);
+        }
+
+        std::size_t encode(const MassCancelMessage& message, char* out)
+        {
+            auto wire = message;
+            wire.from = littleEndian(wire.from);
+            wire.to = littleEndian(wire.to);
+            return write(wire, MessageType::MassCancel, out);
+        }
+
+        std::size_t fromText(const std::string& line, const PriceScale& scale, char* out)
+        {
+            Command command;
+            if (parse(line, command) != ParseResult::Ok)
+            {
+                return 0;
+            }
+
+            const auto side = static_cast<std::uint8_t>(command.side);
+            switch (command.type)
+            {
+                case CommandType::Order:
+                {
+                    int ticks;
+                    if (!scale.toTicks(command.price, ticks))
+                    {
+                        return 0;
+                    }
+                    return encode(OrderMessage { 0, side, command.id, command.quantity, ticks }, out);
+                }
+                case CommandType::Amend:
+                    return encode(AmendMessage { 0, command.id, command.quantity }, out);
+                case CommandType::Cancel:
+                    return encode(CancelMessage { 0, command.id }, out);
+                case CommandType::QueryLevel:
+                    return encode(QueryLevelMessage { 0, side, command.id }, out);
+                case CommandType::QueryOrder:
+                    return encode(QueryOrderMessage { 0, command.id }, out);
+                case CommandType::QueryDepth:
+                    return encode(QueryDepthMessage { 0, command.id }, out);
+                case CommandType::MassCancel:
+                {
+                    auto from = command.id;
+                    if (command.scope == CancelScope::Beyond && !scale.toTicks(command.price, from))
+                    {
+                        return 0;
+                    }
+                    return encode(MassCancelMessage { 0, static_cast<std::uint8_t>(command.scope), side, from,
+                        command.quantity }, out);
+                }
+            }
+            return 0;
+        }
+    }
+}
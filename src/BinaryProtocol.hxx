@@ -0,0 +1,121 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#include "PriceScale.hxx"
+
+namespace trading
+{
+    // Fixed layout binary messages, the fast alternative to the text commands.
+    // Every message starts with its type, which also determines its size.  Fields are packed
+    // and little-endian, prices are integer tick levels and sides are the Side characters.
+    namespace binary
+    {
+        enum class MessageType: std::uint8_t
+        {
+            Order = 1,
+            Amend = 2,
+            Cancel = 3,
+            QueryLevel = 4,
+            QueryOrder = 5,
+            QueryDepth = 6,
+            MassCancel = 7
+        };
+
+#pragma pack(push, 1)
+        struct OrderMessage
+        {
+            std::uint8_t type;
+            std::uint8_t side;
+            std::int32_t id;
+            std::int32_t quantity;
+            std::int32_t price;
+        };
+
+        struct AmendMessage
+        {
+            std::uint8_t type;
+            std::int32_t id;
+            std::int32_t quantity;
+        };
+
+        struct CancelMessage
+        {
+            std::uint8_t type;
+            std::int32_t id;
+        };
+
+        struct QueryLevelMessage
+        {
+            std::uint8_t type;
+            std::uint8_t side;
+            std::int32_t level;
+        };
+
+        struct QueryOrderMessage
+        {
+            std::uint8_t type;
+            std::int32_t id;
+        };
+
+        struct QueryDepthMessage
+        {
+            std::uint8_t type;
+            std::int32_t levels;
+        };
+
+        // the fields of a MassCancel, the scope as in CancelScope
+        struct MassCancelMessage
+        {
+            std::uint8_t type;
+            std::uint8_t scope;
+            std::uint8_t side;
+            std::int32_t from;
+            std::int32_t to;
+        };
+#pragma pack(pop)
+
+        // the largest message, enough room to encode any one of them
+        const std::size_t MAX_MESSAGE_SIZE = sizeof(OrderMessage);
+
+        // size of the message starting at data, 0 if the type is unknown
+        std::size_t messageSize(const char* data);
+
+        // copies a message out of a buffer, converting from little-endian; data must hold a message of this type
+        void decode(const char* data, OrderMessage& message);
+
+        void decode(const char* data, AmendMessage& message);
+
+        void decode(const char* data, CancelMessage& message);
+
+        void decode(const char* data, QueryLevelMessage& message);
+
+        void decode(const char* data, QueryOrderMessage& message);
+
+        void decode(const char* data, QueryDepthMessage& message);
+
+        void decode(const char* data, MassCancelMessage& message);
+
+        // writes a message in wire format, returns its size
+        std::size_t encode(const OrderMessage& message, char* out);
+
+        std::size_t encode(const AmendMessage& message, char* out);
+
+        std::size_t encode(const CancelMessage& message, char* out);
+
+        std::size_t encode(const QueryLevelMessage& message, char* out);
+
+        std::size_t encode(const QueryOrderMessage& message, char* out);
+
+        std::size_t encode(const QueryDepthMessage& message, char* out);
+
+        std::size_t encode(const MassCancelMessage& message, char* out);
+
+        // converts one text command into its binary message, for a book with the given price scale;
+        // returns 0 for lines the text protocol would reject anyway, such as prices off the tick.
+        // An order message has no owner, the owner of a text order is dropped.
+        std::size_t fromText(const std::string& line, const PriceScale& scale, char* out);
+    }
+}
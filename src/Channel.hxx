@@ -0,0 +1,132 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <mutex>
+#include <thread>
+
+#include "SpscRing.hxx"
+
+namespace trading
+{
+    // what a thread does while the ring it needs is empty or full
+    enum class WaitStrategy
+    {
+        // busy waits, lowest latency, burns the core
+        Spin,
+        // gives the core to other threads between checks
+        Yield,
+        // sleeps until the other side signals, cheapest when idle
+        Block
+    };
+
+    // One side's waiting on a condition the other side makes true
+    class Waiter
+    {
+    public:
+        explicit Waiter(const WaitStrategy _strategy):
+            strategy(_strategy)
+        {}
+
+        // waits a little, or until notify(), after which the caller checks again; spins counts the calls
+        // in a row, ready tells whether the condition is true already
+        template <typename Ready>
+        void wait(int& spins, Ready ready)
+        {
+            ++spins;
+            if (strategy == WaitStrategy::Spin)
+            {
+#if defined(__x86_64__) || defined(__i386__)
+                __builtin_ia32_pause();
+#endif
+                return;
+            }
+            // even a blocking waiter doesn't sleep right away, most waits are short
+            if (strategy == WaitStrategy::Yield || spins < SPINS_BEFORE_SLEEP)
+            {
+                std::this_thread::yield();
+                return;
+            }
+
+            std::unique_lock<std::mutex> guard(lock);
+            sleeping.store(true, std::memory_order_relaxed);
+            // pairs with the fence in notify(): either the other side sees sleeping, or we see its change
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            signal.wait_for(guard, MAX_SLEEP, ready);
+            sleeping.store(false, std::memory_order_relaxed);
+        }
+
+        // after making the condition true, wakes a blocked waiter
+        void notify()
+        {
+            if (strategy == WaitStrategy::Block)
+            {
+                std::atomic_thread_fence(std::memory_order_seq_cst);
+                if (sleeping.load(std::memory_order_relaxed))
+                {
+                    std::lock_guard<std::mutex> guard(lock);
+                    signal.notify_one();
+                }
+            }
+        }
+
+    private:
+        static const int SPINS_BEFORE_SLEEP = 100;
+        // just in case
+        static constexpr std::chrono::milliseconds MAX_SLEEP { 10 };
+
+        const WaitStrategy strategy;
+        std::atomic<bool> sleeping { false };
+        std::mutex lock;
+        std::condition_variable signal;
+    };
+
+    // SpscRing between two threads which wait on each other with the given strategy
+    template <typename T>
+    class Channel
+    {
+    public:
+        Channel(const std::size_t capacity, const WaitStrategy strategy):
+            ring(capacity),
+            notEmpty(strategy),
+            notFull(strategy)
+        {}
+
+        // producer side
+        void push(const T& value)
+        {
+            for (int spins = 0; !ring.push(value);)
+            {
+                notFull.wait(spins, [this] { return !ring.full(); });
+            }
+            notEmpty.notify();
+        }
+
+        // consumer side, false if there's nothing there right now
+        bool tryPop(T& value)
+        {
+            if (!ring.pop(value))
+            {
+                return false;
+            }
+            notFull.notify();
+            return true;
+        }
+
+        // consumer side, waits for the next one
+        void pop(T& value)
+        {
+            for (int spins = 0; !tryPop(value);)
+            {
+                notEmpty.wait(spins, [this] { return !ring.empty(); });
+            }
+        }
+
+    private:
+        SpscRing<T> ring;
+        Waiter notEmpty;
+        Waiter notFull;
+    };
+}
@@ -1,81 +1,249 @@
-#include <sstream>
-
 #include "Common.hxx"
 #include "CommandProcessor.hxx"
+#include "Report.hxx"
 
 namespace trading
 {
-	namespace 
+	template <typename Book>
+	BasicCommandProcessor<Book>::BasicCommandProcessor(Book& _book, OutputSink& _out): 
+		book(_book),
+		out(_out)
+	{}
+
+	template <typename Book>
+	ParseResult BasicCommandProcessor<Book>::handle(std::string_view input)
 	{
-		auto string2side(const std::string& sideStr)
+		if constexpr (STATS_ENABLED)
 		{
-			if (sideStr == "buy" || sideStr == "bid")
-				return Side::Buy;
-			else if (sideStr == "sell" || sideStr == "ask")
-				return Side::Sell;
-			else
-				LOG_AND_THROW("Unknown side " << sideStr);
+			if (stats != nullptr)
+			{
+				return handleMeasured(input);
+			}
 		}
-	}
 
-	CommandProcessor::CommandProcessor(OrderBook& _book, std::ostream& _out): 
-		book(_book),
-		out(_out)
-	{}
+		Command command;
+		const auto res = parse(input, command);
+		if (res == ParseResult::Ok)
+		{
+			execute(command);
+		}
+		return res;
+	}
 
-	void CommandProcessor::handle(const std::string& input)
+	template <typename Book>
+	ParseResult BasicCommandProcessor<Book>::handleMeasured(std::string_view input)
 	{
-		std::istringstream in(input);
-		std::string cmd;
-		in >> cmd;
+		stats->startCommand();
+		const auto start = timestamp();
+		Command command;
+		const auto res = parse(input, command);
+		const auto parsed = timestamp();
+		if (res != ParseResult::Ok)
+		{
+			if (res != ParseResult::Empty)
+			{
+				stats->recordUnparsed(start, parsed);
+			}
+			return res;
+		}
+
+		matched = parsed;
+		traded = false;
+		const auto reason = execute(command);
+		const auto outcome = reason != Reject::None ? Outcome::Rejected : traded ? Outcome::Aggressive : Outcome::Passive;
+		stats->record(command.type, outcome, start, parsed, matched, timestamp());
+		stats->endCommand(command.type);
+		return res;
+	}
 
-		if (cmd == "order") {
-			int id;
-			int quantity;
-			std::string sideStr;
-			double price;
-			in >> id >> sideStr >> quantity >> price;
-			const auto side = string2side(sideStr);
-			auto order = std::make_shared<LimitOrder>(LimitOrder { id, side, price, quantity });
-			const auto&& fills = book.add(order);
-			for (const auto& fill: fills)
+	template <typename Book>
+	void BasicCommandProcessor<Book>::markMatched()
+	{
+		if constexpr (STATS_ENABLED)
+		{
+			if (stats != nullptr)
 			{
-				out << "Fill: " << fill.filledQty << "@" << fill.filledPrice << std::endl;
+				matched = timestamp();
 			}
 		}
-		else if (cmd == "amend") {
-			int id;
-			int quantity;
-			in >> id >> quantity;
-			book.amend(id, quantity);
+	}
+
+	template <typename Book>
+	Reject BasicCommandProcessor<Book>::rejected(const Command& command, const Reject reason)
+	{
+		markMatched();
+		if (rejectLog != nullptr)
+		{
+			rejectLog->log(Rejection { reason, command.type, command.id });
 		}
-		else if (cmd == "cancel") {
-			int id;
-			in >> id;
-			book.cancel(id);
+		return reason;
+	}
+
+	template <typename Book>
+	void BasicCommandProcessor<Book>::onFill(void* processor, const Fill& fill)
+	{
+		auto& self = *static_cast<BasicCommandProcessor*>(processor);
+		if (self.journal != nullptr)
+		{
+			self.fills.push_back(fill);
 		}
-		else if (cmd == "q") {
-			std::string subCmd;
-			in >> subCmd;
-			if (subCmd == "level") {
-				std::string sideStr;
-				int level;
-				in >> sideStr >> level;
-				const auto side = string2side(sideStr);
-				auto price = book.priceAt(side, level);
-				auto totalSize = book.sizeAt(side, level);
-				out << sideStr << ", " << level << ", " << price << ", " << totalSize << std::endl;
+		if constexpr (STATS_ENABLED)
+		{
+			// the fills come level by level, best price first
+			if (self.fillCount == 0 || fill.filledPrice != self.lastFillPrice)
+			{
+				++self.levelCount;
+				self.lastFillPrice = fill.filledPrice;
+			}
+		}
+		++self.fillCount;
+		reportFill(self.out, self.book.getScale(), fill);
+	}
+
+	template <typename Book>
+	Reject BasicCommandProcessor<Book>::execute(const Command& command)
+	{
+		switch (command.type)
+		{
+			case CommandType::Order:
+			{
+				// the one place where a text price becomes ticks
+				int price = 0;
+				if (!book.getScale().toTicks(command.price, price))
+				{
+					return rejected(command, book.reject(Reject::OffTick));
+				}
+				const LimitOrder order { command.id, command.side, price, command.quantity, 0, false, command.owner };
+				fills.clear();
+				fillCount = 0;
+				levelCount = 0;
+				// the fills are answered as they happen, journaled after the match
+				const auto reason = book.tryAdd(order, &onFill, this);
+				if (reason != Reject::None)
+				{
+					return rejected(command, reason);
+				}
+				markMatched();
+				if (journal != nullptr)
+				{
+					journal->order(order, fills.data(), fills.size());
+				}
+				if constexpr (STATS_ENABLED)
+				{
+					if (stats != nullptr)
+					{
+						traded = fillCount > 0;
+						stats->recordAdd(fillCount, levelCount);
+					}
+				}
+				break;
+			}
+			case CommandType::Amend:
+			{
+				const auto reason = book.tryAmend(command.id, command.quantity);
+				if (reason != Reject::None)
+				{
+					return rejected(command, reason);
+				}
+				markMatched();
+				if (journal != nullptr)
+				{
+					journal->amend(command.id, command.quantity);
+				}
+				break;
+			}
+			case CommandType::Cancel:
+			{
+				const auto reason = book.tryCancel(command.id);
+				if (reason != Reject::None)
+				{
+					return rejected(command, reason);
+				}
+				markMatched();
+				if (journal != nullptr)
+				{
+					journal->cancel(command.id);
+				}
+				break;
+			}
+			case CommandType::MassCancel:
+			{
+				MassCancel request { command.scope, command.side, command.id, command.quantity };
+				if (command.scope == CancelScope::Beyond && !book.getScale().toTicks(command.price, request.from))
+				{
+					return rejected(command, book.reject(Reject::OffTick));
+				}
+				int cancelled = 0;
+				const auto reason = book.tryCancelAll(request, cancelled);
+				if (reason != Reject::None)
+				{
+					return rejected(command, reason);
+				}
+				markMatched();
+				if (journal != nullptr)
+				{
+					journal->massCancel(request);
+				}
+				break;
+			}
+			case CommandType::QueryLevel:
+			{
+				int price = 0;
+				int totalSize = 0;
+				const auto reason = book.tryLevel(command.side, command.id, price, totalSize);
+				if (reason != Reject::None)
+				{
+					return rejected(command, reason);
+				}
+				markMatched();
+				reportLevel(out, book.getScale(), command.sideName, command.id, price, totalSize);
+				break;
+			}
+			case CommandType::QueryOrder:
+			{
+				QueryResult result;
+				const auto reason = book.tryQuery(command.id, result);
+				if (reason != Reject::None)
+				{
+					return rejected(command, reason);
+				}
+				markMatched();
+				reportOrder(out, result);
+				break;
 			}
-			else if (subCmd == "order") {
-				int id;
-				in >> id;
-				auto&& result = book.query(id);
-				const auto& order = *result.order;
-				out << order.status() << ", leaves=" << order.leaves() << ", filled=" << order.filledQty
-					<< ", position=" << result.position
-					<< std::endl;
+			case CommandType::QueryDepth:
+			{
+				const auto reason = book.tryDepth(command.id, snapshot);
+				if (reason != Reject::None)
+				{
+					return rejected(command, reason);
+				}
+				markMatched();
+				reportDepth(out, book.getScale(), snapshot);
+				break;
 			}
 		}
+		return Reject::None;
+	}
+
+	template <typename Book>
+	void BasicCommandProcessor<Book>::setJournal(Journal* _journal)
+	{
+		journal = _journal;
 	}
-}
 
+	template <typename Book>
+	void BasicCommandProcessor<Book>::setStats(CommandStats* _stats)
+	{
+		stats = _stats;
+	}
+
+	template <typename Book>
+	void BasicCommandProcessor<Book>::setRejectLog(RejectLog* _rejectLog)
+	{
+		rejectLog = _rejectLog;
+	}
+
+	template class BasicCommandProcessor<OrderBook>;
+	template class BasicCommandProcessor<LadderOrderBook>;
+}
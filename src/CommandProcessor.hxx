@@ -1,21 +1,66 @@
 #pragma once
 
-#include <iostream>
-#include <string>
+#include <string_view>
+#include <vector>
 
+#include "Journal.hxx"
 #include "OrderBook.hxx"
+#include "OutputSink.hxx"
+#include "RejectLog.hxx"
+#include "Stats.hxx"
+#include "TextParser.hxx"
 
 namespace trading
 {
-	class CommandProcessor
+	template <typename Book>
+	class BasicCommandProcessor
 	{
 	public:
-		CommandProcessor(OrderBook& _book, std::ostream& _out);
+		BasicCommandProcessor(Book& _book, OutputSink& _out);
 
-		void handle(const std::string& cmd);
+		// parses and executes one line; a line that doesn't parse is reported in the result, and one the book
+		// rejects is counted by the book and logged, neither throws
+		ParseResult handle(std::string_view cmd);
+
+		// Reject::None, or why the book refused the command
+		Reject execute(const Command& command);
+
+		// the accepted commands and their fills go to the journal too, nullptr stops that
+		void setJournal(Journal* _journal);
+
+		// every command is timed and counted into stats, nullptr stops that; does nothing unless
+		// built with ORDER_BOOK_STATS
+		void setStats(CommandStats* _stats);
+
+		// the rejected commands go to the log, nullptr stops that
+		void setRejectLog(RejectLog* _rejectLog);
 
 	private:
-		OrderBook& book;
-		std::ostream& out;
+		Book& book;
+		OutputSink& out;
+		Journal* journal = nullptr;
+		DepthSnapshot snapshot;
+		CommandStats* stats = nullptr;
+		RejectLog* rejectLog = nullptr;
+		// the fills of the order being added, journaled once the book is done with it, and the levels they were at
+		std::vector<Fill> fills;
+		int fillCount = 0;
+		int levelCount = 0;
+		int lastFillPrice = 0;
+		// when the book was done with the command being measured, and whether it traded
+		std::uint64_t matched = 0;
+		bool traded = false;
+
+		ParseResult handleMeasured(std::string_view input);
+
+		void markMatched();
+
+		// logs the rejection and returns it
+		Reject rejected(const Command& command, const Reject reason);
+
+		// answers a fill of the order being added and keeps it for the journal
+		static void onFill(void* processor, const Fill& fill);
 	};
+
+	using CommandProcessor = BasicCommandProcessor<OrderBook>;
 }
@@ -22,12 +22,33 @@ namespace trading
     };
 
 	bool essentiallyEqual(double a, double b, double epsilon = DEFAULT_EPSILON);
+
+	// only a hint to bring the address into the cache, without the builtin it does nothing
+	inline void prefetch(const void* address)
+	{
+#if defined(__GNUC__)
+		__builtin_prefetch(address);
+#else
+		static_cast<void>(address);
+#endif
+	}
+}
+
+// formats the line first and writes it with its end of line in one write, so that on a stream shared by
+// several threads, see SharedOutput, it doesn't mix with the lines of the others
+#define LOG_LINE(stream, x) \
+{ \
+    std::ostringstream loggedLine; \
+    loggedLine << x << '\n'; \
+    const auto loggedText = loggedLine.str(); \
+    (stream).write(loggedText.data(), static_cast<std::streamsize>(loggedText.size())); \
+    (stream).flush(); \
 }
 
 #define LOG_AND_THROW(x) \
 { \
-    std::cerr << x << std::endl; \
     std::ostringstream out; \
     out << x; \
+    LOG_LINE(std::cerr, out.str()); \
     throw ::trading::TradingError(out.str()); \
 }
@@ -0,0 +1,203 @@
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+#include "Common.hxx"
+#include "Engine.hxx"
+
+namespace trading
+{
+    template <typename Book>
+    BasicEngine<Book>::Instrument::Instrument(std::string_view _name, const PriceScale& scale,
+        const RetentionConfig& retention, OutputSink& out):
+        prefix(std::string(_name) + ' '),
+        book(scale, retention),
+        processor(book, out)
+    {}
+
+    template <typename Book>
+    BasicEngine<Book>::Shard::Shard(SharedOutput& output, const std::size_t queueCapacity, const WaitStrategy wait):
+        queue(queueCapacity, wait),
+        stream(&output),
+        out(stream)
+    {}
+
+    template <typename Book>
+    BasicEngine<Book>::BasicEngine(std::ostream& _out, const EngineConfig& _config):
+        config(_config),
+        output(_out)
+    {
+        if (config.shards <= 0)
+        {
+            LOG_AND_THROW("Shard count must be positive, but is " << config.shards);
+        }
+        for (int i = 0; i < config.shards; ++i)
+        {
+            shards.emplace_back(new Shard(output, config.queueCapacity, config.wait));
+            auto& shard = *shards.back();
+            shard.thread = std::thread([&shard] { run(shard); });
+            if (config.pinThreads)
+            {
+                pin(shard.thread, i);
+            }
+        }
+    }
+
+    template <typename Book>
+    BasicEngine<Book>::~BasicEngine()
+    {
+        for (auto& shard: shards)
+        {
+            send(*shard, Message { nullptr, Command {} });
+        }
+        for (auto& shard: shards)
+        {
+            shard->thread.join();
+        }
+    }
+
+    template <typename Book>
+    void BasicEngine<Book>::addSymbol(std::string_view name, const PriceScale& scale)
+    {
+        key.assign(name.data(), name.size());
+        if (symbols.find(key) != symbols.end())
+        {
+            LOG_AND_THROW("Symbol " << key << " already exists");
+        }
+        // round robin; the shard gets to see the instrument in its first message, after it's built here
+        auto& shard = *shards[instruments.size() % shards.size()];
+        instruments.emplace_back(new Instrument(name, scale, config.retention, shard.out));
+        symbols.emplace(key, Route { instruments.back().get(), &shard });
+    }
+
+    template <typename Book>
+    ParseResult BasicEngine<Book>::handle(std::string_view line)
+    {
+        const auto symbol = nextToken(line);
+        if (symbol.empty())
+        {
+            return ParseResult::Empty;
+        }
+
+        if (symbol == "symbol")
+        {
+            const auto name = nextToken(line);
+            const auto tick = nextToken(line);
+            if (name.empty() || tick.empty())
+            {
+                return ParseResult::MissingArgument;
+            }
+            double tickSize;
+            if (!parsePrice(tick, tickSize))
+            {
+                return ParseResult::BadNumber;
+            }
+            addSymbol(name, tickSize);
+            return ParseResult::Ok;
+        }
+
+        key.assign(symbol.data(), symbol.size());
+        const auto iSymbol = symbols.find(key);
+        if (iSymbol == symbols.end())
+        {
+            return ParseResult::UnknownSymbol;
+        }
+
+        Message message { iSymbol->second.instrument, Command {} };
+        const auto res = parse(line, message.command);
+        if (res == ParseResult::Ok)
+        {
+            send(*iSymbol->second.shard, message);
+        }
+        return res;
+    }
+
+    template <typename Book>
+    void BasicEngine<Book>::send(Shard& shard, const Message& message)
+    {
+        // waits while the shard is behind
+        shard.queue.push(message);
+        ++shard.sent;
+    }
+
+    template <typename Book>
+    void BasicEngine<Book>::drain()
+    {
+        for (auto& shard: shards)
+        {
+            while (shard->completed.load(std::memory_order_acquire) < shard->sent)
+            {
+                std::this_thread::yield();
+            }
+        }
+    }
+
+    template <typename Book>
+    std::size_t BasicEngine<Book>::symbolCount() const
+    {
+        return instruments.size();
+    }
+
+    template <typename Book>
+    int BasicEngine<Book>::shardCount() const
+    {
+        return static_cast<int>(shards.size());
+    }
+
+    template <typename Book>
+    void BasicEngine<Book>::run(Shard& shard)
+    {
+        std::size_t handled = 0;
+        Message message;
+        while (true)
+        {
+            if (!shard.queue.tryPop(message))
+            {
+                // the queue ran dry, a batch boundary: write the answers out before waiting for more
+                if (shard.out.pending() > 0)
+                {
+                    shard.out.flush();
+                }
+                shard.completed.store(handled, std::memory_order_release);
+                shard.queue.pop(message);
+            }
+            if (message.instrument == nullptr)
+            {
+                break;
+            }
+            auto& instrument = *message.instrument;
+            shard.out.setPrefix(instrument.prefix);
+            try
+            {
+                instrument.processor.execute(message.command);
+            }
+            catch (const TradingError&)
+            {} // the book's rejections are counted, not thrown; whatever else fails, the next command goes on
+            ++handled;
+        }
+        shard.out.flush();
+        shard.completed.store(handled + 1, std::memory_order_release);
+    }
+
+    template <typename Book>
+    void BasicEngine<Book>::pin(std::thread& thread, const int core)
+    {
+#ifdef __linux__
+        const auto cores = static_cast<int>(std::thread::hardware_concurrency());
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        CPU_SET(cores > 0 ? core % cores : core, &set);
+        if (pthread_setaffinity_np(thread.native_handle(), sizeof(set), &set) != 0)
+        {
+            LOG_LINE(std::cerr, "Cannot pin a shard to core " << core);
+        }
+#else
+        (void) thread;
+        (void) core;
+#endif
+    }
+
+    template class BasicEngine<OrderBook>;
+    template class BasicEngine<LadderOrderBook>;
+}
@@ -0,0 +1,126 @@
+#pragma once
+
+#include <atomic>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "OrderBook.hxx"
+#include "CommandProcessor.hxx"
+#include "OutputSink.hxx"
+#include "Channel.hxx"
+#include "SharedOutput.hxx"
+#include "TextParser.hxx"
+
+namespace trading
+{
+    struct EngineConfig
+    {
+        // worker threads, the symbols are spread over them
+        int shards = 1;
+        // pins shard i to core i, on Linux
+        bool pinThreads = false;
+        // commands waiting per shard before the dispatcher has to wait
+        std::size_t queueCapacity = 1 << 16;
+        // how a shard without commands waits for more, and the dispatcher for room in a full queue; blocking
+        // keeps idle shards off their cores
+        WaitStrategy wait = WaitStrategy::Block;
+        // for every book
+        RetentionConfig retention;
+    };
+
+    // Many books, one per symbol, each with its own price scale. Symbols are dealt out over shards in the
+    // order they are defined; each shard is a thread owning its books and draining a queue of parsed
+    // commands which the dispatcher, the thread calling handle(), fills. A symbol lives on one shard only,
+    // so its commands are executed, and its answers written, in the order they came in.
+    //
+    // The text format is a command of the single book protocol prefixed by the symbol:
+    //     symbol ABC 0.05
+    //     ABC order 1001 buy 100 12.30
+    // and every answer line starts with the symbol and a space.
+    template <typename Book>
+    class BasicEngine
+    {
+    public:
+        BasicEngine(std::ostream& _out, const EngineConfig& _config);
+
+        BasicEngine(const BasicEngine&) = delete;
+        BasicEngine& operator=(const BasicEngine&) = delete;
+
+        // stops the shards, after they have handled everything so far
+        ~BasicEngine();
+
+        // throws if the symbol exists already
+        void addSymbol(std::string_view name, const PriceScale& scale);
+
+        // a symbol definition or a symbol's command; the command is parsed here and executed by its shard,
+        // which ignores the book's rejections like the single book does
+        ParseResult handle(std::string_view line);
+
+        // waits until the shards have handled every command so far and written their answers
+        void drain();
+
+        std::size_t symbolCount() const;
+
+        int shardCount() const;
+
+    private:
+        struct Instrument
+        {
+            Instrument(std::string_view _name, const PriceScale& scale, const RetentionConfig& retention,
+                OutputSink& out);
+
+            const std::string prefix;
+            Book book;
+            BasicCommandProcessor<Book> processor;
+        };
+
+        // a null instrument stops the shard
+        struct Message
+        {
+            Instrument* instrument;
+            Command command;
+        };
+
+        struct Shard
+        {
+            Shard(SharedOutput& output, const std::size_t queueCapacity, const WaitStrategy wait);
+
+            Channel<Message> queue;
+            std::ostream stream;
+            OutputSink out;
+            // dispatcher side
+            std::size_t sent = 0;
+            // shard side, messages handled with their answers written
+            std::atomic<std::size_t> completed { 0 };
+            std::thread thread;
+        };
+
+        struct Route
+        {
+            Instrument* instrument;
+            Shard* shard;
+        };
+
+        const EngineConfig config;
+        SharedOutput output;
+        std::vector<std::unique_ptr<Shard>> shards;
+        // owned here, used by their shard only
+        std::vector<std::unique_ptr<Instrument>> instruments;
+        std::unordered_map<std::string, Route> symbols;
+        // the symbol being looked up, reused so that short names don't allocate
+        std::string key;
+
+        void send(Shard& shard, const Message& message);
+
+        static void run(Shard& shard);
+
+        static void pin(std::thread& thread, const int core);
+    };
+
+    using Engine = BasicEngine<OrderBook>;
+}
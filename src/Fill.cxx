@@ -0,0 +1,63 @@
+#include "Fill.hxx"
+
+namespace trading
+{
+    FillBuffer::FillBuffer(const std::size_t _capacity):
+        maxFills(_capacity),
+        fills(new Fill[_capacity])
+    {}
+
+    void FillBuffer::collect(void* buffer, const Fill& fill)
+    {
+        auto& self = *static_cast<FillBuffer*>(buffer);
+        if (self.count < self.maxFills)
+        {
+            self.fills[self.count++] = fill;
+        }
+        else
+        {
+            ++self.overflow;
+        }
+    }
+
+    void FillBuffer::clear()
+    {
+        count = 0;
+        overflow = 0;
+    }
+
+    std::size_t FillBuffer::size() const
+    {
+        return count;
+    }
+
+    bool FillBuffer::empty() const
+    {
+        return count == 0;
+    }
+
+    std::size_t FillBuffer::capacity() const
+    {
+        return maxFills;
+    }
+
+    std::size_t FillBuffer::dropped() const
+    {
+        return overflow;
+    }
+
+    const Fill& FillBuffer::operator[](const std::size_t i) const
+    {
+        return fills[i];
+    }
+
+    const Fill* FillBuffer::begin() const
+    {
+        return fills.get();
+    }
+
+    const Fill* FillBuffer::end() const
+    {
+        return fills.get() + count;
+    }
+}
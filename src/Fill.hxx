@@ -0,0 +1,54 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+
+namespace trading
+{
+    // prices are in ticks of the book's PriceScale
+    struct Fill
+    {
+        int filledPrice;
+        int filledQty;
+        // the resting order and the incoming one which took from it
+        int makerId;
+        int takerId;
+        // what the resting order has left after the fill, 0 once it's filled
+        int makerLeaves;
+    };
+
+    // Takes the fills of one add, see BasicOrderBook::add, into storage allocated once up front and reused
+    // from one add to the next. It holds at most its capacity, fills beyond that are only counted, so it
+    // must be as large as the deepest sweep to expect.
+    class FillBuffer
+    {
+    public:
+        explicit FillBuffer(const std::size_t _capacity);
+
+        // a FillHandler whose context is a FillBuffer
+        static void collect(void* buffer, const Fill& fill);
+
+        void clear();
+
+        std::size_t size() const;
+
+        bool empty() const;
+
+        std::size_t capacity() const;
+
+        // fills which didn't fit since the last clear()
+        std::size_t dropped() const;
+
+        const Fill& operator[](const std::size_t i) const;
+
+        const Fill* begin() const;
+
+        const Fill* end() const;
+
+    private:
+        const std::size_t maxFills;
+        const std::unique_ptr<Fill[]> fills;
+        std::size_t count = 0;
+        std::size_t overflow = 0;
+    };
+}
@@ -0,0 +1,230 @@
+#pragma once
+
+#include <algorithm>
+#include <climits>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "Common.hxx"
+
+namespace trading
+{
+    // Map from order ids to small values in one flat array: open addressing with linear probing, so a
+    // lookup reads one or two adjacent slots and nothing is allocated per insert, only when the table doubles.
+    // Ids are spread by Fibonacci hashing, which keeps a sliding window of consecutive ids evenly spaced
+    // instead of piling up into long runs, and an erase shifts the rest of its run back instead of leaving a
+    // tombstone.
+    template <typename T>
+    class FlatIdMap
+    {
+    public:
+        // nullptr if the id isn't there
+        const T* find(const int id) const
+        {
+            if (id == FREE)
+            {
+                return hasFreeId ? &freeIdValue : nullptr;
+            }
+            if (slots.empty())
+            {
+                return nullptr;
+            }
+            for (auto i = home(id); ; i = (i + 1) & mask)
+            {
+                const auto& slot = slots[i];
+                if (slot.id == id)
+                {
+                    return &slot.value;
+                }
+                if (slot.id == FREE)
+                {
+                    return nullptr;
+                }
+            }
+        }
+
+        // false, changing nothing, if the id is already there
+        bool insert(const int id, const T& value)
+        {
+            if (id == FREE)
+            {
+                if (hasFreeId)
+                {
+                    return false;
+                }
+                hasFreeId = true;
+                freeIdValue = value;
+                ++count;
+                return true;
+            }
+            if (2 * (count + 1) > slots.size())
+            {
+                rehash(std::max(MIN_SLOTS, 2 * slots.size()));
+            }
+            auto i = home(id);
+            for (; slots[i].id != FREE; i = (i + 1) & mask)
+            {
+                if (slots[i].id == id)
+                {
+                    return false;
+                }
+            }
+            slots[i] = Slot { id, value };
+            ++count;
+            return true;
+        }
+
+        // false if the id wasn't there
+        bool erase(const int id)
+        {
+            if (id == FREE)
+            {
+                if (!hasFreeId)
+                {
+                    return false;
+                }
+                hasFreeId = false;
+                --count;
+                return true;
+            }
+            if (slots.empty())
+            {
+                return false;
+            }
+            auto i = home(id);
+            for (; slots[i].id != id; i = (i + 1) & mask)
+            {
+                if (slots[i].id == FREE)
+                {
+                    return false;
+                }
+            }
+            // move back every later id of the run that could live in the hole, so no probe stops short of it
+            for (auto j = (i + 1) & mask; slots[j].id != FREE; j = (j + 1) & mask)
+            {
+                const auto k = home(slots[j].id);
+                if (((j - k) & mask) >= ((j - i) & mask))
+                {
+                    slots[i] = slots[j];
+                    i = j;
+                }
+            }
+            slots[i].id = FREE;
+            --count;
+            return true;
+        }
+
+        std::size_t size() const
+        {
+            return count;
+        }
+
+        // makes room for the given number of ids on top of those there, adding them won't call malloc
+        void reserve(const std::size_t more)
+        {
+            auto wanted = std::max(MIN_SLOTS, slots.size());
+            while (wanted < 2 * (count + more))
+            {
+                wanted *= 2;
+            }
+            if (wanted > slots.size())
+            {
+                rehash(wanted);
+            }
+        }
+
+        // brings the first slot finding or inserting the id reads into the cache
+        void prefetch(const int id) const
+        {
+            if (!slots.empty())
+            {
+                trading::prefetch(&slots[home(id)]);
+            }
+        }
+
+        // calls f(id, value) for every id, in no particular order
+        template <typename F>
+        void forEach(const F& f) const
+        {
+            if (hasFreeId)
+            {
+                f(FREE, freeIdValue);
+            }
+            for (const auto& slot: slots)
+            {
+                if (slot.id != FREE)
+                {
+                    f(slot.id, slot.value);
+                }
+            }
+        }
+
+        // bytes of the slots
+        std::size_t memoryUsage() const
+        {
+            return slots.capacity() * sizeof(Slot);
+        }
+
+        // drops the ids, keeping the memory
+        void clear()
+        {
+            for (auto& slot: slots)
+            {
+                slot.id = FREE;
+            }
+            hasFreeId = false;
+            count = 0;
+        }
+
+    private:
+        struct Slot
+        {
+            int id;
+            T value;
+        };
+
+        // marks a slot without an id; an order can still have it, its value is kept aside
+        static constexpr int FREE = INT_MIN;
+        static constexpr std::size_t MIN_SLOTS = 16;
+
+        // a power of two in size, at most half full
+        std::vector<Slot> slots;
+        std::size_t mask = 0;
+        // log2 of the size
+        int bits = 0;
+        std::size_t count = 0;
+        bool hasFreeId = false;
+        T freeIdValue {};
+
+        std::size_t home(const int id) const
+        {
+            return static_cast<std::size_t>(
+                (static_cast<std::uint64_t>(static_cast<std::uint32_t>(id)) * 0x9E3779B97F4A7C15ull) >> (64 - bits));
+        }
+
+        void rehash(const std::size_t size)
+        {
+            std::vector<Slot> old(size, Slot { FREE, T {} });
+            old.swap(slots);
+            mask = size - 1;
+            bits = 0;
+            while ((std::size_t(1) << bits) < size)
+            {
+                ++bits;
+            }
+            for (const auto& slot: old)
+            {
+                if (slot.id != FREE)
+                {
+                    auto i = home(slot.id);
+                    while (slots[i].id != FREE)
+                    {
+                        i = (i + 1) & mask;
+                    }
+                    slots[i] = slot;
+                }
+            }
+        }
+    };
+}
@@ -0,0 +1,184 @@
+#include <algorithm>
+
+#include "IdIndex.hxx"
+#include "Common.hxx"
+
+namespace trading
+{
+    namespace
+    {
+        const std::size_t MIN_RING = 1024;
+        // the ring doubles once this fraction of its size has overflowed
+        const std::size_t OVERFLOW_SHARE = 8;
+    }
+
+    OrderHandle FlatIdIndex::find(const int id) const
+    {
+        const auto handle = map.find(id);
+        return handle == nullptr ? NO_ORDER : *handle;
+    }
+
+    bool FlatIdIndex::insert(const int id, const OrderHandle handle)
+    {
+        return map.insert(id, handle);
+    }
+
+    void FlatIdIndex::erase(const int id)
+    {
+        map.erase(id);
+    }
+
+    std::size_t FlatIdIndex::size() const
+    {
+        return map.size();
+    }
+
+    void FlatIdIndex::reserve(const std::size_t count)
+    {
+        map.reserve(count);
+    }
+
+    void FlatIdIndex::prefetch(const int id) const
+    {
+        map.prefetch(id);
+    }
+
+    std::size_t FlatIdIndex::memoryUsage() const
+    {
+        return map.memoryUsage();
+    }
+
+    OrderHandle RingIdIndex::find(const int id) const
+    {
+        if (!ring.empty())
+        {
+            const auto& slot = ring[slotOf(id)];
+            if (slot.handle != NO_ORDER && slot.id == id)
+            {
+                return slot.handle;
+            }
+        }
+        if (overflow.size() == 0)
+        {
+            return NO_ORDER;
+        }
+        const auto handle = overflow.find(id);
+        return handle == nullptr ? NO_ORDER : *handle;
+    }
+
+    bool RingIdIndex::insert(const int id, const OrderHandle handle)
+    {
+        if (ring.empty())
+        {
+            grow(MIN_RING);
+        }
+        auto& slot = ring[slotOf(id)];
+        if (slot.handle != NO_ORDER && slot.id == id)
+        {
+            return false;
+        }
+        if (overflow.size() != 0 && overflow.find(id) != nullptr)
+        {
+            return false;
+        }
+        ++count;
+        if (slot.handle == NO_ORDER)
+        {
+            slot = Slot { id, handle };
+            return true;
+        }
+        overflow.insert(id, handle);
+        if (overflow.size() > ring.size() / OVERFLOW_SHARE)
+        {
+            grow(2 * ring.size());
+        }
+        return true;
+    }
+
+    void RingIdIndex::erase(const int id)
+    {
+        if (!ring.empty())
+        {
+            auto& slot = ring[slotOf(id)];
+            if (slot.handle != NO_ORDER && slot.id == id)
+            {
+                slot.handle = NO_ORDER;
+                --count;
+                return;
+            }
+        }
+        if (overflow.erase(id))
+        {
+            --count;
+        }
+    }
+
+    std::size_t RingIdIndex::size() const
+    {
+        return count;
+    }
+
+    void RingIdIndex::reserve(const std::size_t more)
+    {
+        // twice the orders, leaving room for the gaps the ones done early leave in the window
+        auto wanted = std::max(MIN_RING, ring.size());
+        while (wanted < 2 * (count + more))
+        {
+            wanted *= 2;
+        }
+        if (wanted > ring.size())
+        {
+            grow(wanted);
+        }
+        overflow.reserve(wanted / OVERFLOW_SHARE);
+    }
+
+    void RingIdIndex::prefetch(const int id) const
+    {
+        if (!ring.empty())
+        {
+            trading::prefetch(&ring[slotOf(id)]);
+        }
+    }
+
+    std::size_t RingIdIndex::memoryUsage() const
+    {
+        return ring.capacity() * sizeof(Slot) + overflow.memoryUsage();
+    }
+
+    void RingIdIndex::place(const Slot& entry)
+    {
+        auto& slot = ring[slotOf(entry.id)];
+        if (slot.handle == NO_ORDER)
+        {
+            slot = entry;
+        }
+        else
+        {
+            overflow.insert(entry.id, entry.handle);
+        }
+    }
+
+    void RingIdIndex::grow(const std::size_t size)
+    {
+        std::vector<Slot> old(size, Slot { 0, NO_ORDER });
+        old.swap(ring);
+        mask = size - 1;
+        // every id goes back into the ring if its slot is free, otherwise into the overflow again
+        std::vector<Slot> spilled;
+        spilled.reserve(overflow.size());
+        overflow.forEach([&spilled](const int id, const OrderHandle handle) { spilled.push_back(Slot { id, handle }); });
+        overflow.clear();
+        for (const auto& entry: old)
+        {
+            if (entry.handle != NO_ORDER)
+            {
+                place(entry);
+            }
+        }
+        for (const auto& entry: spilled)
+        {
+            place(entry);
+        }
+    }
+}
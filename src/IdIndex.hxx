@@ -0,0 +1,85 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "FlatIdMap.hxx"
+#include "OrderPool.hxx"
+
+namespace trading
+{
+    // The ids of the resting orders of a book and their handles; the IdIndexT of BasicOrderBook.
+    // This one is a flat hash table, good for any ids, see FlatIdMap.
+    class FlatIdIndex
+    {
+    public:
+        // NO_ORDER if the id isn't there
+        OrderHandle find(const int id) const;
+
+        // false, changing nothing, if the id is already there
+        bool insert(const int id, const OrderHandle handle);
+
+        void erase(const int id);
+
+        std::size_t size() const;
+
+        // makes room for the given number of ids on top of those there, adding them won't call malloc
+        void reserve(const std::size_t count);
+
+        // brings what finding or inserting the id touches first into the cache
+        void prefetch(const int id) const;
+
+        std::size_t memoryUsage() const;
+
+    private:
+        FlatIdMap<OrderHandle> map;
+    };
+
+    // The same for ids handed out in sequence, where the resting orders' ids fall in a window not much wider
+    // than their number.  The handle of an id sits at id modulo the size of a ring, so a lookup is one read
+    // without hashing or probing.  An id whose slot is taken by an older order still resting goes to a
+    // FlatIdMap on the side, and once that holds more than a few the ring doubles.
+    class RingIdIndex
+    {
+    public:
+        OrderHandle find(const int id) const;
+
+        bool insert(const int id, const OrderHandle handle);
+
+        void erase(const int id);
+
+        std::size_t size() const;
+
+        void reserve(const std::size_t count);
+
+        void prefetch(const int id) const;
+
+        std::size_t memoryUsage() const;
+
+    private:
+        struct Slot
+        {
+            int id;
+            // NO_ORDER for a free slot
+            OrderHandle handle;
+        };
+
+        // a power of two in size
+        std::vector<Slot> ring;
+        std::size_t mask = 0;
+        FlatIdMap<OrderHandle> overflow;
+        std::size_t count = 0;
+
+        std::size_t slotOf(const int id) const
+        {
+            return static_cast<std::uint32_t>(id) & mask;
+        }
+
+        // into its slot of the ring, or the overflow if that's taken
+        void place(const Slot& entry);
+
+        // moves everything into a ring of the new size
+        void grow(const std::size_t size);
+    };
+}
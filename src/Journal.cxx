@@ -0,0 +1,427 @@
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "Common.hxx"
+#include "BinaryProtocol.hxx"
+#include "Journal.hxx"
+
+namespace trading
+{
+    namespace
+    {
+        const char MAGIC[8] = { 'O', 'B', 'J', 'O', 'U', 'R', 'N', 'L' };
+        // 2 added mass cancels and owner records, 3 the maker, taker and maker's leaves to fills
+        const std::uint32_t VERSION = 3;
+
+#pragma pack(push, 1)
+        struct Header
+        {
+            char magic[8];
+            std::uint32_t version;
+            // the price scale the ticks of the records are in
+            std::int32_t decimals;
+            std::int64_t tickUnits;
+        };
+
+        struct FillRecord
+        {
+            std::uint8_t type;
+            std::int32_t price;
+            std::int32_t quantity;
+            std::int32_t makerId;
+            std::int32_t takerId;
+            std::int32_t makerLeaves;
+        };
+
+        struct OwnerRecord
+        {
+            std::uint8_t type;
+            std::int32_t owner;
+        };
+#pragma pack(pop)
+
+        static_assert(sizeof(Header) == 24, "Header must be packed");
+        static_assert(sizeof(FillRecord) == 21, "FillRecord must be packed");
+
+        // the file is little-endian, swap only on big-endian hosts
+        std::int32_t littleEndian(const std::int32_t value)
+        {
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+            return static_cast<std::int32_t>(__builtin_bswap32(static_cast<std::uint32_t>(value)));
+#else
+            return value;
+#endif
+        }
+
+        // 0 for anything that isn't a journal record
+        std::size_t recordSize(const char* data)
+        {
+            switch (static_cast<std::uint8_t>(data[0]))
+            {
+                case static_cast<std::uint8_t>(binary::MessageType::Order):
+                case static_cast<std::uint8_t>(binary::MessageType::Amend):
+                case static_cast<std::uint8_t>(binary::MessageType::Cancel):
+                case static_cast<std::uint8_t>(binary::MessageType::MassCancel):
+                    return binary::messageSize(data);
+                case Journal::FILL_RECORD:
+                    return sizeof(FillRecord);
+                case Journal::OWNER_RECORD:
+                    return sizeof(OwnerRecord);
+                default:
+                    return 0;
+            }
+        }
+
+        // the type goes last: a record cut short by a crash reads as the end of the journal
+        template <typename Record>
+        void append(char* out, const Record& record)
+        {
+            const auto bytes = reinterpret_cast<const char*>(&record);
+            std::memcpy(out + 1, bytes + 1, sizeof(Record) - 1);
+            out[0] = bytes[0];
+        }
+
+        void ignoreFill(void*, const Fill&)
+        {}
+
+        std::size_t fileSize(const int fd)
+        {
+            struct stat status;
+            if (::fstat(fd, &status) != 0)
+            {
+                LOG_AND_THROW("Cannot read the size of the journal: " << std::strerror(errno));
+            }
+            return static_cast<std::size_t>(status.st_size);
+        }
+    }
+
+    const std::uint8_t Journal::FILL_RECORD;
+    const std::uint8_t Journal::OWNER_RECORD;
+
+    Journal::Journal(const std::string& path, const PriceScale& scale, const JournalConfig& _config):
+        config(_config)
+    {
+        fd = ::open(path.c_str(), O_RDWR | O_CREAT, 0644);
+        if (fd < 0)
+        {
+            LOG_AND_THROW("Cannot open the journal " << path << ": " << std::strerror(errno));
+        }
+
+        try
+        {
+            const auto size = fileSize(fd);
+            const Header expected { { MAGIC[0], MAGIC[1], MAGIC[2], MAGIC[3], MAGIC[4], MAGIC[5], MAGIC[6], MAGIC[7] },
+                VERSION, scale.decimals(), scale.toFixed(1) };
+            if (size == 0)
+            {
+                map(std::max(config.preallocate, sizeof(Header)));
+                std::memcpy(data, &expected, sizeof(Header));
+                used = sizeof(Header);
+                sync();
+                return;
+            }
+
+            if (size < sizeof(Header))
+            {
+                LOG_AND_THROW(path << " is too short for a journal");
+            }
+            map(size);
+            Header header;
+            std::memcpy(&header, data, sizeof(Header));
+            if (std::memcmp(header.magic, MAGIC, sizeof(MAGIC)) != 0 || header.version != VERSION)
+            {
+                LOG_AND_THROW(path << " is not a journal of this version");
+            }
+            if (header.decimals != expected.decimals || header.tickUnits != expected.tickUnits)
+            {
+                LOG_AND_THROW("The journal " << path << " has prices of a different tick size");
+            }
+
+            // a record is complete once its type is there, see append
+            used = sizeof(Header);
+            while (used < capacity && data[used] != 0)
+            {
+                const auto record = recordSize(data + used);
+                if (record == 0 || used + record > capacity)
+                {
+                    LOG_AND_THROW("Corrupt record in the journal " << path << " at offset " << used);
+                }
+                used += record;
+            }
+            synced = used;
+        }
+        catch (...)
+        {
+            unmap();
+            ::close(fd);
+            throw;
+        }
+    }
+
+    Journal::~Journal()
+    {
+        try
+        {
+            if (config.durability != Durability::None)
+            {
+                sync();
+            }
+        }
+        catch (const TradingError&)
+        {} // already logged, there is nobody to tell
+        unmap();
+        ::close(fd);
+    }
+
+    char* Journal::reserve(const std::size_t bytes)
+    {
+        if (used + bytes > capacity)
+        {
+            // the pages already written stay in the page cache, dirty, across the remapping
+            map(capacity + std::max(config.preallocate, bytes));
+        }
+        return data + used;
+    }
+
+    void Journal::order(const LimitOrder& order)
+    {
+        this->order(order, nullptr, 0);
+    }
+
+    void Journal::order(const LimitOrder& order, const Fill* fills, const std::size_t count)
+    {
+        // all the room at once, nothing is written unless everything fits
+        reserve((order.owner != 0 ? sizeof(OwnerRecord) : 0) + sizeof(binary::OrderMessage)
+            + count * sizeof(FillRecord));
+        if (order.owner != 0)
+        {
+            const OwnerRecord record { OWNER_RECORD, littleEndian(order.owner) };
+            append(data + used, record);
+            used += sizeof(record);
+        }
+        const binary::OrderMessage message { static_cast<std::uint8_t>(binary::MessageType::Order),
+            static_cast<std::uint8_t>(order.side), littleEndian(order.id), littleEndian(order.quantity),
+            littleEndian(order.price) };
+        append(data + used, message);
+        used += sizeof(message);
+        for (std::size_t i = 0; i < count; ++i)
+        {
+            const auto& fill = fills[i];
+            const FillRecord record { FILL_RECORD, littleEndian(fill.filledPrice), littleEndian(fill.filledQty),
+                littleEndian(fill.makerId), littleEndian(fill.takerId), littleEndian(fill.makerLeaves) };
+            append(data + used, record);
+            used += sizeof(record);
+        }
+        appended();
+    }
+
+    void Journal::amend(const int id, const int quantity)
+    {
+        const binary::AmendMessage message { static_cast<std::uint8_t>(binary::MessageType::Amend),
+            littleEndian(id), littleEndian(quantity) };
+        append(reserve(sizeof(message)), message);
+        used += sizeof(message);
+        appended();
+    }
+
+    void Journal::cancel(const int id)
+    {
+        const binary::CancelMessage message { static_cast<std::uint8_t>(binary::MessageType::Cancel),
+            littleEndian(id) };
+        append(reserve(sizeof(message)), message);
+        used += sizeof(message);
+        appended();
+    }
+
+    void Journal::massCancel(const MassCancel& request)
+    {
+        const binary::MassCancelMessage message { static_cast<std::uint8_t>(binary::MessageType::MassCancel),
+            static_cast<std::uint8_t>(request.scope), static_cast<std::uint8_t>(request.side),
+            littleEndian(request.from), littleEndian(request.to) };
+        append(reserve(sizeof(message)), message);
+        used += sizeof(message);
+        appended();
+    }
+
+    void Journal::fill(const Fill& fill)
+    {
+        const FillRecord record { FILL_RECORD, littleEndian(fill.filledPrice), littleEndian(fill.filledQty),
+            littleEndian(fill.makerId), littleEndian(fill.takerId), littleEndian(fill.makerLeaves) };
+        append(reserve(sizeof(record)), record);
+        used += sizeof(record);
+        appended();
+    }
+
+    void Journal::appended()
+    {
+        if (config.durability == Durability::Sync)
+        {
+            sync();
+        }
+    }
+
+    void Journal::commit()
+    {
+        if (config.durability != Durability::None)
+        {
+            sync();
+        }
+    }
+
+    void Journal::sync()
+    {
+        if (used == synced)
+        {
+            return;
+        }
+        // msync wants a page aligned start; on Linux it writes the range back like fdatasync would
+        const auto page = static_cast<std::size_t>(::sysconf(_SC_PAGESIZE));
+        const auto start = synced / page * page;
+        if (::msync(data + start, used - start, MS_SYNC) != 0)
+        {
+            LOG_AND_THROW("Cannot sync the journal: " << std::strerror(errno));
+        }
+        synced = used;
+    }
+
+    void Journal::map(const std::size_t size)
+    {
+        if (size > fileSize(fd))
+        {
+            // allocates the blocks now, so that a full disk shows here and not as a SIGBUS on a write
+            const auto res = ::posix_fallocate(fd, 0, size);
+            if (res != 0)
+            {
+                LOG_AND_THROW("Cannot allocate " << size << " bytes for the journal: " << std::strerror(res));
+            }
+            if (config.durability != Durability::None && ::fdatasync(fd) != 0)
+            {
+                LOG_AND_THROW("Cannot sync the size of the journal: " << std::strerror(errno));
+            }
+        }
+        const auto address = ::mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        if (address == MAP_FAILED)
+        {
+            LOG_AND_THROW("Cannot map the journal: " << std::strerror(errno));
+        }
+        // only now, a failure above leaves the old mapping in use
+        unmap();
+        data = static_cast<char*>(address);
+        capacity = size;
+    }
+
+    void Journal::unmap()
+    {
+        if (data != nullptr)
+        {
+            ::munmap(data, capacity);
+            data = nullptr;
+            capacity = 0;
+        }
+    }
+
+    std::size_t Journal::size() const
+    {
+        return used - sizeof(Header);
+    }
+
+    std::size_t Journal::fills(OrderBook::FillHandler onFill, void* context, const std::size_t from) const
+    {
+        if (from > size())
+        {
+            LOG_AND_THROW("The journal has " << size() << " bytes, not " << from);
+        }
+        std::size_t res = 0;
+        for (auto pos = sizeof(Header) + from; pos < used; pos += recordSize(data + pos))
+        {
+            if (static_cast<std::uint8_t>(data[pos]) == FILL_RECORD)
+            {
+                FillRecord record;
+                std::memcpy(&record, data + pos, sizeof(record));
+                onFill(context, Fill { littleEndian(record.price), littleEndian(record.quantity),
+                    littleEndian(record.makerId), littleEndian(record.takerId), littleEndian(record.makerLeaves) });
+                ++res;
+            }
+        }
+        return res;
+    }
+
+    template <typename Book>
+    std::size_t Journal::replay(Book& book, const std::size_t from) const
+    {
+        if (from > size())
+        {
+            LOG_AND_THROW("The journal has " << size() << " bytes, not " << from);
+        }
+        Header header;
+        std::memcpy(&header, data, sizeof(Header));
+        if (header.decimals != book.getScale().decimals() || header.tickUnits != book.getScale().toFixed(1))
+        {
+            LOG_AND_THROW("The journal has prices of a different tick size than the book");
+        }
+
+        std::size_t commands = 0;
+        // of the order which comes next
+        int owner = 0;
+        for (auto pos = sizeof(Header) + from; pos < used; pos += recordSize(data + pos))
+        {
+            switch (static_cast<std::uint8_t>(data[pos]))
+            {
+                case static_cast<std::uint8_t>(binary::MessageType::Order):
+                {
+                    binary::OrderMessage message;
+                    binary::decode(data + pos, message);
+                    book.add(LimitOrder { message.id, static_cast<Side>(message.side), message.price, message.quantity, 0,
+                        false, owner }, &ignoreFill, nullptr);
+                    owner = 0;
+                    ++commands;
+                    break;
+                }
+                case static_cast<std::uint8_t>(binary::MessageType::Amend):
+                {
+                    binary::AmendMessage message;
+                    binary::decode(data + pos, message);
+                    book.amend(message.id, message.quantity);
+                    ++commands;
+                    break;
+                }
+                case static_cast<std::uint8_t>(binary::MessageType::Cancel):
+                {
+                    binary::CancelMessage message;
+                    binary::decode(data + pos, message);
+                    book.cancel(message.id);
+                    ++commands;
+                    break;
+                }
+                case static_cast<std::uint8_t>(binary::MessageType::MassCancel):
+                {
+                    binary::MassCancelMessage message;
+                    binary::decode(data + pos, message);
+                    book.cancelAll(MassCancel { static_cast<CancelScope>(message.scope), static_cast<Side>(message.side),
+                        message.from, message.to });
+                    ++commands;
+                    break;
+                }
+                case OWNER_RECORD:
+                {
+                    OwnerRecord record;
+                    std::memcpy(&record, data + pos, sizeof(record));
+                    owner = littleEndian(record.owner);
+                    break;
+                }
+                default:
+                    // a fill, the book makes it again
+                    break;
+            }
+        }
+        return commands;
+    }
+
+    template std::size_t Journal::replay<OrderBook>(OrderBook& book, const std::size_t from) const;
+    template std::size_t Journal::replay<LadderOrderBook>(LadderOrderBook& book, const std::size_t from) const;
+}
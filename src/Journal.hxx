@@ -0,0 +1,105 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#include "LimitOrder.hxx"
+#include "OrderBook.hxx"
+#include "PriceScale.hxx"
+
+namespace trading
+{
+    enum class Durability: std::uint8_t
+    {
+        // the kernel writes the pages back when it likes: survives the process dying, not the machine
+        None,
+        // commit() syncs everything appended since the last commit, one sync for a whole batch
+        Batch,
+        // every record is synced as it's appended
+        Sync
+    };
+
+    struct JournalConfig
+    {
+        Durability durability = Durability::Batch;
+        // the file is allocated in steps of this size, so appending rarely has to grow it
+        std::size_t preallocate = 64 << 20;
+    };
+
+    // Write-ahead journal of the commands a book accepted and the fills they made, in a memory-mapped file.
+    // After a header naming the price scale, records follow back to back: orders, amends and cancels in their
+    // binary protocol layout (see BinaryProtocol.hxx), as are mass cancels, fills as FILL_RECORD, and the owner of
+    // an order, if it has one, as an OWNER_RECORD just before it. The preallocated rest of the
+    // file is zeros, so the records end at the first zero byte.
+    // A book comes back by replaying the commands into it; the fills, with their maker and taker, are there for
+    // whoever reads the journal and aren't needed, matching the same commands again makes the same fills.
+    class Journal
+    {
+    public:
+        static const std::uint8_t FILL_RECORD = 0x10;
+        static const std::uint8_t OWNER_RECORD = 0x11;
+
+        // opens the journal, or creates it; new records go after the ones already there.
+        // Throws if the file can't be mapped or was written for a different price scale.
+        Journal(const std::string& path, const PriceScale& scale, const JournalConfig& config = JournalConfig());
+
+        Journal(const Journal&) = delete;
+        Journal& operator=(const Journal&) = delete;
+
+        // syncs what's left, unless the durability is None
+        ~Journal();
+
+        // price in ticks
+        void order(const LimitOrder& order);
+
+        // the order and the fills it made, appended together once the book is done with it: nothing is written
+        // if the journal can't grow, and a journal that fails can't leave a match half done
+        void order(const LimitOrder& order, const Fill* fills, const std::size_t count);
+
+        void amend(const int id, const int quantity);
+
+        void cancel(const int id);
+
+        void massCancel(const MassCancel& request);
+
+        void fill(const Fill& fill);
+
+        // group commit: makes the records appended since the last commit durable, with Batch
+        void commit();
+
+        // applies the journaled commands from the given size() on to the book, which should be empty or restored
+        // from a snapshot taken at that size, and returns how many there were; throws if the book rejects one,
+        // since the journal only has the ones it accepted
+        template <typename Book>
+        std::size_t replay(Book& book, const std::size_t from = 0) const;
+
+        // hands the journaled fills from the given size() on to onFill, as the book made them, and returns how
+        // many there were; who traded with whom without matching anything again
+        std::size_t fills(OrderBook::FillHandler onFill, void* context, const std::size_t from = 0) const;
+
+        // bytes of records, without the header
+        std::size_t size() const;
+
+    private:
+        const JournalConfig config;
+        int fd = -1;
+        char* data = nullptr;
+        std::size_t capacity = 0;
+        // end of the records
+        std::size_t used = 0;
+        // records before this are synced
+        std::size_t synced = 0;
+
+        char* reserve(const std::size_t bytes);
+
+        void appended();
+
+        void sync();
+
+        // maps the file, grown to the size if it's shorter, in place of the mapping there was
+        void map(const std::size_t size);
+
+        void unmap();
+    };
+}
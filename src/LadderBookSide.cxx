@@ -0,0 +1,293 @@
+#include <algorithm>
+
+#include "Common.hxx"
+#include "LadderBookSide.hxx"
+
+namespace trading
+{
+    namespace
+    {
+        const int BITS = 64;
+
+        int roundCapacity(const int capacity)
+        {
+            if (capacity <= 0 || capacity > MAX_LADDER_CAPACITY)
+            {
+                LOG_AND_THROW("Ladder capacity must be positive and at most " << MAX_LADDER_CAPACITY << ", but is "
+                    << capacity);
+            }
+            int res = BITS;
+            while (res < capacity)
+            {
+                res *= 2;
+            }
+            return res;
+        }
+    }
+
+    template <typename Level>
+    LadderBookSide<Level>::LadderBookSide(const int capacity):
+        slots(roundCapacity(capacity)),
+        occupied(slots.size() / BITS, 0)
+    {}
+
+    template <typename Level>
+    bool LadderBookSide<Level>::empty() const
+    {
+        return count == 0;
+    }
+
+    template <typename Level>
+    int LadderBookSide<Level>::depth() const
+    {
+        return count;
+    }
+
+    template <typename Level>
+    int LadderBookSide<Level>::capacity() const
+    {
+        return static_cast<int>(slots.size());
+    }
+
+    template <typename Level>
+    bool LadderBookSide<Level>::fits(const int ticks) const
+    {
+        if (count == 0)
+        {
+            return true;
+        }
+        const auto span = std::int64_t(std::max(high, ticks)) - std::min(low, ticks) + 1;
+        return span <= MAX_LADDER_CAPACITY;
+    }
+
+    template <typename Level>
+    Level& LadderBookSide<Level>::level(const int ticks)
+    {
+        fit(ticks);
+        const auto index = ticks - base;
+        if (!isOccupied(index))
+        {
+            occupied[index / BITS] |= std::uint64_t(1) << (index % BITS);
+            if (count == 0)
+            {
+                low = high = ticks;
+            }
+            else
+            {
+                low = std::min(low, ticks);
+                high = std::max(high, ticks);
+            }
+            ++count;
+        }
+        return slots[index];
+    }
+
+    template <typename Level>
+    Level* LadderBookSide<Level>::find(const int ticks)
+    {
+        const auto res = const_cast<const LadderBookSide*>(this)->find(ticks);
+        return const_cast<Level*>(res);
+    }
+
+    template <typename Level>
+    const Level* LadderBookSide<Level>::find(const int ticks) const
+    {
+        const auto index = indexOf(ticks);
+        if (index < 0 || !isOccupied(index))
+        {
+            return nullptr;
+        }
+        return &slots[index];
+    }
+
+    template <typename Level>
+    void LadderBookSide<Level>::erase(const int ticks)
+    {
+        const auto index = indexOf(ticks);
+        if (index < 0 || !isOccupied(index))
+        {
+            return;
+        }
+        occupied[index / BITS] &= ~(std::uint64_t(1) << (index % BITS));
+        --count;
+        if (count > 0)
+        {
+            if (ticks == low)
+            {
+                low = base + scanUp(index);
+            }
+            if (ticks == high)
+            {
+                high = base + scanDown(index);
+            }
+        }
+    }
+
+    template <typename Level>
+    int LadderBookSide<Level>::lowest() const
+    {
+        return low;
+    }
+
+    template <typename Level>
+    int LadderBookSide<Level>::highest() const
+    {
+        return high;
+    }
+
+    template <typename Level>
+    bool LadderBookSide<Level>::nextAbove(int& ticks) const
+    {
+        if (count == 0 || ticks >= high)
+        {
+            return false;
+        }
+        ticks = base + scanUp(std::max(ticks + 1, low) - base);
+        return true;
+    }
+
+    template <typename Level>
+    bool LadderBookSide<Level>::nextBelow(int& ticks) const
+    {
+        if (count == 0 || ticks <= low)
+        {
+            return false;
+        }
+        ticks = base + scanDown(std::min(ticks - 1, high) - base);
+        return true;
+    }
+
+    template <typename Level>
+    int LadderBookSide<Level>::top(const bool descending, int skip, const int maxLevels, LevelRef* out) const
+    {
+        int res = 0;
+        if (count == 0)
+        {
+            return res;
+        }
+        for (auto i = (descending ? high : low) - base; i >= 0 && i < capacity() && res < maxLevels;
+            i = descending ? scanDown(i - 1) : scanUp(i + 1))
+        {
+            if (skip > 0)
+            {
+                --skip;
+                continue;
+            }
+            out[res++] = LevelRef { base + i, &slots[i] };
+            if (descending ? i == 0 : i + 1 == capacity())
+            {
+                break;
+            }
+        }
+        return res;
+    }
+
+    template <typename Level>
+    std::size_t LadderBookSide<Level>::memoryUsage() const
+    {
+        std::size_t res = slots.capacity() * sizeof(Level) + occupied.capacity() * sizeof(std::uint64_t);
+        for (const auto& level: slots)
+        {
+            res += level.memoryUsage();
+        }
+        return res;
+    }
+
+    template <typename Level>
+    int LadderBookSide<Level>::indexOf(const int ticks) const
+    {
+        const auto index = std::int64_t(ticks) - base;
+        return index >= 0 && index < capacity() ? static_cast<int>(index) : -1;
+    }
+
+    template <typename Level>
+    bool LadderBookSide<Level>::isOccupied(const int index) const
+    {
+        return (occupied[index / BITS] >> (index % BITS)) & 1;
+    }
+
+    template <typename Level>
+    int LadderBookSide<Level>::scanUp(const int index) const
+    {
+        auto word = index / BITS;
+        auto bits = occupied[word] & (~std::uint64_t(0) << (index % BITS));
+        const auto words = static_cast<int>(occupied.size());
+        while (bits == 0)
+        {
+            if (++word == words)
+            {
+                return -1;
+            }
+            bits = occupied[word];
+        }
+        return word * BITS + __builtin_ctzll(bits);
+    }
+
+    template <typename Level>
+    int LadderBookSide<Level>::scanDown(const int index) const
+    {
+        auto word = index / BITS;
+        auto bits = occupied[word] & (~std::uint64_t(0) >> (BITS - 1 - index % BITS));
+        while (bits == 0)
+        {
+            if (--word < 0)
+            {
+                return -1;
+            }
+            bits = occupied[word];
+        }
+        return word * BITS + BITS - 1 - __builtin_clzll(bits);
+    }
+
+    template <typename Level>
+    void LadderBookSide<Level>::fit(const int ticks)
+    {
+        auto newCapacity = capacity();
+        if (count == 0)
+        {
+            // ticks are positive, so the window can't start below INT_MIN
+            base = ticks - newCapacity / 2;
+            return;
+        }
+
+        if (indexOf(ticks) >= 0)
+        {
+            return;
+        }
+        if (!fits(ticks))
+        {
+            LOG_AND_THROW("Price of " << ticks << " ticks is too far from the ladder between " << low << " and "
+                << high);
+        }
+
+        // keep at least half of the window free, so that the window doesn't move on every new price, unless that
+        // takes more than the widest window
+        const auto newLow = std::min(low, ticks);
+        const auto newHigh = std::max(high, ticks);
+        const auto span = newHigh - newLow + 1;
+        while (span * 2 > newCapacity && newCapacity < MAX_LADDER_CAPACITY)
+        {
+            newCapacity *= 2;
+        }
+        const auto newBase = newLow - (newCapacity - span) / 2;
+
+        std::vector<Level> newSlots(newCapacity);
+        std::vector<std::uint64_t> newOccupied(newCapacity / BITS, 0);
+        for (auto i = scanUp(low - base); i >= 0 && base + i <= high; i = scanUp(i + 1))
+        {
+            const auto newIndex = base + i - newBase;
+            newSlots[newIndex] = std::move(slots[i]);
+            newOccupied[newIndex / BITS] |= std::uint64_t(1) << (newIndex % BITS);
+            if (i + 1 == capacity())
+            {
+                break;
+            }
+        }
+        slots.swap(newSlots);
+        occupied.swap(newOccupied);
+        base = newBase;
+    }
+
+    template class LadderBookSide<PriceLevel>;
+    template class LadderBookSide<RankedPriceLevel>;
+}
@@ -0,0 +1,87 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "PriceLevel.hxx"
+
+namespace trading
+{
+    // initial width of a ladder window in ticks
+    constexpr int DEFAULT_LADDER_CAPACITY = 1024;
+
+    // the widest a window grows, an order further away from the rest of its side doesn't fit
+    constexpr int MAX_LADDER_CAPACITY = 1 << 20;
+
+    // One side of the book as a contiguous array of price levels indexed by tick, around the
+    // current prices.  A bitmap of occupied slots finds the next level without touching empty ones.
+    // The window recenters, or grows up to MAX_LADDER_CAPACITY, when an order arrives outside of it.
+    // Level is PriceLevel or RankedPriceLevel, as the book's QueueT says.
+    template <typename Level>
+    class LadderBookSide
+    {
+    public:
+        // capacity is the initial window width in ticks, rounded up to a power of two of at least 64
+        explicit LadderBookSide(const int capacity = DEFAULT_LADDER_CAPACITY);
+
+        bool empty() const;
+
+        // number of occupied price levels
+        int depth() const;
+
+        // whether level() can make room for the tick, without a window wider than MAX_LADDER_CAPACITY
+        bool fits(const int ticks) const;
+
+        // returns the level at the given tick, creating it if needed; the tick must fit
+        Level& level(const int ticks);
+
+        Level* find(const int ticks);
+
+        const Level* find(const int ticks) const;
+
+        // drops an empty level
+        void erase(const int ticks);
+
+        // lowest and highest occupied tick, the side must not be empty
+        int lowest() const;
+
+        int highest() const;
+
+        // move ticks to the next occupied level above/below, return false if there is none
+        bool nextAbove(int& ticks) const;
+
+        bool nextBelow(int& ticks) const;
+
+        // up to maxLevels levels starting skip levels from the top, highest first when descending,
+        // returns how many were written to out
+        int top(const bool descending, const int skip, const int maxLevels, LevelRef* out) const;
+
+        // bytes held by the levels and their rank indexes
+        std::size_t memoryUsage() const;
+
+        // width of the window in ticks
+        int capacity() const;
+
+    private:
+        std::vector<Level> slots;
+        std::vector<std::uint64_t> occupied;
+        // tick of slots[0]
+        int base = 0;
+        int count = 0;
+        int low = 0;
+        int high = 0;
+
+        bool isOccupied(const int index) const;
+
+        // index of the first occupied slot at or above/below index, or -1
+        int scanUp(const int index) const;
+
+        int scanDown(const int index) const;
+
+        // slot of the tick, or -1 if the window doesn't cover it
+        int indexOf(const int ticks) const;
+
+        // makes sure ticks maps to a slot, moving the window if required
+        void fit(const int ticks);
+    };
+}
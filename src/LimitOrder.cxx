@@ -16,6 +16,17 @@ namespace trading
 		}
 	}
 
+	LimitOrder::LimitOrder(const int _id, const Side _side, const int _price, const int _quantity, const int _filledQty,
+		const bool _isCancelled, const int _owner):
+		id(_id),
+		price(_price),
+		quantity(_quantity),
+		filledQty(_filledQty),
+		owner(_owner),
+		side(_side),
+		isCancelled(_isCancelled)
+	{}
+
 	std::string LimitOrder::status() const
 	{
 		if (isCancelled) 
@@ -54,20 +65,4 @@ namespace trading
 	{
 		filledQty += fillQty;
 	}
-
-	bool LimitOrder::canCross(const LimitOrder& other) const
-	{
-		if (side == other.side)
-			return false;
-
-		switch (side) {
-			case Side::Buy:
-				return price >= other.price;
-			case Side::Sell:
-				return price <= other.price;
-
-			default:
-				LOG_AND_THROW("Bad side");
-		}
-	}
 }
@@ -1,7 +1,7 @@
 #pragma once
 
 #include <iostream>
-#include <memory>
+#include <string>
 
 namespace trading
 {
@@ -13,15 +13,26 @@ namespace trading
 
 	std::ostream& operator<<(std::ostream& out, const Side side);
 
+    // The fields are laid out widest first, so that the order packs into 24 bytes; the constructor takes them
+    // in the order they are usually written in.
     struct LimitOrder
     {
         int id;
-        Side side;
-        double price;
+        // in ticks, see PriceScale
+        int price;
         int quantity;
 		int filledQty;
+		// whoever sent the order, so that all of theirs can be cancelled at once; 0 for nobody in particular
+		int owner = 0;
+        Side side;
 		bool isCancelled = false;
 
+		// all zero with LimitOrder {}
+		LimitOrder() = default;
+
+		LimitOrder(const int _id, const Side _side, const int _price, const int _quantity, const int _filledQty = 0,
+			const bool _isCancelled = false, const int _owner = 0);
+
 		std::string status() const;
 
 		int leaves() const;
@@ -29,9 +40,8 @@ namespace trading
 		bool fullyFilled() const;
 
 		void addFill(int fillQty);
-
-		bool canCross(const LimitOrder& other) const;
     };
 
-	using LimitOrderPtr = std::shared_ptr<LimitOrder>;
+	// orders are owned by the book, this points to its copy and stays valid while the order rests in it
+	using LimitOrderPtr = const LimitOrder*;
 }
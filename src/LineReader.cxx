@@ -0,0 +1,99 @@
+#include <algorithm>
+#include <cstring>
+
+#include "LineReader.hxx"
+
+namespace trading
+{
+    LineReader::LineReader(std::istream& _in, const std::size_t blockSize):
+        in(_in),
+        buffer(blockSize)
+    {}
+
+    bool LineReader::next(std::string_view& line)
+    {
+        std::size_t scanned = begin;
+        while (true)
+        {
+            const auto eol = lookahead != nullptr ? lookahead
+                : static_cast<const char*>(std::memchr(buffer.data() + scanned, '\n', end - scanned));
+            lookahead = nullptr;
+            if (eol != nullptr)
+            {
+                const auto pos = static_cast<std::size_t>(eol - buffer.data());
+                line = std::string_view(buffer.data() + begin, pos - begin);
+                begin = pos + 1;
+                return true;
+            }
+
+            const auto pending = end - begin;
+            if (!fill())
+            {
+                // the last line without an end of line
+                if (pending == 0)
+                {
+                    return false;
+                }
+                line = std::string_view(buffer.data() + begin, pending);
+                begin = end;
+                return true;
+            }
+            scanned = begin + pending;
+        }
+    }
+
+    bool LineReader::endOfBatch()
+    {
+        if (lookahead == nullptr)
+        {
+            lookahead = static_cast<const char*>(std::memchr(buffer.data() + begin, '\n', end - begin));
+        }
+        return lookahead == nullptr;
+    }
+
+    bool LineReader::fill()
+    {
+        if (!in)
+        {
+            return false;
+        }
+
+        const auto pending = end - begin;
+        std::memmove(buffer.data(), buffer.data() + begin, pending);
+        begin = 0;
+        end = pending;
+        if (end == buffer.size())
+        {
+            // a line longer than the buffer
+            buffer.resize(buffer.size() * 2);
+        }
+
+        // Waits for the first character only, then takes whatever else the stream has without waiting, so that
+        // on a pipe a line is handed out once it's there, not once the block is full. A file has all of its rest
+        // available, so it's still read in blocks.
+        auto& source = *in.rdbuf();
+        if (std::istream::traits_type::eq_int_type(source.sgetc(), std::istream::traits_type::eof()))
+        {
+            in.setstate(std::ios::eofbit);
+            return false;
+        }
+        std::size_t got = 0;
+        while (end + got < buffer.size())
+        {
+            const auto available = source.in_avail();
+            if (available <= 0)
+            {
+                break;
+            }
+            const auto wanted = std::min(static_cast<std::size_t>(available), buffer.size() - end - got);
+            const auto read = source.sgetn(buffer.data() + end + got, static_cast<std::streamsize>(wanted));
+            if (read <= 0)
+            {
+                break;
+            }
+            got += static_cast<std::size_t>(read);
+        }
+        end += got;
+        return got > 0;
+    }
+}
@@ -0,0 +1,34 @@
+#pragma once
+
+#include <iostream>
+#include <string_view>
+#include <vector>
+
+namespace trading
+{
+    // Splits a stream into lines, reading it in large blocks instead of a getline per line, but never waiting
+    // for a block to fill up once a line is complete. A line stays valid until the next call.
+    class LineReader
+    {
+    public:
+        explicit LineReader(std::istream& _in, const std::size_t blockSize = 1 << 20);
+
+        // the next line without its end of line, false at the end of the input
+        bool next(std::string_view& line);
+
+        // true when no complete line is left in the block, so the next call reads more input; a good
+        // point to flush the output rather than hold it while waiting
+        bool endOfBatch();
+
+    private:
+        std::istream& in;
+        std::vector<char> buffer;
+        std::size_t begin = 0;
+        std::size_t end = 0;
+        // the end of the next line if endOfBatch() already found it
+        const char* lookahead = nullptr;
+
+        // moves what's left to the front and reads more, false if there was nothing more to read
+        bool fill();
+    };
+}
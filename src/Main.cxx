@@ -1,29 +1,641 @@
 #include <iostream>
+#include <fstream>
+#include <chrono>
+#include <csignal>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <vector>
 
 #include "Common.hxx"
 #include "OrderBook.hxx"
 #include "CommandProcessor.hxx"
+#include "LineReader.hxx"
+#include "OutputSink.hxx"
+#include "BinaryProtocol.hxx"
+#include "BinaryProcessor.hxx"
+#include "Engine.hxx"
+#include "Journal.hxx"
+#include "Snapshot.hxx"
+#include "Pipeline.hxx"
+#include "RejectLog.hxx"
+#include "SharedOutput.hxx"
+#include "Stats.hxx"
 
-
-int main(int /*argc*/, const char** /*argv*/)
+namespace
 {
-	using namespace trading;
+	const double TICK_SIZE = 0.05;
+
+	struct Options
+	{
+		bool ladder = false;
+		bool binary = false;
+		bool convert = false;
+		const char* file = nullptr;
+		std::size_t flushSize = 64 * 1024;
+		std::chrono::microseconds maxDelay = std::chrono::microseconds::zero();
+		// symbol prefixed commands over this many shards, 0 for the single book
+		int shards = 0;
+		bool pin = false;
+		bool pipeline = false;
+		trading::WaitStrategy wait = trading::WaitStrategy::Yield;
+		trading::RetentionConfig retention;
+		// write-ahead journal of the single book, replayed into it first
+		const char* journal = nullptr;
+		trading::Durability durability = trading::Durability::Batch;
+		// snapshot to start from, the journal is replayed from where it was taken
+		const char* restore = nullptr;
+		// snapshot written at the end and, if set, periodically in the background
+		const char* snapshot = nullptr;
+		std::chrono::seconds snapshotEvery = std::chrono::seconds::zero();
+		// latency percentiles and counters on stderr at the end and on SIGUSR1, with hardware counters if perf
+		bool stats = false;
+		bool perf = false;
+		// rejections of the single book written to stderr per second at most, 0 for none
+		std::size_t rejectsPerSecond = 100;
+		// bytes held by each structure of the single book on stderr at the end
+		bool memory = false;
+	};
+
+	// stderr shared with the thread of a RejectLog while this lives: every write goes out in one piece
+	// and doesn't flush stdout behind the back of the thread writing it
+	class SharedErrors
+	{
+	public:
+		SharedErrors():
+			shared(std::cerr),
+			previous(std::cerr.rdbuf(&shared)),
+			previousTie(std::cerr.tie(nullptr))
+		{}
 
-	std::string cmd;
+		~SharedErrors()
+		{
+			std::cerr.rdbuf(previous);
+			std::cerr.tie(previousTie);
+		}
+
+	private:
+		trading::SharedOutput shared;
+		std::streambuf* previous;
+		std::ostream* previousTie;
+	};
+
+	// a report of several lines, written to stderr in one piece so that no rejection ends up in the middle of it
+	template <typename Report>
+	void reportErrors(const Report& report)
+	{
+		std::ostringstream text;
+		report.report(text);
+		const auto all = text.str();
+		std::cerr.write(all.data(), static_cast<std::streamsize>(all.size()));
+		std::cerr.flush();
+	}
 
-	OrderBook book(0.05);
-	CommandProcessor processor(book, std::cout);
+	volatile std::sig_atomic_t statsWanted = 0;
 
-	while (std::getline(std::cin, cmd))
+	void onStatsSignal(int)
 	{
-		//std::cout << cmd << std::endl;
-		try 
+		statsWanted = 1;
+	}
+
+	// The journal and the snapshots of the single book, as the options ask for them
+	template <typename Book>
+	class Persistence
+	{
+	public:
+		// brings the book back from the snapshot and the part of the journal after it,
+		// throws TradingError if that fails
+		Persistence(const Options& _options, Book& _book):
+			options(_options),
+			book(_book),
+			lastSnapshot(std::chrono::steady_clock::now())
 		{
-			processor.handle(cmd);
+			using namespace trading;
+
+			std::uint64_t journaled = 0;
+			if (options.restore != nullptr)
+			{
+				journaled = loadSnapshot(options.restore, book);
+			}
+			if (options.journal != nullptr)
+			{
+				JournalConfig config;
+				config.durability = options.durability;
+				journal.reset(new Journal(options.journal, book.getScale(), config));
+				const auto commands = journal->replay(book, journaled);
+				if (commands > 0)
+				{
+					LOG_LINE(std::cerr, "Recovered " << commands << " commands from " << options.journal);
+				}
+			}
+		}
+
+		trading::Journal* getJournal()
+		{
+			return journal.get();
+		}
+
+		// the log whose thread is paused while a background snapshot forks, nullptr for none
+		void setRejectLog(trading::RejectLog* _rejectLog)
+		{
+			rejectLog = _rejectLog;
+		}
+
+		// group commit, then a snapshot in the background if it's time for one
+		void endOfBatch()
+		{
+			if (journal)
+			{
+				journal->commit();
+			}
+			if (options.snapshot != nullptr && options.snapshotEvery.count() > 0
+				&& std::chrono::steady_clock::now() - lastSnapshot >= options.snapshotEvery)
+			{
+				// not while the log's thread may hold a lock the child needs, see BackgroundSnapshot
+				std::unique_lock<std::mutex> paused;
+				if (rejectLog != nullptr)
+				{
+					paused = rejectLog->pause();
+				}
+				if (background.start(book, options.snapshot, journaledSize()))
+				{
+					lastSnapshot = std::chrono::steady_clock::now();
+				}
+			}
+		}
+
+		// the final snapshot, in the foreground
+		void finish()
+		{
+			if (options.snapshot != nullptr)
+			{
+				background.wait();
+				trading::saveSnapshot(book, options.snapshot, journaledSize());
+			}
+		}
+
+	private:
+		const Options& options;
+		Book& book;
+		std::unique_ptr<trading::Journal> journal;
+		trading::RejectLog* rejectLog = nullptr;
+		trading::BackgroundSnapshot background;
+		std::chrono::steady_clock::time_point lastSnapshot;
+
+		std::uint64_t journaledSize() const
+		{
+			return journal ? journal->size() : 0;
+		}
+	};
+
+	template <typename Book>
+	int runText(const Options& options)
+	{
+		using namespace trading;
+
+		std::string_view cmd;
+
+		Book book(TICK_SIZE, options.retention);
+		OutputSink out(std::cout, options.flushSize, options.maxDelay);
+		BasicCommandProcessor<Book> processor(book, out);
+		LineReader reader(std::cin);
+		SharedErrors errors;
+		std::unique_ptr<RejectLog> rejectLog;
+		if (options.rejectsPerSecond > 0)
+		{
+			rejectLog.reset(new RejectLog(std::cerr, options.rejectsPerSecond));
+			processor.setRejectLog(rejectLog.get());
+		}
+
+		std::unique_ptr<Persistence<Book>> persistence;
+		try
+		{
+			persistence.reset(new Persistence<Book>(options, book));
 		}
 		catch (const TradingError&)
-		{} // we ignore this error here, since it means the command can't be processed, so we did nothing
+		{
+			return 1;
+		}
+		processor.setJournal(persistence->getJournal());
+		persistence->setRejectLog(rejectLog.get());
+
+		CommandStats stats;
+		if (options.stats)
+		{
+			if (options.perf && !stats.enablePerf())
+			{
+				LOG_LINE(std::cerr, "Hardware counters are not available");
+			}
+			processor.setStats(&stats);
+			std::signal(SIGUSR1, &onStatsSignal);
+		}
+
+		while (reader.next(cmd))
+		{
+			//std::cout << cmd << std::endl;
+			try
+			{
+				const auto res = processor.handle(cmd);
+				if (res != ParseResult::Ok && res != ParseResult::Empty)
+				{
+					LOG_LINE(std::cerr, "Cannot parse '" << cmd << "': " << describe(res));
+				}
+			}
+			catch (const TradingError&)
+			{} // the journal failing to grow or sync, already reported; the book's rejections are counted and logged instead
+
+			if (reader.endOfBatch())
+			{
+				// the answers go out once what they answer is in the journal
+				persistence->endOfBatch();
+				// don't hold the answers while waiting for more input
+				out.flush();
+			}
+			if (statsWanted != 0)
+			{
+				statsWanted = 0;
+				reportErrors(stats);
+			}
+		}
+		if (options.stats)
+		{
+			reportErrors(stats);
+		}
+		if (options.memory)
+		{
+			reportErrors(book.memoryUsage());
+		}
+
+		try
+		{
+			persistence->finish();
+		}
+		catch (const TradingError&)
+		{
+			return 1;
+		}
+
+		return 0;
+	}
+
+	template <typename Book>
+	int runPipeline(const Options& options)
+	{
+		using namespace trading;
+
+		Book book(TICK_SIZE, options.retention);
+		OutputSink out(std::cout, options.flushSize, options.maxDelay);
+		PipelineConfig config;
+		config.wait = options.wait;
+		BasicPipeline<Book> pipeline(book, out, config);
+		SharedErrors errors;
+		std::unique_ptr<RejectLog> rejectLog;
+		if (options.rejectsPerSecond > 0)
+		{
+			rejectLog.reset(new RejectLog(std::cerr, options.rejectsPerSecond));
+			pipeline.setRejectLog(rejectLog.get());
+		}
+		pipeline.run(std::cin);
+		if (options.memory)
+		{
+			reportErrors(book.memoryUsage());
+		}
+
+		return 0;
+	}
+
+	template <typename Book>
+	int runEngine(const Options& options)
+	{
+		using namespace trading;
+
+		std::string_view cmd;
+
+		// the shards log the book's rejections: stderr must not flush stdout behind the engine's back,
+		// and its writes from several threads must not mix
+		SharedOutput errors(std::cerr);
+		const auto errorBuffer = std::cerr.rdbuf(&errors);
+		std::cerr.tie(nullptr);
+
+		EngineConfig config;
+		config.shards = options.shards;
+		config.pinThreads = options.pin;
+		config.retention = options.retention;
+		BasicEngine<Book> engine(std::cout, config);
+		LineReader reader(std::cin);
+
+		while (reader.next(cmd))
+		{
+			try
+			{
+				const auto res = engine.handle(cmd);
+				if (res != ParseResult::Ok && res != ParseResult::Empty)
+				{
+					LOG_LINE(std::cerr, "Cannot parse '" << cmd << "': " << describe(res));
+				}
+			}
+			catch (const TradingError&)
+			{} // a symbol defined twice, the first definition stays
+		}
+		engine.drain();
+		std::cerr.rdbuf(errorBuffer);
+
+		return 0;
+	}
+
+	template <typename Book>
+	int runBinary(std::istream& in, const Options& options)
+	{
+		using namespace trading;
+
+		Book book(TICK_SIZE, options.retention);
+		OutputSink out(std::cout, options.flushSize, options.maxDelay);
+		BasicBinaryProcessor<Book> processor(book, out);
+		SharedErrors errors;
+		std::unique_ptr<RejectLog> rejectLog;
+		if (options.rejectsPerSecond > 0)
+		{
+			rejectLog.reset(new RejectLog(std::cerr, options.rejectsPerSecond));
+			processor.setRejectLog(rejectLog.get());
+		}
+
+		std::unique_ptr<Persistence<Book>> persistence;
+		try
+		{
+			persistence.reset(new Persistence<Book>(options, book));
+		}
+		catch (const TradingError&)
+		{
+			return 1;
+		}
+		processor.setJournal(persistence->getJournal());
+		persistence->setRejectLog(rejectLog.get());
+
+		// block reads, an incomplete message at the end of a block moves to the front for the next one
+		std::vector<char> buffer(64 * 1024);
+		std::size_t size = 0;
+		while (in)
+		{
+			in.read(buffer.data() + size, buffer.size() - size);
+			size += in.gcount();
+			try
+			{
+				const auto used = processor.handleAll(buffer.data(), size);
+				std::memmove(buffer.data(), buffer.data() + used, size - used);
+				size -= used;
+				persistence->endOfBatch();
+				out.flush();
+			}
+			catch (const TradingError&)
+			{
+				return 1;
+			}
+		}
+		if (size != 0)
+		{
+			LOG_LINE(std::cerr, "Incomplete message of " << size << " bytes at the end of the input");
+			return 1;
+		}
+		if (options.memory)
+		{
+			reportErrors(book.memoryUsage());
+		}
+
+		try
+		{
+			persistence->finish();
+		}
+		catch (const TradingError&)
+		{
+			return 1;
+		}
+
+		return 0;
+	}
+
+	// text commands on stdin to binary messages on stdout
+	int convert()
+	{
+		std::string cmd;
+		char message[trading::binary::MAX_MESSAGE_SIZE];
+		const trading::PriceScale scale(TICK_SIZE);
+		while (std::getline(std::cin, cmd))
+		{
+			const auto size = trading::binary::fromText(cmd, scale, message);
+			if (size == 0)
+			{
+				std::cerr << "Skipping " << cmd << std::endl;
+				continue;
+			}
+			std::cout.write(message, size);
+		}
+		return 0;
+	}
+
+	template <typename Book>
+	int run(const Options& options)
+	{
+		if ((options.journal != nullptr || options.restore != nullptr || options.snapshot != nullptr)
+			&& (options.shards > 0 || options.pipeline))
+		{
+			std::cerr << "Journals and snapshots are for the single book text and binary modes" << std::endl;
+			return 1;
+		}
+		if (options.stats && (options.shards > 0 || options.pipeline || options.binary))
+		{
+			std::cerr << "Statistics are for the single book text mode" << std::endl;
+			return 1;
+		}
+		if (options.memory && options.shards > 0)
+		{
+			std::cerr << "Memory reports are for the single book modes" << std::endl;
+			return 1;
+		}
+		if (options.stats && !trading::STATS_ENABLED)
+		{
+			std::cerr << "Built without ORDER_BOOK_STATS, there are no statistics" << std::endl;
+			return 1;
+		}
+		if (options.shards > 0)
+		{
+			return runEngine<Book>(options);
+		}
+		if (options.pipeline)
+		{
+			return runPipeline<Book>(options);
+		}
+		if (!options.binary)
+		{
+			return runText<Book>(options);
+		}
+		if (options.file == nullptr)
+		{
+			return runBinary<Book>(std::cin, options);
+		}
+		std::ifstream in(options.file, std::ios::binary);
+		if (!in)
+		{
+			std::cerr << "Cannot open " << options.file << std::endl;
+			return 1;
+		}
+		return runBinary<Book>(in, options);
+	}
+}
+
+int main(int argc, const char** argv)
+{
+	using namespace trading;
+
+	std::ios::sync_with_stdio(false);
+
+	Options options;
+	for (int i = 1; i < argc; ++i)
+	{
+		if (std::strcmp(argv[i], "--ladder") == 0)
+		{
+			// price levels in a tick-indexed array instead of a map
+			options.ladder = true;
+		}
+		else if (std::strcmp(argv[i], "--binary") == 0)
+		{
+			// binary messages, from the file given next or stdin
+			options.binary = true;
+			if (i + 1 < argc && argv[i + 1][0] != '-')
+			{
+				options.file = argv[++i];
+			}
+		}
+		else if (std::strcmp(argv[i], "--flush-bytes") == 0 && i + 1 < argc)
+		{
+			// write the output once this much has collected, default 64KB
+			options.flushSize = std::strtoul(argv[++i], nullptr, 10);
+		}
+		else if (std::strcmp(argv[i], "--flush-us") == 0 && i + 1 < argc)
+		{
+			// don't hold an answer longer than this many microseconds while a batch is processed
+			options.maxDelay = std::chrono::microseconds(std::strtol(argv[++i], nullptr, 10));
+		}
+		else if (std::strcmp(argv[i], "--shards") == 0 && i + 1 < argc)
+		{
+			// many symbols, see Engine.hxx for the command format
+			options.shards = std::atoi(argv[++i]);
+			if (options.shards <= 0)
+			{
+				std::cerr << "The shard count must be positive" << std::endl;
+				return 1;
+			}
+		}
+		else if (std::strcmp(argv[i], "--pin") == 0)
+		{
+			// a core per shard
+			options.pin = true;
+		}
+		else if (std::strcmp(argv[i], "--pipeline") == 0)
+		{
+			// parsing, matching and output on threads of their own, waiting on each other as given next
+			options.pipeline = true;
+			if (i + 1 < argc && argv[i + 1][0] != '-')
+			{
+				const auto wait = argv[++i];
+				if (std::strcmp(wait, "spin") == 0)
+				{
+					options.wait = WaitStrategy::Spin;
+				}
+				else if (std::strcmp(wait, "block") == 0)
+				{
+					options.wait = WaitStrategy::Block;
+				}
+				else if (std::strcmp(wait, "yield") != 0)
+				{
+					std::cerr << "Unknown wait strategy " << wait << ", spin, yield or block" << std::endl;
+					return 1;
+				}
+			}
+		}
+		else if (std::strcmp(argv[i], "--keep-orders") == 0 && i + 1 < argc)
+		{
+			// cancelled and filled orders that can still be queried, the most recent ones
+			options.retention.maxOrders = std::strtoul(argv[++i], nullptr, 10);
+		}
+		else if (std::strcmp(argv[i], "--keep-ms") == 0 && i + 1 < argc)
+		{
+			// forget cancelled and filled orders after this many milliseconds
+			options.retention.maxAge = std::chrono::milliseconds(std::strtol(argv[++i], nullptr, 10));
+		}
+		else if (std::strcmp(argv[i], "--journal") == 0 && i + 1 < argc)
+		{
+			// journal to the file given next, synced once per batch, on every record or when the OS likes
+			options.journal = argv[++i];
+			if (i + 1 < argc && argv[i + 1][0] != '-')
+			{
+				const auto durability = argv[++i];
+				if (std::strcmp(durability, "none") == 0)
+				{
+					options.durability = Durability::None;
+				}
+				else if (std::strcmp(durability, "sync") == 0)
+				{
+					options.durability = Durability::Sync;
+				}
+				else if (std::strcmp(durability, "batch") != 0)
+				{
+					std::cerr << "Unknown durability " << durability << ", none, batch or sync" << std::endl;
+					return 1;
+				}
+			}
+		}
+		else if (std::strcmp(argv[i], "--restore") == 0 && i + 1 < argc)
+		{
+			// start from the snapshot given next
+			options.restore = argv[++i];
+		}
+		else if (std::strcmp(argv[i], "--snapshot") == 0 && i + 1 < argc)
+		{
+			// snapshot to the file given next at the end, and every so many seconds if given too
+			options.snapshot = argv[++i];
+			if (i + 1 < argc && argv[i + 1][0] != '-')
+			{
+				options.snapshotEvery = std::chrono::seconds(std::strtol(argv[++i], nullptr, 10));
+			}
+		}
+		else if (std::strcmp(argv[i], "--log-rejects") == 0 && i + 1 < argc)
+		{
+			// the book's rejections written per second at most, 0 for none, default 100
+			options.rejectsPerSecond = std::strtoul(argv[++i], nullptr, 10);
+		}
+		else if (std::strcmp(argv[i], "--stats") == 0)
+		{
+			// latency percentiles and counters, with cycles and cache misses per command type if perf is given next
+			options.stats = true;
+			if (i + 1 < argc && std::strcmp(argv[i + 1], "perf") == 0)
+			{
+				options.perf = true;
+				++i;
+			}
+		}
+		else if (std::strcmp(argv[i], "--memory") == 0)
+		{
+			// bytes per structure of the book and per order at the end
+			options.memory = true;
+		}
+		else if (std::strcmp(argv[i], "--convert") == 0)
+		{
+			// text commands to binary messages
+			options.convert = true;
+		}
+		else
+		{
+			std::cerr << "Usage: " << argv[0] << " [--ladder] [--binary [file]] [--flush-bytes n] [--flush-us n] [--shards n [--pin]] [--pipeline [spin|yield|block]] [--keep-orders n] [--keep-ms n] [--journal file [none|batch|sync]] [--restore file] [--snapshot file [seconds]] [--stats [perf]] [--log-rejects n] [--memory] | --convert" << std::endl;
+			return 1;
+		}
+	}
+
+	if (options.convert)
+	{
+		return convert();
 	}
 
-	return 0;
+	return options.ladder ? run<LadderOrderBook>(options) : run<OrderBook>(options);
 }
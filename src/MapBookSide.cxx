@@ -0,0 +1,132 @@
+#include "MapBookSide.hxx"
+
+namespace trading
+{
+    template <typename Level>
+    MapBookSide<Level>::MapBookSide():
+        levels(typename Levels::key_compare(), typename Levels::allocator_type(nodes))
+    {}
+
+    template <typename Level>
+    bool MapBookSide<Level>::empty() const
+    {
+        return levels.empty();
+    }
+
+    template <typename Level>
+    int MapBookSide<Level>::depth() const
+    {
+        return static_cast<int>(levels.size());
+    }
+
+    template <typename Level>
+    bool MapBookSide<Level>::fits(const int) const
+    {
+        return true;
+    }
+
+    template <typename Level>
+    Level& MapBookSide<Level>::level(const int ticks)
+    {
+        return levels[ticks];
+    }
+
+    template <typename Level>
+    Level* MapBookSide<Level>::find(const int ticks)
+    {
+        auto iLevel = levels.find(ticks);
+        return iLevel == levels.end() ? nullptr : &iLevel->second;
+    }
+
+    template <typename Level>
+    const Level* MapBookSide<Level>::find(const int ticks) const
+    {
+        auto iLevel = levels.find(ticks);
+        return iLevel == levels.cend() ? nullptr : &iLevel->second;
+    }
+
+    template <typename Level>
+    void MapBookSide<Level>::erase(const int ticks)
+    {
+        levels.erase(ticks);
+    }
+
+    template <typename Level>
+    int MapBookSide<Level>::lowest() const
+    {
+        return levels.cbegin()->first;
+    }
+
+    template <typename Level>
+    int MapBookSide<Level>::highest() const
+    {
+        return levels.crbegin()->first;
+    }
+
+    template <typename Level>
+    bool MapBookSide<Level>::nextAbove(int& ticks) const
+    {
+        auto iLevel = levels.upper_bound(ticks);
+        if (iLevel == levels.cend())
+        {
+            return false;
+        }
+        ticks = iLevel->first;
+        return true;
+    }
+
+    template <typename Level>
+    bool MapBookSide<Level>::nextBelow(int& ticks) const
+    {
+        auto iLevel = levels.lower_bound(ticks);
+        if (iLevel == levels.cbegin())
+        {
+            return false;
+        }
+        ticks = (--iLevel)->first;
+        return true;
+    }
+
+    namespace
+    {
+        template <typename Iterator>
+        int walk(Iterator from, Iterator to, int skip, const int maxLevels, LevelRef* out)
+        {
+            int res = 0;
+            for (; from != to && res < maxLevels; ++from)
+            {
+                if (skip > 0)
+                {
+                    --skip;
+                    continue;
+                }
+                out[res++] = LevelRef { from->first, &from->second };
+            }
+            return res;
+        }
+    }
+
+    template <typename Level>
+    int MapBookSide<Level>::top(const bool descending, const int skip, const int maxLevels, LevelRef* out) const
+    {
+        if (descending)
+        {
+            return walk(levels.crbegin(), levels.crend(), skip, maxLevels, out);
+        }
+        return walk(levels.cbegin(), levels.cend(), skip, maxLevels, out);
+    }
+
+    template <typename Level>
+    std::size_t MapBookSide<Level>::memoryUsage() const
+    {
+        std::size_t res = nodes.memoryUsage();
+        for (const auto& level: levels)
+        {
+            res += level.second.memoryUsage();
+        }
+        return res;
+    }
+
+    template class MapBookSide<PriceLevel>;
+    template class MapBookSide<RankedPriceLevel>;
+}
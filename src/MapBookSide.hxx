@@ -0,0 +1,63 @@
+#pragma once
+
+#include <map>
+
+#include "NodePool.hxx"
+#include "PriceLevel.hxx"
+
+namespace trading
+{
+    // One side of the book, with price levels kept in an ordered map keyed by tick level.
+    // Works for any price range, but every lookup walks a tree. Level is PriceLevel or RankedPriceLevel,
+    // as the book's QueueT says.
+    template <typename Level>
+    class MapBookSide
+    {
+    public:
+        MapBookSide();
+        MapBookSide(const MapBookSide&) = delete;
+        MapBookSide& operator=(const MapBookSide&) = delete;
+
+        bool empty() const;
+
+        // number of occupied price levels
+        int depth() const;
+
+        // any tick has room
+        bool fits(const int ticks) const;
+
+        // returns the level at the given tick, creating it if needed
+        Level& level(const int ticks);
+
+        Level* find(const int ticks);
+
+        const Level* find(const int ticks) const;
+
+        // drops an empty level
+        void erase(const int ticks);
+
+        // lowest and highest occupied tick, the side must not be empty
+        int lowest() const;
+
+        int highest() const;
+
+        // move ticks to the next occupied level above/below, return false if there is none
+        bool nextAbove(int& ticks) const;
+
+        bool nextBelow(int& ticks) const;
+
+        // up to maxLevels levels starting skip levels from the top, highest first when descending,
+        // returns how many were written to out
+        int top(const bool descending, const int skip, const int maxLevels, LevelRef* out) const;
+
+        // bytes held by the levels and their rank indexes
+        std::size_t memoryUsage() const;
+
+    private:
+        using Levels = std::map<int, Level, std::less<int>, PoolAllocator<std::pair<const int, Level>>>;
+
+        // tree nodes are recycled, levels come and go all the time
+        NodePool nodes;
+        Levels levels;
+    };
+}
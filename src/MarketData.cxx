@@ -0,0 +1,87 @@
+#include <algorithm>
+#include <thread>
+
+#include "MarketData.hxx"
+#include "OrderBook.hxx"
+
+namespace trading
+{
+    void pushToRing(void* ring, const BookEvent& event)
+    {
+        auto& events = *static_cast<EventRing*>(ring);
+        while (!events.push(event))
+        {
+            std::this_thread::yield();
+        }
+    }
+
+    void L2Book::onEvent(void* book, const BookEvent& event)
+    {
+        static_cast<L2Book*>(book)->apply(event);
+    }
+
+    void L2Book::apply(const BookEvent& event)
+    {
+        if (event.sequence > sequence + 1)
+        {
+            missed += event.sequence - sequence - 1;
+        }
+        sequence = event.sequence;
+        if (event.type != BookEventType::LevelChanged)
+        {
+            return;
+        }
+
+        // best last: bids ascending, asks descending
+        const auto isBuy = event.side == Side::Buy;
+        auto& levels = isBuy ? bids : asks;
+        const auto iLevel = std::lower_bound(levels.begin(), levels.end(), event.price,
+            [isBuy](const Level& level, const int price) { return isBuy ? level.price < price : level.price > price; });
+        if (iLevel != levels.end() && iLevel->price == event.price)
+        {
+            if (event.quantity == 0)
+            {
+                levels.erase(iLevel);
+            }
+            else
+            {
+                iLevel->quantity = event.quantity;
+                iLevel->orders = event.orders;
+            }
+        }
+        else if (event.quantity != 0)
+        {
+            levels.insert(iLevel, Level { event.price, event.quantity, event.orders });
+        }
+    }
+
+    void L2Book::top(const int levels, DepthSnapshot& snapshot) const
+    {
+        const auto fill = [levels](const std::vector<Level>& side, std::vector<DepthLevel>& out)
+        {
+            out.clear();
+            const auto n = std::min<std::size_t>(std::max(levels, 0), side.size());
+            for (auto iLevel = side.rbegin(); iLevel != side.rbegin() + n; ++iLevel)
+            {
+                out.push_back(DepthLevel { iLevel->price, iLevel->quantity, iLevel->orders });
+            }
+        };
+        fill(bids, snapshot.bids);
+        fill(asks, snapshot.asks);
+    }
+
+    int L2Book::depth(const Side side) const
+    {
+        return static_cast<int>(side == Side::Buy ? bids.size() : asks.size());
+    }
+
+    std::uint64_t L2Book::lastSequence() const
+    {
+        return sequence;
+    }
+
+    std::uint64_t L2Book::gaps() const
+    {
+        return missed;
+    }
+}
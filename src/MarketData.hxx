@@ -0,0 +1,87 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "LimitOrder.hxx"
+#include "SpscRing.hxx"
+
+namespace trading
+{
+    struct DepthSnapshot;
+
+    enum class BookEventType: std::uint8_t
+    {
+        // an order rests in the book: quantity is its leaves
+        OrderAdded,
+        // a resting order was partially filled or amended down: quantity is its new leaves
+        OrderReduced,
+        // a resting order was filled, cancelled or, amended up, is about to be added again at the back:
+        // quantity is what it took out of the book, 0 once filled
+        OrderRemoved,
+        // quantity traded at price between the resting order id and the incoming otherId
+        Trade,
+        // the level at price now has quantity in total over orders, 0 and 0 once it's gone
+        LevelChanged
+    };
+
+    // One incremental change of a book, prices in ticks. Every event of a book has the next sequence number,
+    // starting at 1, so that a consumer can tell it missed one.
+    struct BookEvent
+    {
+        std::uint64_t sequence;
+        BookEventType type;
+        Side side;
+        int id;
+        int otherId;
+        int price;
+        int quantity;
+        int orders;
+    };
+
+    // called for every event as the book changes, see BasicOrderBook::setListener
+    using EventHandler = void (*)(void* context, const BookEvent& event);
+
+    using EventRing = SpscRing<BookEvent>;
+
+    // an EventHandler whose context is an EventRing, for a consumer on another thread; it waits while the
+    // ring is full, since a dropped event would leave the consumer out of sync
+    void pushToRing(void* ring, const BookEvent& event);
+
+    // Aggregated price levels of both sides, kept up to date from the LevelChanged events of a book, so that
+    // the top of the book is known without asking it. Each side is a vector sorted with the best level last:
+    // changes happen mostly near the top, where inserting and erasing move few elements.
+    class L2Book
+    {
+    public:
+        struct Level
+        {
+            int price;
+            int quantity;
+            int orders;
+        };
+
+        // an EventHandler whose context is an L2Book
+        static void onEvent(void* book, const BookEvent& event);
+
+        void apply(const BookEvent& event);
+
+        // up to the given number of levels of each side, best first, like BasicOrderBook::depth
+        void top(const int levels, DepthSnapshot& snapshot) const;
+
+        // number of levels on the side
+        int depth(const Side side) const;
+
+        // sequence number of the last event seen
+        std::uint64_t lastSequence() const;
+
+        // events missed, going by the sequence numbers
+        std::uint64_t gaps() const;
+
+    private:
+        std::vector<Level> bids;
+        std::vector<Level> asks;
+        std::uint64_t sequence = 0;
+        std::uint64_t missed = 0;
+    };
+}
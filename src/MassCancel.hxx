@@ -0,0 +1,34 @@
+#pragma once
+
+#include <cstdint>
+
+#include "LimitOrder.hxx"
+
+namespace trading
+{
+    // the kinds of mass cancel
+    enum class CancelScope: std::uint8_t
+    {
+        // every resting order of the side
+        Side,
+        // those of the side at the price or beyond it, away from the other side: bids at or below it,
+        // asks at or above it
+        Beyond,
+        // those with an id from the first to the last, both included
+        Ids,
+        // those of the owner, see LimitOrder::owner
+        Owner
+    };
+
+    // which resting orders a mass cancel takes out, see BasicOrderBook::cancelAll
+    struct MassCancel
+    {
+        CancelScope scope;
+        // for Side and Beyond
+        Side side;
+        // the price in ticks for Beyond, the first id for Ids, the owner for Owner
+        int from;
+        // the last id for Ids
+        int to;
+    };
+}
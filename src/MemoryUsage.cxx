@@ -0,0 +1,43 @@
+#include <iomanip>
+#include <ostream>
+
+#include "MemoryUsage.hxx"
+
+namespace trading
+{
+    namespace
+    {
+        void reportLine(std::ostream& out, const char* name, const std::size_t bytes, const std::size_t orders)
+        {
+            out << std::left << std::setw(12) << name << std::right << std::setw(14) << bytes;
+            if (orders > 0)
+            {
+                out << std::setw(12) << std::fixed << std::setprecision(1) << static_cast<double>(bytes) / orders;
+            }
+            out << '\n';
+        }
+    }
+
+    std::size_t MemoryUsage::total() const
+    {
+        return orders + index + levels + terminal + other;
+    }
+
+    void MemoryUsage::report(std::ostream& out) const
+    {
+        const auto flags = out.flags();
+        const auto precision = out.precision();
+        out << std::left << std::setw(12) << "memory" << std::right << std::setw(14) << "bytes" << std::setw(12)
+            << "per order" << '\n';
+        // the structures of the resting orders per resting order, the terminal store per order it keeps
+        reportLine(out, "orders", orders, restingOrders);
+        reportLine(out, "index", index, restingOrders);
+        reportLine(out, "levels", levels, restingOrders);
+        reportLine(out, "terminal", terminal, terminalOrders);
+        reportLine(out, "other", other, 0);
+        reportLine(out, "total", total(), restingOrders + terminalOrders);
+        out << restingOrders << " resting orders, " << terminalOrders << " cancelled or filled kept\n";
+        out.flags(flags);
+        out.precision(precision);
+    }
+}
@@ -0,0 +1,32 @@
+#pragma once
+
+#include <cstddef>
+#include <iosfwd>
+
+namespace trading
+{
+    // Bytes a book holds, by structure, counting what each has allocated whether it's in use yet or not.
+    // Enough to size a host from the number of orders, not an exact account of the allocator's overhead.
+    struct MemoryUsage
+    {
+        // the order records of the pool, see OrderPool
+        std::size_t orders = 0;
+        // the id index of the resting orders
+        std::size_t index = 0;
+        // the price levels of both sides, with their rank indexes
+        std::size_t levels = 0;
+        // the cancelled and fully filled orders still kept, see TerminalStore
+        std::size_t terminal = 0;
+        // the book itself and its buffers
+        std::size_t other = 0;
+
+        // how many orders rest in the book and how many ended ones it remembers
+        std::size_t restingOrders = 0;
+        std::size_t terminalOrders = 0;
+
+        std::size_t total() const;
+
+        // a line per structure with its bytes and the bytes per order, for stderr
+        void report(std::ostream& out) const;
+    };
+}
@@ -0,0 +1,74 @@
+#include <algorithm>
+
+#include "NodePool.hxx"
+
+namespace trading
+{
+    const std::size_t NodePool::GRANULARITY;
+    const std::size_t NodePool::MAX_BLOCK;
+    const std::size_t NodePool::CHUNK_SIZE;
+
+    std::size_t NodePool::sizeClass(const std::size_t bytes)
+    {
+        return (bytes + GRANULARITY - 1) / GRANULARITY;
+    }
+
+    void* NodePool::allocate(const std::size_t bytes)
+    {
+        if (bytes > MAX_BLOCK)
+        {
+            return ::operator new(bytes);
+        }
+
+        const auto index = sizeClass(bytes) - 1;
+        auto& head = freeLists[index];
+        if (head != nullptr)
+        {
+            auto block = head;
+            head = *static_cast<void**>(block);
+            return block;
+        }
+
+        const auto blockSize = (index + 1) * GRANULARITY;
+        if (cursor == nullptr || static_cast<std::size_t>(limit - cursor) < blockSize)
+        {
+            reserve(CHUNK_SIZE);
+        }
+        auto block = cursor;
+        cursor += blockSize;
+        return block;
+    }
+
+    void NodePool::deallocate(void* block, const std::size_t bytes)
+    {
+        if (bytes > MAX_BLOCK)
+        {
+            ::operator delete(block);
+            return;
+        }
+
+        auto& head = freeLists[sizeClass(bytes) - 1];
+        *static_cast<void**>(block) = head;
+        head = block;
+    }
+
+    std::size_t NodePool::memoryUsage() const
+    {
+        return held + chunks.capacity() * sizeof(chunks[0]);
+    }
+
+    void NodePool::reserve(const std::size_t bytes)
+    {
+        if (cursor != nullptr && static_cast<std::size_t>(limit - cursor) >= bytes)
+        {
+            return;
+        }
+
+        // whatever is left of the current chunk is abandoned, it's less than one request
+        const auto size = std::max(bytes, CHUNK_SIZE);
+        chunks.emplace_back(new char[size]);
+        held += size;
+        cursor = chunks.back().get();
+        limit = cursor + size;
+    }
+}
@@ -0,0 +1,100 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <vector>
+
+namespace trading
+{
+    // Memory for node based containers.  Small blocks are carved out of large chunks and go to a free list
+    // per size class when released, so a container that keeps inserting and erasing stops calling malloc
+    // once it has warmed up.
+    class NodePool
+    {
+    public:
+        static const std::size_t GRANULARITY = 16;
+        static const std::size_t MAX_BLOCK = 256;
+
+        NodePool() = default;
+        NodePool(const NodePool&) = delete;
+        NodePool& operator=(const NodePool&) = delete;
+
+        // anything bigger than MAX_BLOCK goes to the global operator new
+        void* allocate(const std::size_t bytes);
+
+        void deallocate(void* block, const std::size_t bytes);
+
+        // makes sure the next allocations of up to the given number of bytes in total don't call malloc
+        void reserve(const std::size_t bytes);
+
+        // bytes of the chunks, in use or not; the blocks bigger than MAX_BLOCK aren't counted
+        std::size_t memoryUsage() const;
+
+    private:
+        static const std::size_t CHUNK_SIZE = 64 * 1024;
+
+        std::vector<std::unique_ptr<char[]>> chunks;
+        char* cursor = nullptr;
+        char* limit = nullptr;
+        std::size_t held = 0;
+        std::array<void*, MAX_BLOCK / GRANULARITY> freeLists {};
+
+        static std::size_t sizeClass(const std::size_t bytes);
+    };
+
+    // Standard allocator drawing single objects from a NodePool, used by the maps of the book
+    template <typename T>
+    class PoolAllocator
+    {
+    public:
+        using value_type = T;
+
+        explicit PoolAllocator(NodePool& _pool): pool(&_pool)
+        {}
+
+        template <typename U>
+        PoolAllocator(const PoolAllocator<U>& other): pool(other.pool)
+        {}
+
+        T* allocate(const std::size_t n)
+        {
+            if (n == 1)
+            {
+                return static_cast<T*>(pool->allocate(sizeof(T)));
+            }
+            return static_cast<T*>(::operator new(n * sizeof(T)));
+        }
+
+        void deallocate(T* p, const std::size_t n)
+        {
+            if (n == 1)
+            {
+                pool->deallocate(p, sizeof(T));
+            }
+            else
+            {
+                ::operator delete(p);
+            }
+        }
+
+        template <typename U>
+        bool operator==(const PoolAllocator<U>& other) const
+        {
+            return pool == other.pool;
+        }
+
+        template <typename U>
+        bool operator!=(const PoolAllocator<U>& other) const
+        {
+            return pool != other.pool;
+        }
+
+    private:
+        template <typename U>
+        friend class PoolAllocator;
+
+        NodePool* pool;
+    };
+}
@@ -1,208 +1,858 @@
 #include <cassert>
-#include <cmath>
+#include <climits>
 #include <algorithm>
 
 #include "OrderBook.hxx"
 #include "Common.hxx"
 
-using std::rbegin;
-using std::rend;
+namespace trading
+{
+	namespace 
+	{
+		[[noreturn]] void throwRejected(const Reject reason, const int id)
+		{
+			switch (reason)
+			{
+				case Reject::BadSide:
+				case Reject::BadPrice:
+				case Reject::OffTick:
+				case Reject::PriceOutOfRange:
+				case Reject::BadQuantity:
+				case Reject::AmendBelowFilled:
+					LOG_AND_THROW("Order with id=" << id << " rejected, " << describe(reason));
+
+				case Reject::NoSuchLevel:
+					LOG_AND_THROW("No such level in the book: " << id);
+
+				default:
+					LOG_AND_THROW("Order with id=" << id << " " << describe(reason));
+			}
+		}
 
-template <typename T>
-struct reversion_wrapper { T& iterable; };
+		// apply() prefetches in stages this many commands apart, each stage needing what the one before fetched
+		const std::size_t PREFETCH_DISTANCE = 4;
+		// the handles apply() looked up ahead, a ring of a power of two entries covering the stages
+		const std::size_t LOOKED_UP = 16;
+		static_assert(LOOKED_UP >= 2 * PREFETCH_DISTANCE + 1, "a handle is used after the stages ahead of it");
+	}
 
-template <typename T>
-auto begin (reversion_wrapper<T> w) { return rbegin(w.iterable); }
+    template <template <typename> class BookSideT, typename QueueT, typename IdIndexT>
+    BasicOrderBook<BookSideT, QueueT, IdIndexT>::BasicOrderBook(const PriceScale& _scale, const RetentionConfig& retention):
+		scale(_scale),
+        terminal(retention)
+    {}
 
-template <typename T>
-auto end (reversion_wrapper<T> w) { return rend(w.iterable); }
+	template <template <typename> class BookSideT, typename QueueT, typename IdIndexT>
+	typename BasicOrderBook<BookSideT, QueueT, IdIndexT>::Fills BasicOrderBook<BookSideT, QueueT, IdIndexT>::add(const LimitOrder& order)
+	{
+		Fills fills;
+		add(order, [](void* context, const Fill& fill) { static_cast<Fills*>(context)->push_back(fill); }, &fills);
+		return fills;
+	}
 
-template <typename T>
-reversion_wrapper<T> reverse (T&& iterable) { return { iterable }; }
-        
-namespace trading
-{
-	namespace 
+	template <template <typename> class BookSideT, typename QueueT, typename IdIndexT>
+	void BasicOrderBook<BookSideT, QueueT, IdIndexT>::add(const LimitOrder& order, FillHandler onFill, void* context)
 	{
+		const auto reason = tryAdd(order, onFill, context);
+		if (reason != Reject::None)
+		{
+			throwRejected(reason, order.id);
+		}
 	}
 
-    OrderBook::OrderBook(const double _tickSize):
-		tickSize(_tickSize)
-    {
-        if (tickSize <= 0.0)
-        {
-            LOG_AND_THROW("Tick size must be positive, but is " << tickSize);
-        }
-    }
+	template <template <typename> class BookSideT, typename QueueT, typename IdIndexT>
+	void BasicOrderBook<BookSideT, QueueT, IdIndexT>::add(const LimitOrder& order, FillBuffer& fills)
+	{
+		fills.clear();
+		add(order, &FillBuffer::collect, &fills);
+	}
+
+	template <template <typename> class BookSideT, typename QueueT, typename IdIndexT>
+	void BasicOrderBook<BookSideT, QueueT, IdIndexT>::cancel(const int id)
+	{
+		const auto reason = tryCancel(id);
+		if (reason != Reject::None)
+		{
+			throwRejected(reason, id);
+		}
+	}
+
+	template <template <typename> class BookSideT, typename QueueT, typename IdIndexT>
+	void BasicOrderBook<BookSideT, QueueT, IdIndexT>::amend(const int id, const int quantity)
+	{
+		const auto reason = tryAmend(id, quantity);
+		if (reason != Reject::None)
+		{
+			throwRejected(reason, id);
+		}
+	}
+
+	template <template <typename> class BookSideT, typename QueueT, typename IdIndexT>
+	int BasicOrderBook<BookSideT, QueueT, IdIndexT>::cancelAll(const MassCancel& request)
+	{
+		int cancelled = 0;
+		const auto reason = tryCancelAll(request, cancelled);
+		if (reason != Reject::None)
+		{
+			LOG_AND_THROW("Mass cancel rejected, " << describe(reason));
+		}
+		return cancelled;
+	}
+
+	template <template <typename> class BookSideT, typename QueueT, typename IdIndexT>
+	QueryResult BasicOrderBook<BookSideT, QueueT, IdIndexT>::query(int id)
+	{
+		QueryResult result;
+		const auto reason = tryQuery(id, result);
+		if (reason != Reject::None)
+		{
+			throwRejected(reason, id);
+		}
+		return result;
+	}
 
-	OrderBook::Fills OrderBook::add(LimitOrderPtr order)
+	template <template <typename> class BookSideT, typename QueueT, typename IdIndexT>
+	Reject BasicOrderBook<BookSideT, QueueT, IdIndexT>::tryAdd(const LimitOrder& order, FillHandler onFill, void* context)
 	{
-        if (openOrders.find(order->id) != openOrders.cend())
+        if (index.find(order.id) != NO_ORDER)
         {
-            LOG_AND_THROW("Order with id=" << order->id << " already exists");
+            return reject(Reject::DuplicateId);
         }
-        if (cancelledOrders.find(order->id) != cancelledOrders.cend())
+        bool evicted;
+        if (const auto done = terminal.find(order.id, evicted))
         {
-            LOG_AND_THROW("Order with id=" << order->id << " was already cancelled, cannot add again");
+            return reject(done->cancelled ? Reject::AlreadyCancelled : Reject::AlreadyFilled);
         }
-        if (fullyFilledOrders.find(order->id) != fullyFilledOrders.cend())
+        if (evicted)
         {
-            LOG_AND_THROW("Order with id=" << order->id << " was already fully filled, cannot add again");
+            return reject(Reject::IdReused);
+        }
+        if (order.side != Side::Buy && order.side != Side::Sell)
+        {
+            return reject(Reject::BadSide);
+        }
+        if (order.price <= 0)
+        {
+            return reject(Reject::BadPrice);
+        }
+        if (order.quantity <= 0)
+        {
+            return reject(Reject::BadQuantity);
+        }
+        // checked before matching, so that a rejected order hasn't traded
+        if (!getSide(order.side).fits(order.price))
+        {
+            return reject(Reject::PriceOutOfRange);
         }
-        validateSide(order->side);
-        validatePrice(order->price);
-        validateQuantity(order->quantity);
 
-		auto& otherSide = getSide(order->side == Side::Buy ? Side::Sell : Side::Buy);
-		bool finished = false;
-		Fills fills;
-		std::list<int> ordersToRemove;
-		for (auto item = otherSide.begin(); !finished && item != otherSide.end(); ++item) {
-			for (auto& otherOrder: item->second) {
-				if (!order->fullyFilled() && otherOrder->canCross(*order)) {
-					auto fillQty = std::min(order->leaves(), otherOrder->leaves());
-					fills.push_back(Fill { otherOrder->price, fillQty });
-					order->addFill(fillQty);
-					otherOrder->addFill(fillQty);
-					if (otherOrder->fullyFilled())
-					{
-						ordersToRemove.push_back(otherOrder->id);
-						fullyFilledOrders[otherOrder->id] = otherOrder;
-					}
+        const auto handle = orders.allocate(order);
+        if (order.side == Side::Buy)
+        {
+            match<Side::Buy>(handle, onFill, context);
+        }
+        else
+        {
+            match<Side::Sell>(handle, onFill, context);
+        }
+        return Reject::None;
+    }
+
+	template <template <typename> class BookSideT, typename QueueT, typename IdIndexT>
+	template <Side S>
+	void BasicOrderBook<BookSideT, QueueT, IdIndexT>::match(const OrderHandle handle, FillHandler onFill, void* context)
+	{
+		using Other = SideTraits<SideTraits<S>::OTHER>;
+		auto& incoming = orders[handle].order;
+
+		// walk the other side from its best price inwards, level by level, until the order is filled
+		// or the next level doesn't cross any more; within a level it's time priority
+		const auto limit = incoming.price;
+		auto& otherSide = getSide<SideTraits<S>::OTHER>();
+		while (!incoming.fullyFilled() && !otherSide.empty()) {
+			const auto ticks = Other::best(otherSide);
+			if (!Other::crossedBy(limit, ticks)) {
+				break;
+			}
+			auto& level = *otherSide.find(ticks);
+			while (!level.empty() && !incoming.fullyFilled()) {
+				const auto other = level.head;
+				auto& otherOrder = orders[other].order;
+				auto fillQty = std::min(incoming.leaves(), otherOrder.leaves());
+				level.adjust(orders, other, -fillQty);
+				incoming.addFill(fillQty);
+				otherOrder.addFill(fillQty);
+				onFill(context, Fill { otherOrder.price, fillQty, otherOrder.id, incoming.id, otherOrder.leaves() });
+				if (listener != nullptr)
+				{
+					publish(BookEventType::Trade, otherOrder, incoming.id, fillQty);
+					publish(otherOrder.fullyFilled() ? BookEventType::OrderRemoved : BookEventType::OrderReduced,
+						otherOrder, 0, otherOrder.leaves());
+				}
+				if (otherOrder.fullyFilled())
+				{
+					level.unlink(orders, other);
+					retire(other);
+				}
+				if (listener != nullptr)
+				{
+					publishLevel(SideTraits<S>::OTHER, ticks, level);
 				}
 			}
+			if (level.empty())
+			{
+				otherSide.erase(ticks);
+			}
 		}
 
-		for (const auto id: ordersToRemove)
+		if (incoming.fullyFilled())
 		{
-			remove(id, /* flagCancelled */ false);
+			terminal.add(incoming);
+			orders.release(handle);
 		}
+		else
+		{
+			index.insert(incoming.id, handle);
+			auto& level = getSide<S>().level(incoming.price);
+			level.pushBack(orders, handle);
+			if (listener != nullptr)
+			{
+				publish(BookEventType::OrderAdded, incoming, 0, incoming.leaves());
+				publishLevel(S, incoming.price, level);
+			}
+		}
+	}
 
-		if (!order->fullyFilled())
+	template <template <typename> class BookSideT, typename QueueT, typename IdIndexT>
+	std::size_t BasicOrderBook<BookSideT, QueueT, IdIndexT>::apply(const BatchCommand* commands, const std::size_t count,
+		BatchResult* results, FillBuffer& fills)
+	{
+		fills.clear();
+		touched.clear();
+		touched.reserve(count);
+		batching = listener != nullptr;
+
+		// the id of a cancel or an amend is looked up once, two stages ahead; its handle then serves the
+		// prefetches and the command itself, unless the order is gone by then
+		const auto staged = orders.size() >= BATCH_LOOK_AHEAD_ORDERS ? count : 0;
+		std::array<OrderHandle, LOOKED_UP> lookedUp;
+		const auto lookUp = [&](const std::size_t i)
+		{
+			if (commands[i].op != BatchOp::Add)
+			{
+				const auto handle = findOpen(commands[i].id);
+				lookedUp[i % LOOKED_UP] = handle;
+				if (handle != NO_ORDER)
+				{
+					prefetch(&orders[handle]);
+				}
+			}
+		};
+		for (std::size_t i = 0; i < std::min(staged, 2 * PREFETCH_DISTANCE); ++i)
 		{
-			insert(order);
+			lookUp(i);
 		}
-		else 
+
+		std::size_t rejectedCount = 0;
+		for (std::size_t i = 0; i < count; ++i)
 		{
-			fullyFilledOrders[order->id] = order;
+			// the hash buckets of the id, then the lookup and its order once the bucket is in, then the orders
+			// next to it in the queue once the order is in
+			if (i + 3 * PREFETCH_DISTANCE < staged)
+			{
+				const auto id = commands[i + 3 * PREFETCH_DISTANCE].id;
+				// an add looks for the id in both, a cancel finds it in the index and adds it to the terminal store
+				index.prefetch(id);
+				terminal.prefetch(id);
+			}
+			if (i + 2 * PREFETCH_DISTANCE < staged)
+			{
+				lookUp(i + 2 * PREFETCH_DISTANCE);
+			}
+			if (i + PREFETCH_DISTANCE < staged && commands[i + PREFETCH_DISTANCE].op == BatchOp::Cancel)
+			{
+				prefetchNeighbours(lookedUp[(i + PREFETCH_DISTANCE) % LOOKED_UP]);
+			}
+
+			const auto& command = commands[i];
+			auto reason = Reject::None;
+			// only an add trades
+			std::size_t filled = 0;
+			switch (command.op)
+			{
+				case BatchOp::Add:
+				{
+					const auto before = fills.size() + fills.dropped();
+					reason = tryAdd(LimitOrder { command.id, command.side, command.price, command.quantity, 0 },
+						&FillBuffer::collect, &fills);
+					filled = fills.size() + fills.dropped() - before;
+					break;
+				}
+
+				case BatchOp::Cancel:
+					reason = cancelFound(command.id, i < staged ? stillOpen(lookedUp[i % LOOKED_UP], command.id)
+						: findOpen(command.id));
+					break;
+
+				case BatchOp::Amend:
+					reason = amendFound(command.id, i < staged ? stillOpen(lookedUp[i % LOOKED_UP], command.id)
+						: findOpen(command.id), command.quantity);
+					break;
+
+				default:
+					// the commands before this one are done, so are their events
+					batching = false;
+					publishTouched();
+					LOG_AND_THROW("Unknown batch command " << static_cast<int>(command.op) << " for id=" << command.id);
+			}
+			results[i] = BatchResult { reason, static_cast<std::uint32_t>(filled) };
+			if (reason != Reject::None)
+			{
+				++rejectedCount;
+			}
 		}
 
-		return fills;
+		batching = false;
+		publishTouched();
+		return rejectedCount;
+	}
+
+	template <template <typename> class BookSideT, typename QueueT, typename IdIndexT>
+	void BasicOrderBook<BookSideT, QueueT, IdIndexT>::publishTouched()
+	{
+		if (touched.empty())
+		{
+			return;
+		}
+		std::sort(touched.begin(), touched.end());
+		const auto end = std::unique(touched.begin(), touched.end());
+		for (auto iTouched = touched.begin(); iTouched != end; ++iTouched)
+		{
+			const auto side = iTouched->first;
+			const auto price = iTouched->second;
+			// a level emptied in the batch is gone by now
+			const auto level = getSide(side).find(price);
+			listener(listenerContext, BookEvent { ++sequence, BookEventType::LevelChanged, side, 0, 0, price,
+				level == nullptr ? 0 : level->quantity, level == nullptr ? 0 : level->count });
+		}
+		touched.clear();
 	}
 
-    void OrderBook::insert(LimitOrderPtr order)
+	template <template <typename> class BookSideT, typename QueueT, typename IdIndexT>
+	OrderHandle BasicOrderBook<BookSideT, QueueT, IdIndexT>::stillOpen(const OrderHandle handle, const int id) const
+	{
+		if (handle != NO_ORDER)
+		{
+			// released records are cancelled or filled, and a resting order is the only one with its id
+			const auto& order = orders[handle].order;
+			if (order.id == id && !order.isCancelled && !order.fullyFilled())
+			{
+				return handle;
+			}
+		}
+		// gone since, or added since
+		return findOpen(id);
+	}
+
+	template <template <typename> class BookSideT, typename QueueT, typename IdIndexT>
+	void BasicOrderBook<BookSideT, QueueT, IdIndexT>::prefetchNeighbours(const OrderHandle handle) const
+	{
+		if (handle == NO_ORDER)
+		{
+			return;
+		}
+		const auto& node = orders[handle];
+		if (node.prev != NO_ORDER)
+		{
+			prefetch(&orders[node.prev]);
+		}
+		if (node.next != NO_ORDER)
+		{
+			prefetch(&orders[node.next]);
+		}
+	}
+
+    template <template <typename> class BookSideT, typename QueueT, typename IdIndexT>
+    void BasicOrderBook<BookSideT, QueueT, IdIndexT>::insert(const OrderHandle handle)
+    {
+        const auto& order = orders[handle].order;
+        getSide(order.side).level(order.price).pushBack(orders, handle);
+    }
+
+    template <template <typename> class BookSideT, typename QueueT, typename IdIndexT>
+    void BasicOrderBook<BookSideT, QueueT, IdIndexT>::setListener(EventHandler handler, void* context)
+    {
+        listener = handler;
+        listenerContext = context;
+    }
+
+    template <template <typename> class BookSideT, typename QueueT, typename IdIndexT>
+    void BasicOrderBook<BookSideT, QueueT, IdIndexT>::publish(const BookEventType type, const LimitOrder& order, const int otherId,
+        const int quantity)
+    {
+        listener(listenerContext, BookEvent { ++sequence, type, order.side, order.id, otherId, order.price, quantity, 0 });
+    }
+
+    template <template <typename> class BookSideT, typename QueueT, typename IdIndexT>
+    void BasicOrderBook<BookSideT, QueueT, IdIndexT>::publishLevel(const Side side, const int price, const PriceLevel& level)
+    {
+        if (batching)
+        {
+            // a sweep touches the same level fill after fill
+            if (touched.empty() || touched.back() != std::make_pair(side, price))
+            {
+                touched.emplace_back(side, price);
+            }
+            return;
+        }
+        listener(listenerContext, BookEvent { ++sequence, BookEventType::LevelChanged, side, 0, 0, price,
+            level.quantity, level.count });
+    }
+
+    template <template <typename> class BookSideT, typename QueueT, typename IdIndexT>
+    void BasicOrderBook<BookSideT, QueueT, IdIndexT>::retire(const OrderHandle handle)
     {
-        const auto levelPrice = priceToLevel(order->price);
-        auto& level = getSide(order->side)[levelPrice];
-        level.push_back(order);
-        openOrders[order->id] = order;
+        const auto& order = orders[handle].order;
+        terminal.add(order);
+        index.erase(order.id);
+        orders.release(handle);
     }
 
-    void OrderBook::amend(const int id, const int quantity)
+    template <template <typename> class BookSideT, typename QueueT, typename IdIndexT>
+    Reject BasicOrderBook<BookSideT, QueueT, IdIndexT>::tryAmend(const int id, const int quantity)
     {
-        validateQuantity(quantity);
-        auto iOrder = openOrders.find(id);
-        if (iOrder == openOrders.end())
+        return amendFound(id, findOpen(id), quantity);
+    }
+
+    template <template <typename> class BookSideT, typename QueueT, typename IdIndexT>
+    Reject BasicOrderBook<BookSideT, QueueT, IdIndexT>::amendFound(const int id, const OrderHandle handle,
+        const int quantity)
+    {
+        if (quantity <= 0)
+        {
+            return reject(Reject::BadQuantity);
+        }
+        if (handle == NO_ORDER)
         {
-            LOG_AND_THROW("Order with id=" << id << " doesn't exists");
+            return rejectMissing(id);
         }
-        auto& order = iOrder->second;
-		if (order->quantity != quantity) 
+        auto& order = orders[handle].order;
+		if (order.quantity != quantity) 
 		{
-			if (order->quantity < quantity)
+			if (order.quantity < quantity)
 			{
-				order->quantity = quantity;
-				remove(id, /*flagCancelled*/ false);
-				insert(order);
+				// amending up loses the time priority: move to the back of the level
+				auto& level = *getSide(order.side).find(order.price);
+				if (listener != nullptr)
+				{
+					publish(BookEventType::OrderRemoved, order, 0, order.leaves());
+				}
+				level.adjust(orders, handle, quantity - order.quantity);
+				order.quantity = quantity;
+				level.moveToBack(orders, handle);
+				if (listener != nullptr)
+				{
+					publish(BookEventType::OrderAdded, order, 0, order.leaves());
+					publishLevel(order.side, order.price, level);
+				}
 			}
 			else 
 			{
-				if (quantity <= order->filledQty)
+				if (quantity <= order.filledQty)
 				{
-					LOG_AND_THROW("Cannot amend to below the filled level");
+					return reject(Reject::AmendBelowFilled);
+				}
+				auto& level = *getSide(order.side).find(order.price);
+				level.adjust(orders, handle, quantity - order.quantity);
+		        order.quantity = quantity;
+				if (listener != nullptr)
+				{
+					publish(BookEventType::OrderReduced, order, 0, order.leaves());
+					publishLevel(order.side, order.price, level);
 				}
-		        order->quantity = quantity;
 			}
 		}
+		return Reject::None;
     }
 
-    void OrderBook::cancel(const int id)
+    template <template <typename> class BookSideT, typename QueueT, typename IdIndexT>
+    Reject BasicOrderBook<BookSideT, QueueT, IdIndexT>::tryCancel(const int id)
     {
-		remove(id, /* flagCancelled */ true);
-	}
+        return cancelFound(id, findOpen(id));
+    }
 
-    void OrderBook::remove(const int id, bool flagCancelled)
+    template <template <typename> class BookSideT, typename QueueT, typename IdIndexT>
+    Reject BasicOrderBook<BookSideT, QueueT, IdIndexT>::cancelFound(const int id, const OrderHandle handle)
     {
-        auto iOrder = openOrders.find(id);
-        if (iOrder == openOrders.end())
+        if (handle == NO_ORDER)
         {
-            LOG_AND_THROW("Order with id=" << id << " doesn't exists");
+            return rejectMissing(id);
+        }
+        // the terminal store's slot for the id, while the order is taken out of its level
+        terminal.prefetch(id);
+        cancelOrder(handle);
+        return Reject::None;
+    }
+
+    template <template <typename> class BookSideT, typename QueueT, typename IdIndexT>
+    void BasicOrderBook<BookSideT, QueueT, IdIndexT>::cancelOrder(const OrderHandle handle)
+    {
+        auto& order = orders[handle].order;
+        const auto levelPrice = order.price;
+        auto& side = getSide(order.side);
+        auto& level = *side.find(levelPrice);
+        level.unlink(orders, handle);
+        if (listener != nullptr)
+        {
+            publish(BookEventType::OrderRemoved, order, 0, order.leaves());
+            publishLevel(order.side, levelPrice, level);
         }
-        auto order = iOrder->second;
-        const auto levelPrice = priceToLevel(order->price);
-        auto& level = getSide(order->side)[levelPrice];
-		auto iLevel = std::find_if(level.begin(), level.end(), [id](const auto& o){return o->id == id;});
-		if (iLevel != level.end())
-		{
-        	level.erase(iLevel);
-		}
 
         if (level.empty())
         {
-            getSide(order->side).erase(levelPrice);
+            side.erase(levelPrice);
         }
 
-        openOrders.erase(id);
+        order.isCancelled = true;
+        retire(handle);
+    }
 
-		if (flagCancelled)
-		{
-			order->isCancelled = true;
-			cancelledOrders[id] = order;
-		}
+    template <template <typename> class BookSideT, typename QueueT, typename IdIndexT>
+    Reject BasicOrderBook<BookSideT, QueueT, IdIndexT>::tryCancelAll(const MassCancel& request, int& cancelled)
+    {
+        cancelled = 0;
+        switch (request.scope)
+        {
+            case CancelScope::Side:
+            case CancelScope::Beyond:
+            {
+                if (request.side != Side::Buy && request.side != Side::Sell)
+                {
+                    return reject(Reject::BadSide);
+                }
+                if (request.scope == CancelScope::Beyond && request.from <= 0)
+                {
+                    return reject(Reject::BadPrice);
+                }
+                // the whole side is everything beyond its best price
+                const auto isBuy = request.side == Side::Buy;
+                const auto price = request.scope == CancelScope::Beyond ? request.from : isBuy ? INT_MAX : INT_MIN;
+                cancelled = cancelLevels(request.side, price);
+                break;
+            }
+            case CancelScope::Ids:
+            {
+                // looking up every id of the range is cheaper than walking the book, unless the range is the larger
+                const auto first = static_cast<std::int64_t>(request.from);
+                const auto last = static_cast<std::int64_t>(request.to);
+                if (last - first < static_cast<std::int64_t>(index.size()))
+                {
+                    for (auto id = first; id <= last; ++id)
+                    {
+                        const auto handle = findOpen(static_cast<int>(id));
+                        if (handle != NO_ORDER)
+                        {
+                            cancelOrder(handle);
+                            ++cancelled;
+                        }
+                    }
+                }
+                else
+                {
+                    cancelled = cancelMatching([&request](const LimitOrder& order)
+                    {
+                        return order.id >= request.from && order.id <= request.to;
+                    });
+                }
+                break;
+            }
+            case CancelScope::Owner:
+                cancelled = cancelMatching([&request](const LimitOrder& order) { return order.owner == request.from; });
+                break;
+
+            default:
+                return reject(Reject::BadScope);
+        }
+        return Reject::None;
+    }
+
+    template <template <typename> class BookSideT, typename QueueT, typename IdIndexT>
+    int BasicOrderBook<BookSideT, QueueT, IdIndexT>::cancelLevels(const Side side, const int price)
+    {
+        auto& bookSide = getSide(side);
+        const auto isBuy = side == Side::Buy;
+        int cancelled = 0;
+        while (!bookSide.empty())
+        {
+            // bids from the lowest up, asks from the highest down
+            const auto ticks = isBuy ? bookSide.lowest() : bookSide.highest();
+            if (isBuy ? ticks > price : ticks < price)
+            {
+                break;
+            }
+            auto& level = *bookSide.find(ticks);
+            for (auto handle = level.head; handle != NO_ORDER; )
+            {
+                auto& order = orders[handle].order;
+                // retiring the order reuses its link
+                const auto next = orders[handle].next;
+                if (listener != nullptr)
+                {
+                    publish(BookEventType::OrderRemoved, order, 0, order.leaves());
+                }
+                order.isCancelled = true;
+                retire(handle);
+                ++cancelled;
+                handle = next;
+            }
+            level.clear();
+            if (listener != nullptr)
+            {
+                publishLevel(side, ticks, level);
+            }
+            bookSide.erase(ticks);
+        }
+        return cancelled;
     }
 
-    double OrderBook::priceAt(const Side side, const int l) const
+    template <template <typename> class BookSideT, typename QueueT, typename IdIndexT>
+    template <typename Match>
+    int BasicOrderBook<BookSideT, QueueT, IdIndexT>::cancelMatching(const Match& match)
+    {
+        int cancelled = 0;
+        for (const auto side: { Side::Buy, Side::Sell })
+        {
+            auto& bookSide = getSide(side);
+            if (bookSide.empty())
+            {
+                continue;
+            }
+            auto ticks = bookSide.lowest();
+            auto more = true;
+            while (more)
+            {
+                // the next level before this one may go
+                const auto current = ticks;
+                more = bookSide.nextAbove(ticks);
+                auto& level = *bookSide.find(current);
+                const auto before = cancelled;
+                for (auto handle = level.head; handle != NO_ORDER; )
+                {
+                    const auto next = orders[handle].next;
+                    auto& order = orders[handle].order;
+                    if (match(order))
+                    {
+                        level.unlink(orders, handle);
+                        if (listener != nullptr)
+                        {
+                            publish(BookEventType::OrderRemoved, order, 0, order.leaves());
+                        }
+                        order.isCancelled = true;
+                        retire(handle);
+                        ++cancelled;
+                    }
+                    handle = next;
+                }
+                if (cancelled != before)
+                {
+                    if (listener != nullptr)
+                    {
+                        publishLevel(side, current, level);
+                    }
+                    if (level.empty())
+                    {
+                        bookSide.erase(current);
+                    }
+                }
+            }
+        }
+        return cancelled;
+    }
+
+    template <template <typename> class BookSideT, typename QueueT, typename IdIndexT>
+    OrderHandle BasicOrderBook<BookSideT, QueueT, IdIndexT>::findOpen(const int id) const
+    {
+        return index.find(id);
+    }
+
+    template <template <typename> class BookSideT, typename QueueT, typename IdIndexT>
+    Reject BasicOrderBook<BookSideT, QueueT, IdIndexT>::reject(const Reject reason) const
+    {
+        ++rejected[static_cast<std::size_t>(reason)];
+        return reason;
+    }
+
+    template <template <typename> class BookSideT, typename QueueT, typename IdIndexT>
+    Reject BasicOrderBook<BookSideT, QueueT, IdIndexT>::rejectMissing(const int id) const
+    {
+        bool evicted;
+        if (const auto done = terminal.find(id, evicted))
+        {
+            return reject(done->cancelled ? Reject::AlreadyCancelled : Reject::AlreadyFilled);
+        }
+        return reject(evicted ? Reject::OrderForgotten : Reject::UnknownOrder);
+    }
+
+    template <template <typename> class BookSideT, typename QueueT, typename IdIndexT>
+    std::uint64_t BasicOrderBook<BookSideT, QueueT, IdIndexT>::rejections(const Reject reason) const
+    {
+        return rejected[static_cast<std::size_t>(reason)];
+    }
+
+    template <template <typename> class BookSideT, typename QueueT, typename IdIndexT>
+    const PriceScale& BasicOrderBook<BookSideT, QueueT, IdIndexT>::getScale() const
+    {
+        return scale;
+    }
+
+    template <template <typename> class BookSideT, typename QueueT, typename IdIndexT>
+    void BasicOrderBook<BookSideT, QueueT, IdIndexT>::reserve(const std::size_t count)
+    {
+        orders.reserve(count);
+        terminal.reserve(count);
+        index.reserve(count);
+    }
+
+    template <template <typename> class BookSideT, typename QueueT, typename IdIndexT>
+    MemoryUsage BasicOrderBook<BookSideT, QueueT, IdIndexT>::memoryUsage() const
+    {
+        MemoryUsage usage;
+        usage.orders = orders.memoryUsage();
+        usage.index = index.memoryUsage();
+        usage.levels = sides[0].memoryUsage() + sides[1].memoryUsage();
+        usage.terminal = terminal.memoryUsage();
+        // the members themselves, what they allocate is counted above
+        usage.other = sizeof(*this) + scratch.capacity() * sizeof(LevelRef)
+            + touched.capacity() * sizeof(touched[0]);
+        usage.restingOrders = orders.size();
+        usage.terminalOrders = terminal.size();
+        return usage;
+    }
+
+    template <template <typename> class BookSideT, typename QueueT, typename IdIndexT>
+    void BasicOrderBook<BookSideT, QueueT, IdIndexT>::save(SnapshotWriter& out) const
+    {
+        out.write<std::uint64_t>(index.size());
+        for (const auto side: { Side::Buy, Side::Sell })
+        {
+            const auto& bookSide = getSide(side);
+            if (bookSide.empty())
+            {
+                continue;
+            }
+            auto ticks = bookSide.lowest();
+            do
+            {
+                for (auto handle = bookSide.find(ticks)->head; handle != NO_ORDER; handle = orders[handle].next)
+                {
+                    const auto& order = orders[handle].order;
+                    out.write(snapshot::OrderRecord { order.id, static_cast<std::uint8_t>(order.side), order.price,
+                        order.quantity, order.filledQty, order.owner });
+                }
+            } while (bookSide.nextAbove(ticks));
+        }
+        terminal.save(out);
+    }
+
+    template <template <typename> class BookSideT, typename QueueT, typename IdIndexT>
+    void BasicOrderBook<BookSideT, QueueT, IdIndexT>::restore(SnapshotReader& in)
+    {
+        if (index.size() != 0 || terminal.size() != 0)
+        {
+            LOG_AND_THROW("Only an empty book can be restored");
+        }
+
+        const auto count = in.read<std::uint64_t>();
+        orders.reserve(count);
+        index.reserve(count);
+        for (std::uint64_t i = 0; i < count; ++i)
+        {
+            const auto record = in.read<snapshot::OrderRecord>();
+            const LimitOrder order { record.id, static_cast<Side>(record.side), record.price, record.quantity,
+                record.filledQty, false, record.owner };
+            validateSide(order.side);
+            validatePrice(order.price);
+            if (order.filledQty < 0 || order.leaves() <= 0)
+            {
+                LOG_AND_THROW("Order with id=" << order.id << " in the snapshot isn't open");
+            }
+            const auto handle = orders.allocate(order);
+            if (!index.insert(order.id, handle))
+            {
+                LOG_AND_THROW("Order with id=" << order.id << " is twice in the snapshot");
+            }
+            // they come in queue order, so pushing to the back keeps the positions
+            insert(handle);
+        }
+        terminal.restore(in);
+    }
+
+    template <template <typename> class BookSideT, typename QueueT, typename IdIndexT>
+    int BasicOrderBook<BookSideT, QueueT, IdIndexT>::priceAt(const Side side, const int l) const
     {
         const auto& level = getLevel(side, l);
         if (level.empty())
         {
             LOG_AND_THROW("The level is unexpectedly empty");
         }
-        return level.front()->price;
+        return orders[level.head].order.price;
     }
 
-    int OrderBook::sizeAt(const Side side, const int l) const
+    template <template <typename> class BookSideT, typename QueueT, typename IdIndexT>
+    int BasicOrderBook<BookSideT, QueueT, IdIndexT>::sizeAt(const Side side, const int l) const
     {
-        const auto& level = getLevel(side, l);
-        int res = 0;
-        for (const auto& order: level)
+        return getLevel(side, l).quantity;
+    }
+
+    template <template <typename> class BookSideT, typename QueueT, typename IdIndexT>
+    void BasicOrderBook<BookSideT, QueueT, IdIndexT>::depth(const int levels, DepthSnapshot& snapshot) const
+    {
+        if (tryDepth(levels, snapshot) != Reject::None)
         {
-            res += order->leaves();
+            LOG_AND_THROW("Level count must be non-negative, but " << levels << " given");
         }
-        return res;
     }
 
-    void OrderBook::validatePrice(const double price) const
+    template <template <typename> class BookSideT, typename QueueT, typename IdIndexT>
+    Reject BasicOrderBook<BookSideT, QueueT, IdIndexT>::tryDepth(const int levels, DepthSnapshot& snapshot) const
     {
-        if (price <= 0.0)
+        if (levels < 0)
         {
-            LOG_AND_THROW("Price must be positive, " << price << " given");
+            return reject(Reject::BadLevelCount);
         }
-        if (!essentiallyEqual(price / tickSize, priceToLevel(price)))
+
+        // no deeper than the book, so that the buffers only grow with the book and not with what's asked
+        const auto wanted = std::min(levels, std::max(sides[0].depth(), sides[1].depth()));
+        if (scratch.size() < static_cast<std::size_t>(wanted))
         {
-            LOG_AND_THROW("Price must be of given tick size " << tickSize << ", but it's not: " << price);
+            scratch.resize(wanted);
         }
+        const auto fill = [&](const Side side, std::vector<DepthLevel>& out)
+        {
+            const auto n = getSide(side).top(side == Side::Buy, 0, wanted, scratch.data());
+            out.clear();
+            for (int i = 0; i < n; ++i)
+            {
+                const auto& level = *scratch[i].level;
+                out.push_back(DepthLevel { orders[level.head].order.price, level.quantity, level.count });
+            }
+        };
+        fill(Side::Buy, snapshot.bids);
+        fill(Side::Sell, snapshot.asks);
+        return Reject::None;
     }
 
-    void OrderBook::validateQuantity(const int quantity)
+    template <template <typename> class BookSideT, typename QueueT, typename IdIndexT>
+    void BasicOrderBook<BookSideT, QueueT, IdIndexT>::validatePrice(const int price)
     {
-        if (quantity <= 0)
+        if (price <= 0)
         {
-            LOG_AND_THROW("Quantity must be positive, " << quantity << " given");
+            LOG_AND_THROW("Price must be positive, " << price << " ticks given");
         }
     }
 
-    void OrderBook::validateSide(const Side side)
+
+    template <template <typename> class BookSideT, typename QueueT, typename IdIndexT>
+    void BasicOrderBook<BookSideT, QueueT, IdIndexT>::validateSide(const Side side)
     {
         switch (side)
         {
@@ -215,13 +865,22 @@ namespace trading
         }
     }
 
-    OrderBook::BookSide& OrderBook::getSide(const Side side)
+    template <template <typename> class BookSideT, typename QueueT, typename IdIndexT>
+    template <Side S>
+    typename BasicOrderBook<BookSideT, QueueT, IdIndexT>::BookSide& BasicOrderBook<BookSideT, QueueT, IdIndexT>::getSide()
     {
-        const auto& res = const_cast<const OrderBook*>(this)->getSide(side);
+        return sides[SideTraits<S>::INDEX];
+    }
+
+    template <template <typename> class BookSideT, typename QueueT, typename IdIndexT>
+    typename BasicOrderBook<BookSideT, QueueT, IdIndexT>::BookSide& BasicOrderBook<BookSideT, QueueT, IdIndexT>::getSide(const Side side)
+    {
+        const auto& res = const_cast<const BasicOrderBook*>(this)->getSide(side);
         return const_cast<BookSide&>(res);
     }
 
-    const OrderBook::BookSide& OrderBook::getSide(const Side side) const
+    template <template <typename> class BookSideT, typename QueueT, typename IdIndexT>
+    const typename BasicOrderBook<BookSideT, QueueT, IdIndexT>::BookSide& BasicOrderBook<BookSideT, QueueT, IdIndexT>::getSide(const Side side) const
     {
         switch (side)
         {
@@ -236,90 +895,84 @@ namespace trading
         }
     }
 
-    int OrderBook::priceToLevel(const double price) const
-    {
-        return static_cast<int>(std::round(price / tickSize));
-    }
-
-    const OrderBook::PriceLevel& OrderBook::getLevel(const Side side, const int level) const
+    template <template <typename> class BookSideT, typename QueueT, typename IdIndexT>
+    const PriceLevel& BasicOrderBook<BookSideT, QueueT, IdIndexT>::getLevel(const Side side, const int level) const
     {
         if (level < 0)
         {
             LOG_AND_THROW("Level must be non-negative, but " << level << " given");
         }
-
-        auto count = level;
-
-        switch (side)
+        if (const auto found = findLevel(side, level))
         {
-            case Side::Buy:
-                for (const auto& item: reverse(getSide(side)))
-                {
-                    if (count == 0)
-                    {
-                        return item.second;
-                    }
-                    --count;
-                }
-                break;
-
-            case Side::Sell:
-                for (const auto& item: getSide(side))
-                {
-                    if (count == 0)
-                    {
-                        return item.second;
-                    }
-                    --count;
-                }
-                break;
+            return *found;
+        }
+        LOG_AND_THROW("No such level in the book: " << level << " on side " << side);
+    }
 
-            default:
-                LOG_AND_THROW("Side must be Buy or Sell, " << side << " given");
+    template <template <typename> class BookSideT, typename QueueT, typename IdIndexT>
+    const PriceLevel* BasicOrderBook<BookSideT, QueueT, IdIndexT>::findLevel(const Side side, const int level) const
+    {
+        // bids are best at the highest price, asks at the lowest
+        LevelRef ref;
+        if (level >= 0 && getSide(side).top(side == Side::Buy, level, 1, &ref) == 1)
+        {
+            return ref.level;
         }
+        return nullptr;
+    }
 
-        LOG_AND_THROW("No such level in the book: " << level << " on side " << side);
+    template <template <typename> class BookSideT, typename QueueT, typename IdIndexT>
+    Reject BasicOrderBook<BookSideT, QueueT, IdIndexT>::tryLevel(const Side side, const int level, int& price, int& quantity) const
+    {
+        if (side != Side::Buy && side != Side::Sell)
+        {
+            return reject(Reject::BadSide);
+        }
+        const auto found = findLevel(side, level);
+        if (found == nullptr || found->empty())
+        {
+            return reject(Reject::NoSuchLevel);
+        }
+        price = orders[found->head].order.price;
+        quantity = found->quantity;
+        return Reject::None;
     }
 
 
-	QueryResult OrderBook::query(int id) const
+	template <template <typename> class BookSideT, typename QueueT, typename IdIndexT>
+	Reject BasicOrderBook<BookSideT, QueueT, IdIndexT>::tryQuery(const int id, QueryResult& result)
 	{
-        const auto iOrder = openOrders.find(id);
-        if (iOrder == openOrders.cend())
+        const auto handle = index.find(id);
+        if (handle == NO_ORDER)
         {
-			const auto iFilledOrder = fullyFilledOrders.find(id);
-			if (iFilledOrder == fullyFilledOrders.cend()) 
-			{
-				const auto iCancelledOrder = cancelledOrders.find(id);
-				if (iCancelledOrder == cancelledOrders.cend())
-				{
-					LOG_AND_THROW("Order with id=" << id << " doesn't exists");
-				}
-
-				return QueryResult { iCancelledOrder->second, -1 };
-			}
-			else 
-			{
-				return QueryResult { iFilledOrder->second, -1 };
-			}
+            bool evicted;
+            if (const auto done = terminal.find(id, evicted))
+            {
+                queried = done->toOrder();
+                result = QueryResult { &queried, -1 };
+                return Reject::None;
+            }
+            return reject(evicted ? Reject::OrderForgotten : Reject::UnknownOrder);
         }
 
-        const auto order = iOrder->second;
-        const auto levelPrice = priceToLevel(order->price);
-		const auto& side = getSide(order->side);
+        const auto& order = orders[handle].order;
+
+        const auto levelPrice = order.price;
+		auto& side = getSide(order.side);
 		const auto iLevel = side.find(levelPrice);
-		if (iLevel == side.cend())
+		if (iLevel == nullptr)
 		{
 			LOG_AND_THROW("Order with id=" << id << " has no price level");
 		}
-        const auto& level = iLevel->second;
-		int position = 0;
-		for (const auto& o: level) 
-		{
-			if (o->id == id)
-				break;
-			++position;
-		}
-		return QueryResult { order, position };
+		int quantityAhead = 0;
+		const auto position = QueueT::position(*iLevel, orders, handle, quantityAhead);
+		result = QueryResult { &order, position, quantityAhead };
+		return Reject::None;
 	}
+
+	template class BasicOrderBook<MapBookSide, RankedQueue, FlatIdIndex>;
+	template class BasicOrderBook<LadderBookSide, RankedQueue, FlatIdIndex>;
+	template class BasicOrderBook<MapBookSide, PlainQueue, FlatIdIndex>;
+	template class BasicOrderBook<LadderBookSide, PlainQueue, FlatIdIndex>;
+	template class BasicOrderBook<MapBookSide, RankedQueue, RingIdIndex>;
 }
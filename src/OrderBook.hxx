@@ -1,74 +1,252 @@
 #pragma once
 
-#include <unordered_map>
-#include <map>
 #include <list>
 #include <array>
+#include <vector>
 
+#include "Batch.hxx"
+#include "Fill.hxx"
+#include "IdIndex.hxx"
 #include "LimitOrder.hxx"
+#include "MassCancel.hxx"
+#include "MarketData.hxx"
+#include "MemoryUsage.hxx"
+#include "NodePool.hxx"
+#include "OrderPool.hxx"
+#include "PriceScale.hxx"
+#include "Reject.hxx"
+#include "SideTraits.hxx"
+#include "TerminalStore.hxx"
+#include "MapBookSide.hxx"
+#include "LadderBookSide.hxx"
 
 namespace trading
 {
-	struct Fill
+	// for a cancelled or fully filled order, the order is a copy which stays valid until the next query
+	// and the position is -1
+	struct QueryResult
 	{
-		const double filledPrice;
-		const int filledQty;
+		LimitOrderPtr order = nullptr;
+		// orders ahead in the queue of the level, and their total leaves
+		int position = 0;
+		int quantityAhead = 0;
 	};
 
-	struct QueryResult
+	struct DepthLevel
+	{
+		int price;
+		int quantity;
+		int orders;
+	};
+
+	// the best levels of both sides, best first; the vectors are reused from one call to the next
+	struct DepthSnapshot
 	{
-		const LimitOrderPtr order;
-		const int position;
+		std::vector<DepthLevel> bids;
+		std::vector<DepthLevel> asks;
 	};
 
-    class OrderBook
+    // The policies of a book, picked for the instruments it trades:
+    // BookSideT decides how the price levels of each side are stored, see MapBookSide and LadderBookSide;
+    // QueueT what a level keeps to find the position of an order in its queue, and so the type of the levels
+    // BookSideT stores, see RankedQueue and PlainQueue;
+    // IdIndexT how the resting orders are found by id, see FlatIdIndex and RingIdIndex.
+    // Matching an order is compiled once for each side, see SideTraits.
+    template <template <typename> class BookSideT, typename QueueT = RankedQueue, typename IdIndexT = FlatIdIndex>
+    class BasicOrderBook
     {
     public:
 		using Fills = std::list<Fill>;
 
-        OrderBook(const double tickSize);
+		// called for every fill as it happens, without collecting them
+		using FillHandler = void (*)(void* context, const Fill& fill);
+
+        // retention decides how many cancelled and fully filled orders can still be queried
+        explicit BasicOrderBook(const PriceScale& scale, const RetentionConfig& retention = RetentionConfig());
 
-        Fills add(LimitOrderPtr order);
+        // the book keeps its own copy of the order, whose price is in ticks
+        Fills add(const LimitOrder& order);
+
+        // the same, but the fills go to the handler as they happen, so nothing is allocated for them
+        void add(const LimitOrder& order, FillHandler onFill, void* context);
+
+        // the same into the buffer, which is cleared first
+        void add(const LimitOrder& order, FillBuffer& fills);
 
         void cancel(const int id);
 
         void amend(const int id, const int quantity);
 
-        double priceAt(const Side side, const int level) const;
+        // cancels every resting order the request covers and returns how many, each of them is queried as
+        // cancelled afterwards just as after cancel()
+        int cancelAll(const MassCancel& request);
+
+        // in ticks
+        int priceAt(const Side side, const int level) const;
 
         int sizeAt(const Side side, const int level) const;
 
-		QueryResult query(int id) const;
+        // The same commands without exceptions: Reject::None once done, otherwise why the book refused, having
+        // changed nothing. The members above are these plus a TradingError for the rejections.
+        Reject tryAdd(const LimitOrder& order, FillHandler onFill, void* context);
 
-    private:
-        using PriceLevel = std::list<LimitOrderPtr>;
+        Reject tryCancel(const int id);
+
+        // a whole level goes at once, without looking up its orders one by one
+        Reject tryCancelAll(const MassCancel& request, int& cancelled);
+
+        Reject tryAmend(const int id, const int quantity);
+
+        // not const, a deep level of a RankedQueue book builds its rank index when first asked
+        Reject tryQuery(const int id, QueryResult& result);
+
+        // price in ticks and total quantity of the level. Level N is found by stepping over the N better
+        // ones, so it costs O(N): tree steps on a MapBookSide, bitmap scans on a LadderBookSide. The same holds
+        // for priceAt and sizeAt; depth() is the way to read many levels
+        Reject tryLevel(const Side side, const int level, int& price, int& quantity) const;
+
+        // up to the given number of levels of each side, walking each side once; asking for more levels than
+        // the book has costs no more than asking for all of them
+        Reject tryDepth(const int levels, DepthSnapshot& snapshot) const;
+
+        // Applies the commands in order, each as its try* member would, and writes what became of the i-th one to
+        // results[i]; the fills of the whole batch go to the buffer, which is cleared first. In a book of at least
+        // BATCH_LOOK_AHEAD_ORDERS, the ids of the commands a few places ahead are looked up once while a command
+        // runs, and their orders prefetched. The LevelChanged events are held back to the end of the batch: one
+        // per level touched, with its final state. The level totals are not held back: they are two adds on a
+        // level the command has in the cache anyway, and a deep level's queue rank relies on the count. Saves
+        // what the misses of deep books cost, not the work of each command, see the README. Returns the number
+        // of commands rejected.
+        std::size_t apply(const BatchCommand* commands, const std::size_t count, BatchResult* results,
+            FillBuffer& fills);
+
+        // commands rejected for the reason so far
+        std::uint64_t rejections(const Reject reason) const;
+
+        // counts the rejection and returns it; also for a command refused on its way to the book, like a price
+        // off the tick, so that rejections() has every rejection of the book's commands
+        Reject reject(const Reject reason) const;
+
+        void depth(const int levels, DepthSnapshot& snapshot) const;
+
+		QueryResult query(int id);
+
+        const PriceScale& getScale() const;
+
+        // preallocates storage for the given number of new orders, adding them won't call malloc
+        void reserve(const std::size_t count);
+
+        // what the book's structures hold, see MemoryUsage.hxx
+        MemoryUsage memoryUsage() const;
+
+        // every change of the book from now on goes to the handler as a BookEvent, nullptr stops that
+        void setListener(EventHandler handler, void* context);
 
-        // map is ordered by the key
-        using BookSide = std::map<int, PriceLevel>;
+        // the resting orders in queue order and the terminal ones, see Snapshot.hxx
+        void save(SnapshotWriter& out) const;
 
-		const double tickSize;
+        // fills an empty book from what save() wrote, with the same queue positions
+        void restore(SnapshotReader& in);
+
+    private:
+        using BookSide = BookSideT<typename QueueT::Level>;
+
+		const PriceScale scale;
 
         std::array<BookSide, 2> sides;
-		std::unordered_map<int, LimitOrderPtr> openOrders;
-		std::unordered_map<int, LimitOrderPtr> cancelledOrders;
-		std::unordered_map<int, LimitOrderPtr> fullyFilledOrders;
+        // the resting orders, linked into their levels, and the index of their ids
+        OrderPool orders;
+        IdIndexT index;
+        // what's left of the cancelled and fully filled ones
+        TerminalStore terminal;
+        // the last terminal order asked for by query()
+        LimitOrder queried {};
+        EventHandler listener = nullptr;
+        void* listenerContext = nullptr;
+        // of the last event
+        std::uint64_t sequence = 0;
+        // level references for depth()
+        mutable std::vector<LevelRef> scratch;
+        mutable std::array<std::uint64_t, REJECT_REASONS> rejected {};
+        // inside apply(), the levels whose LevelChanged events are due at the end of the batch
+        bool batching = false;
+        std::vector<std::pair<Side, int>> touched;
 
-        void insert(LimitOrderPtr order);
+        void insert(const OrderHandle handle);
 
-        void validatePrice(const double price) const;
+        // matches a new order of side S, already in the pool and valid, against the other side, then rests
+        // what's left of it or retires it filled
+        template <Side S>
+        void match(const OrderHandle handle, FillHandler onFill, void* context);
 
-        static void validateSide(const Side side);
+        // moves an order that is done, and no longer in a level, out of the pool and the index
+        void retire(const OrderHandle handle);
+
+        // takes a resting order out of its level, which goes if it's left empty, and retires it cancelled
+        void cancelOrder(const OrderHandle handle);
+
+        // tryCancel and tryAmend of the order findOpen(id) gave
+        Reject cancelFound(const int id, const OrderHandle handle);
+
+        Reject amendFound(const int id, const OrderHandle handle, const int quantity);
+
+        // cancels the levels of the side from the one furthest from the other side up to the price, both
+        // included, and returns the number of orders cancelled
+        int cancelLevels(const Side side, const int price);
+
+        // cancels every resting order for which match(order) is true, level by level, and returns how many
+        template <typename Match>
+        int cancelMatching(const Match& match);
+
+        // to the listener, which must be set
+        void publish(const BookEventType type, const LimitOrder& order, const int otherId, const int quantity);
+
+        void publishLevel(const Side side, const int price, const PriceLevel& level);
+
+        // the held back LevelChanged events of a batch, in the order of side and price
+        void publishTouched();
 
-        static void validateQuantity(const int quantity);
+        // the handle of the resting order with the id, looked up earlier in a batch; looks it up again if the
+        // order is gone since or the lookup found none
+        OrderHandle stillOpen(const OrderHandle handle, const int id) const;
 
-        int priceToLevel(const double price) const;
+        // brings the orders before and after a resting one in its level into the cache, a cancel relinks them
+        void prefetchNeighbours(const OrderHandle handle) const;
+
+        static void validatePrice(const int price);
+
+        static void validateSide(const Side side);
+
+        // why an id that isn't in the book can't be cancelled, amended or queried
+        Reject rejectMissing(const int id) const;
 
         const PriceLevel& getLevel(const Side side, int level) const;
 
+        // nullptr if there is no such level
+        const PriceLevel* findLevel(const Side side, const int level) const;
+
+        template <Side S>
+        BookSide& getSide();
+
         BookSide& getSide(const Side side);
 
         const BookSide& getSide(const Side side) const;
 
-        void remove(const int id, bool flagCancelled);
+        // handle of a resting order, NO_ORDER if there is none
+        OrderHandle findOpen(const int id) const;
     };
+
+    // the default book, with price levels in an ordered map
+    using OrderBook = BasicOrderBook<MapBookSide>;
+
+    // price levels in a tick-indexed array, for instruments trading in a narrow band of ticks
+    using LadderOrderBook = BasicOrderBook<LadderBookSide>;
+
+    // the same without rank indexes on the levels, for flow that rarely asks for queue positions
+    using PlainOrderBook = BasicOrderBook<MapBookSide, PlainQueue>;
+
+    using PlainLadderOrderBook = BasicOrderBook<LadderBookSide, PlainQueue>;
+
+    // ids looked up in a ring rather than hashed, for venues handing out order ids in sequence
+    using SequentialIdOrderBook = BasicOrderBook<MapBookSide, RankedQueue, RingIdIndex>;
 }
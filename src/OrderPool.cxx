@@ -0,0 +1,96 @@
+#include "Common.hxx"
+#include "OrderPool.hxx"
+
+namespace trading
+{
+    const int OrderPool::CHUNK_BITS;
+    const OrderHandle OrderPool::CHUNK_SIZE;
+
+    OrderHandle OrderPool::allocate(const LimitOrder& order)
+    {
+        OrderHandle handle;
+        if (freeList != NO_ORDER)
+        {
+            handle = freeList;
+            freeList = (*this)[handle].next;
+        }
+        else
+        {
+            if (used == capacity())
+            {
+                addChunk();
+            }
+            handle = used++;
+        }
+
+        auto& node = (*this)[handle];
+        node.order = order;
+        node.prev = NO_ORDER;
+        node.next = NO_ORDER;
+        ++live;
+        return handle;
+    }
+
+    void OrderPool::release(const OrderHandle handle)
+    {
+        (*this)[handle].next = freeList;
+        freeList = handle;
+        --live;
+    }
+
+    OrderNode& OrderPool::operator[](const OrderHandle handle)
+    {
+        return chunks[handle >> CHUNK_BITS][handle & (CHUNK_SIZE - 1)];
+    }
+
+    const OrderNode& OrderPool::operator[](const OrderHandle handle) const
+    {
+        return chunks[handle >> CHUNK_BITS][handle & (CHUNK_SIZE - 1)];
+    }
+
+    std::uint32_t& OrderPool::rank(const OrderHandle handle)
+    {
+        return ranks[handle >> CHUNK_BITS][handle & (CHUNK_SIZE - 1)];
+    }
+
+    std::uint32_t OrderPool::rank(const OrderHandle handle) const
+    {
+        return ranks[handle >> CHUNK_BITS][handle & (CHUNK_SIZE - 1)];
+    }
+
+    void OrderPool::reserve(const std::size_t records)
+    {
+        chunks.reserve((used + records + CHUNK_SIZE - 1) / CHUNK_SIZE);
+        ranks.reserve(chunks.capacity());
+        while (capacity() - used < records)
+        {
+            addChunk();
+        }
+    }
+
+    std::size_t OrderPool::size() const
+    {
+        return live;
+    }
+
+    std::size_t OrderPool::capacity() const
+    {
+        return chunks.size() * CHUNK_SIZE;
+    }
+
+    std::size_t OrderPool::memoryUsage() const
+    {
+        return chunks.size() * CHUNK_SIZE * (sizeof(OrderNode) + sizeof(std::uint32_t))
+            + chunks.capacity() * sizeof(chunks[0]) + ranks.capacity() * sizeof(ranks[0]);
+    }
+
+    void OrderPool::addChunk()
+    {
+        if (capacity() + CHUNK_SIZE > NO_ORDER)
+        {
+            LOG_AND_THROW("Order pool is full");
+        }
+        chunks.emplace_back(new OrderNode[CHUNK_SIZE]);
+        ranks.emplace_back(new std::uint32_t[CHUNK_SIZE]);
+    }
+}
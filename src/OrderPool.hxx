@@ -0,0 +1,74 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "LimitOrder.hxx"
+
+namespace trading
+{
+    // compact reference to an order stored in an OrderPool
+    using OrderHandle = std::uint32_t;
+
+    const OrderHandle NO_ORDER = UINT32_MAX;
+
+    // An order together with its links in the price level queue: what matching and cancelling touch, two to
+    // a cache line and never across two.  The rank slot, only used by deep levels, is kept apart.
+    struct alignas(32) OrderNode
+    {
+        LimitOrder order;
+        OrderHandle prev;
+        OrderHandle next;
+    };
+
+    static_assert(sizeof(OrderNode) == 32, "an order record is half a cache line");
+
+    // Slab of order records owned by the book.  Records are allocated in fixed size chunks, so their
+    // addresses never change, and released records are reused before new ones are carved out.
+    class OrderPool
+    {
+    public:
+        OrderPool() = default;
+        OrderPool(const OrderPool&) = delete;
+        OrderPool& operator=(const OrderPool&) = delete;
+
+        OrderHandle allocate(const LimitOrder& order);
+
+        void release(const OrderHandle handle);
+
+        OrderNode& operator[](const OrderHandle handle);
+
+        const OrderNode& operator[](const OrderHandle handle) const;
+
+        // slot of the order in the rank index of its level, if the level has one, see RankedPriceLevel
+        std::uint32_t& rank(const OrderHandle handle);
+
+        std::uint32_t rank(const OrderHandle handle) const;
+
+        // makes room for the given number of live records, so that allocate doesn't call malloc
+        void reserve(const std::size_t records);
+
+        // live records
+        std::size_t size() const;
+
+        std::size_t capacity() const;
+
+        // bytes held by the records and the rank slots
+        std::size_t memoryUsage() const;
+
+    private:
+        static const int CHUNK_BITS = 12;
+        static const OrderHandle CHUNK_SIZE = 1 << CHUNK_BITS;
+
+        std::vector<std::unique_ptr<OrderNode[]>> chunks;
+        // the rank slots of the records of each chunk
+        std::vector<std::unique_ptr<std::uint32_t[]>> ranks;
+        // records ever handed out, the ones above this are untouched
+        OrderHandle used = 0;
+        std::size_t live = 0;
+        OrderHandle freeList = NO_ORDER;
+
+        void addChunk();
+    };
+}
@@ -0,0 +1,151 @@
+#include <algorithm>
+#include <charconv>
+#include <cmath>
+#include <cstring>
+
+#include "OutputSink.hxx"
+
+namespace trading
+{
+    namespace
+    {
+        const int DOUBLE_DECIMALS = 6;
+        const double DOUBLE_SCALE = 1e6;
+        const std::int64_t POWERS_OF_TEN[] = { 1, 10, 100, 1000, 10000, 100000, 1000000, 10000000, 100000000,
+            1000000000, 10000000000, 100000000000, 1000000000000, 10000000000000, 100000000000000 };
+        const int MAX_DECIMALS = sizeof(POWERS_OF_TEN) / sizeof(POWERS_OF_TEN[0]) - 1;
+
+        // room for any number we print
+        const std::size_t NUMBER_SIZE = 32;
+    }
+
+    OutputSink::OutputSink(std::ostream& _out, const std::size_t _flushSize, const std::chrono::microseconds _maxDelay):
+        out(_out),
+        flushSize(std::max<std::size_t>(_flushSize, 1)),
+        maxDelay(_maxDelay),
+        // a line never has to be split
+        buffer(flushSize + 4096)
+    {}
+
+    OutputSink::~OutputSink()
+    {
+        flush();
+    }
+
+    char* OutputSink::reserve(const std::size_t bytes)
+    {
+        const auto extra = lineStart ? prefix.size() : 0;
+        if (used + extra + bytes > buffer.size())
+        {
+            flush();
+            if (extra + bytes > buffer.size())
+            {
+                buffer.resize(extra + bytes);
+            }
+        }
+        if (used == 0 && maxDelay.count() > 0)
+        {
+            oldest = std::chrono::steady_clock::now();
+        }
+        if (lineStart)
+        {
+            std::memcpy(buffer.data() + used, prefix.data(), extra);
+            used += extra;
+            lineStart = false;
+        }
+        auto res = buffer.data() + used;
+        used += bytes;
+        return res;
+    }
+
+    OutputSink& OutputSink::operator<<(std::string_view text)
+    {
+        std::memcpy(reserve(text.size()), text.data(), text.size());
+        return *this;
+    }
+
+    OutputSink& OutputSink::operator<<(const char c)
+    {
+        *reserve(1) = c;
+        return *this;
+    }
+
+    OutputSink& OutputSink::operator<<(const int value)
+    {
+        return *this << static_cast<long>(value);
+    }
+
+    OutputSink& OutputSink::operator<<(const long value)
+    {
+        auto start = reserve(NUMBER_SIZE);
+        const auto res = std::to_chars(start, start + NUMBER_SIZE, value);
+        used -= NUMBER_SIZE - (res.ptr - start);
+        return *this;
+    }
+
+    OutputSink& OutputSink::operator<<(const FixedPoint number)
+    {
+        const auto decimals = std::min(std::max(number.decimals, 0), MAX_DECIMALS);
+        const auto magnitude = number.value < 0 ? -number.value : number.value;
+        const long units = magnitude / POWERS_OF_TEN[decimals];
+        auto fraction = magnitude % POWERS_OF_TEN[decimals];
+
+        if (number.value < 0)
+        {
+            *this << '-';
+        }
+        *this << units;
+        if (fraction != 0)
+        {
+            char digits[MAX_DECIMALS + 1] = { '.' };
+            for (int i = decimals; i > 0; --i)
+            {
+                digits[i] = static_cast<char>('0' + fraction % 10);
+                fraction /= 10;
+            }
+            auto length = decimals + 1;
+            while (digits[length - 1] == '0')
+            {
+                --length;
+            }
+            *this << std::string_view(digits, length);
+        }
+        return *this;
+    }
+
+    OutputSink& OutputSink::operator<<(const double value)
+    {
+        return *this << FixedPoint { std::llround(value * DOUBLE_SCALE), DOUBLE_DECIMALS };
+    }
+
+    void OutputSink::endLine()
+    {
+        *this << '\n';
+        lineStart = true;
+        if (used >= flushSize
+            || (maxDelay.count() > 0 && std::chrono::steady_clock::now() - oldest >= maxDelay))
+        {
+            flush();
+        }
+    }
+
+    void OutputSink::flush()
+    {
+        if (used > 0)
+        {
+            out.write(buffer.data(), used);
+            out.flush();
+            used = 0;
+        }
+    }
+
+    void OutputSink::setPrefix(std::string_view text)
+    {
+        prefix = text;
+    }
+
+    std::size_t OutputSink::pending() const
+    {
+        return used;
+    }
+}
@@ -0,0 +1,69 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <string_view>
+#include <vector>
+
+namespace trading
+{
+    // a decimal number as value * 10^-decimals, printed without trailing zeros
+    struct FixedPoint
+    {
+        std::int64_t value;
+        int decimals;
+    };
+
+    // Buffered text output for the command processors.  Lines collect in memory and go to the stream
+    // in one write when flush() is called at the end of a batch, when the buffer reaches flushSize,
+    // or, if maxDelay is set, when a line ends and the oldest unwritten line has waited that long.
+    // Numbers are formatted by hand, without the locale machinery of iostreams.
+    class OutputSink
+    {
+    public:
+        explicit OutputSink(std::ostream& _out, const std::size_t _flushSize = 64 * 1024,
+            const std::chrono::microseconds _maxDelay = std::chrono::microseconds::zero());
+
+        OutputSink(const OutputSink&) = delete;
+        OutputSink& operator=(const OutputSink&) = delete;
+
+        ~OutputSink();
+
+        OutputSink& operator<<(std::string_view text);
+
+        OutputSink& operator<<(const char c);
+
+        OutputSink& operator<<(const int value);
+
+        OutputSink& operator<<(const long value);
+
+        OutputSink& operator<<(const FixedPoint value);
+
+        // rounded to six decimals, without trailing zeros
+        OutputSink& operator<<(const double value);
+
+        // ends the line, and flushes if one of the thresholds is reached
+        void endLine();
+
+        void flush();
+
+        // written at the start of every line from now on, the text must outlive its use
+        void setPrefix(std::string_view text);
+
+        // bytes waiting to be written
+        std::size_t pending() const;
+
+    private:
+        std::ostream& out;
+        const std::size_t flushSize;
+        const std::chrono::microseconds maxDelay;
+        std::vector<char> buffer;
+        std::size_t used = 0;
+        std::chrono::steady_clock::time_point oldest;
+        std::string_view prefix;
+        bool lineStart = true;
+
+        char* reserve(const std::size_t bytes);
+    };
+}
@@ -0,0 +1,212 @@
+#include <thread>
+
+#include "Common.hxx"
+#include "LineReader.hxx"
+#include "Pipeline.hxx"
+#include "Report.hxx"
+
+namespace trading
+{
+    namespace
+    {
+        // deeper than anything asked for so far, so that depth queries don't grow it on the matching thread
+        const std::size_t DEPTH_RESERVE = 1024;
+    }
+
+    template <typename Book>
+    BasicPipeline<Book>::BasicPipeline(Book& _book, OutputSink& _out, const PipelineConfig& _config):
+        book(_book),
+        out(_out),
+        config(_config),
+        requests(config.ringCapacity, config.wait),
+        events(config.ringCapacity, config.wait)
+    {
+        snapshot.bids.reserve(DEPTH_RESERVE);
+        snapshot.asks.reserve(DEPTH_RESERVE);
+    }
+
+    template <typename Book>
+    void BasicPipeline<Book>::run(std::istream& in)
+    {
+        std::thread matcher([this] { match(); });
+        std::thread publisher([this] { publish(); });
+
+        const auto& scale = book.getScale();
+        LineReader reader(in);
+        std::string_view line;
+        Command command;
+        while (reader.next(line))
+        {
+            const auto res = parse(line, command);
+            if (res != ParseResult::Ok)
+            {
+                if (res != ParseResult::Empty)
+                {
+                    LOG_LINE(std::cerr, "Cannot parse '" << line << "': " << describe(res));
+                }
+                continue;
+            }
+
+            Request request { command.type, command.side, false, command.id, command.quantity, 0, command.sideName,
+                command.owner, command.scope, Reject::None };
+            const auto priced = command.type == CommandType::Order
+                || (command.type == CommandType::MassCancel && command.scope == CancelScope::Beyond);
+            if (priced && !scale.toTicks(command.price, request.price))
+            {
+                request.rejected = Reject::OffTick;
+            }
+            requests.push(request);
+        }
+
+        requests.push(Request { CommandType::Order, Side::Buy, true, 0, 0, 0, nullptr, 0, CancelScope::Side,
+            Reject::None });
+        matcher.join();
+        publisher.join();
+    }
+
+    template <typename Book>
+    void BasicPipeline<Book>::match()
+    {
+        Request request;
+        while (true)
+        {
+            requests.pop(request);
+            if (request.stop)
+            {
+                events.push(Event { EventType::Stop, nullptr, 0, 0, 0, LimitOrder {}, 0 });
+                return;
+            }
+            try
+            {
+                // a rejection is counted by the book and logged, it has no answer
+                const auto reason = execute(request);
+                if (reason != Reject::None && rejectLog != nullptr)
+                {
+                    rejectLog->log(Rejection { reason, request.type, request.id });
+                }
+            }
+            catch (const TradingError&)
+            {} // the book's rejections are counted, not thrown; whatever else fails, the next request goes on
+        }
+    }
+
+    template <typename Book>
+    Reject BasicPipeline<Book>::execute(const Request& request)
+    {
+        if (request.rejected != Reject::None)
+        {
+            return book.reject(request.rejected);
+        }
+        switch (request.type)
+        {
+            case CommandType::Order:
+                return book.tryAdd(LimitOrder { request.id, request.side, request.price, request.quantity, 0, false,
+                    request.owner }, &onFill, this);
+
+            case CommandType::Amend:
+                return book.tryAmend(request.id, request.quantity);
+
+            case CommandType::Cancel:
+                return book.tryCancel(request.id);
+
+            case CommandType::MassCancel:
+            {
+                int cancelled = 0;
+                return book.tryCancelAll(MassCancel { request.scope, request.side,
+                    request.scope == CancelScope::Beyond ? request.price : request.id, request.quantity }, cancelled);
+            }
+
+            case CommandType::QueryLevel:
+            {
+                int price = 0;
+                int size = 0;
+                const auto reason = book.tryLevel(request.side, request.id, price, size);
+                if (reason == Reject::None)
+                {
+                    events.push(Event { EventType::Level, request.sideName, request.id, price, size, LimitOrder {}, 0 });
+                }
+                return reason;
+            }
+            case CommandType::QueryOrder:
+            {
+                QueryResult result;
+                const auto reason = book.tryQuery(request.id, result);
+                if (reason == Reject::None)
+                {
+                    events.push(Event { EventType::Order, nullptr, 0, 0, 0, *result.order, result.position });
+                }
+                return reason;
+            }
+            case CommandType::QueryDepth:
+            {
+                const auto reason = book.tryDepth(request.id, snapshot);
+                if (reason != Reject::None)
+                {
+                    return reason;
+                }
+                for (std::size_t i = 0; i < snapshot.bids.size(); ++i)
+                {
+                    const auto& bid = snapshot.bids[i];
+                    events.push(Event { EventType::Level, "bid", static_cast<int>(i), bid.price, bid.quantity, LimitOrder {}, 0 });
+                }
+                for (std::size_t i = 0; i < snapshot.asks.size(); ++i)
+                {
+                    const auto& ask = snapshot.asks[i];
+                    events.push(Event { EventType::Level, "ask", static_cast<int>(i), ask.price, ask.quantity, LimitOrder {}, 0 });
+                }
+                return Reject::None;
+            }
+        }
+        return Reject::None;
+    }
+
+    template <typename Book>
+    void BasicPipeline<Book>::setRejectLog(RejectLog* _rejectLog)
+    {
+        rejectLog = _rejectLog;
+    }
+
+    template <typename Book>
+    void BasicPipeline<Book>::onFill(void* context, const Fill& fill)
+    {
+        auto& self = *static_cast<BasicPipeline*>(context);
+        self.events.push(Event { EventType::Fill, nullptr, 0, fill.filledPrice, fill.filledQty, LimitOrder {}, 0 });
+    }
+
+    template <typename Book>
+    void BasicPipeline<Book>::publish()
+    {
+        const auto& scale = book.getScale();
+        Event event;
+        while (true)
+        {
+            if (!events.tryPop(event))
+            {
+                // nothing more for now: write out what there is before waiting
+                out.flush();
+                events.pop(event);
+            }
+            switch (event.type)
+            {
+                case EventType::Fill:
+                    reportFill(out, scale, Fill { event.price, event.quantity });
+                    break;
+
+                case EventType::Level:
+                    reportLevel(out, scale, event.side, event.level, event.price, event.quantity);
+                    break;
+
+                case EventType::Order:
+                    reportOrder(out, QueryResult { &event.order, event.position });
+                    break;
+
+                case EventType::Stop:
+                    out.flush();
+                    return;
+            }
+        }
+    }
+
+    template class BasicPipeline<OrderBook>;
+    template class BasicPipeline<LadderOrderBook>;
+}
@@ -0,0 +1,98 @@
+#pragma once
+
+#include <iostream>
+
+#include "OrderBook.hxx"
+#include "OutputSink.hxx"
+#include "Channel.hxx"
+#include "RejectLog.hxx"
+#include "TextParser.hxx"
+
+namespace trading
+{
+    struct PipelineConfig
+    {
+        std::size_t ringCapacity = 1 << 14;
+        WaitStrategy wait = WaitStrategy::Yield;
+    };
+
+    // Text commands through three threads instead of one: the calling thread reads and parses the input,
+    // a matching thread does nothing but apply commands to the book, and a publishing thread formats the
+    // answers. The stages are connected by Channels. The matching thread copies whatever the answers need
+    // out of the book, so the publisher never touches it, and it neither allocates nor does I/O for
+    // commands the book accepts.
+    template <typename Book>
+    class BasicPipeline
+    {
+    public:
+        BasicPipeline(Book& _book, OutputSink& _out, const PipelineConfig& _config);
+
+        // until the end of the input, answers the same as CommandProcessor over the same lines;
+        // lines which don't parse are reported on stderr and skipped
+        void run(std::istream& in);
+
+        // the rejected commands go to the log from the matching thread, nullptr stops that; set before run()
+        void setRejectLog(RejectLog* _rejectLog);
+
+    private:
+        // a parsed command with its price in ticks
+        struct Request
+        {
+            CommandType type;
+            Side side;
+            bool stop;
+            // order id, level or number of levels, or the first id or the owner of a mass cancel
+            int id;
+            // or the last id of a mass cancel
+            int quantity;
+            // of an order, or of a mass cancel beyond it
+            int price;
+            const char* sideName;
+            int owner;
+            CancelScope scope;
+            // refused before the book saw it, for a price off the tick; counted and logged by the matching thread
+            Reject rejected;
+        };
+
+        enum class EventType: std::uint8_t
+        {
+            Fill,
+            Level,
+            Order,
+            Stop
+        };
+
+        // one line of the answer
+        struct Event
+        {
+            EventType type;
+            // the side to print, for levels
+            const char* side;
+            int level;
+            int price;
+            int quantity;
+            // a copy, for order queries
+            LimitOrder order;
+            int position;
+        };
+
+        Book& book;
+        OutputSink& out;
+        const PipelineConfig config;
+        Channel<Request> requests;
+        Channel<Event> events;
+        DepthSnapshot snapshot;
+        RejectLog* rejectLog = nullptr;
+
+        void match();
+
+        // Reject::None, or why the book refused the request
+        Reject execute(const Request& request);
+
+        void publish();
+
+        static void onFill(void* context, const Fill& fill);
+    };
+
+    using Pipeline = BasicPipeline<OrderBook>;
+}
@@ -0,0 +1,254 @@
+#include <algorithm>
+
+#include "PriceLevel.hxx"
+
+namespace trading
+{
+    QueueRank::QueueRank(const std::size_t orders):
+        nodes(std::max<std::size_t>(2 * orders, RankedPriceLevel::RANK_DEPTH) + 1, Node { 0, 0 })
+    {}
+
+    bool QueueRank::hasRoom() const
+    {
+        return next + 1 < nodes.size();
+    }
+
+    std::uint32_t QueueRank::used() const
+    {
+        return next;
+    }
+
+    void QueueRank::grow()
+    {
+        // the entries past the last slot are written when their slot is handed out
+        nodes.resize(2 * nodes.size());
+    }
+
+    std::uint32_t QueueRank::append(const int quantity)
+    {
+        // the trees are 1-based, the entry of the slot covers the slots since the lowest bit of its index
+        const auto slot = next++;
+        Node node { 1, quantity };
+        for (auto i = slot; i > next - (next & (~next + 1)); i -= i & (~i + 1))
+        {
+            node.count += nodes[i].count;
+            node.quantity += nodes[i].quantity;
+        }
+        nodes[next] = node;
+        return slot;
+    }
+
+    void QueueRank::add(const std::uint32_t slot, const int count, const int quantity)
+    {
+        // the trees are 1-based; entries past the last slot are summed once their slot is handed out
+        for (auto i = slot + 1; i <= next; i += i & (~i + 1))
+        {
+            nodes[i].count += count;
+            nodes[i].quantity += quantity;
+        }
+    }
+
+    void QueueRank::ahead(const std::uint32_t slot, int& count, int& quantity) const
+    {
+        count = 0;
+        quantity = 0;
+        for (auto i = slot; i > 0; i -= i & (~i + 1))
+        {
+            count += nodes[i].count;
+            quantity += nodes[i].quantity;
+        }
+    }
+
+    std::size_t QueueRank::memoryUsage() const
+    {
+        return sizeof(QueueRank) + nodes.capacity() * sizeof(Node);
+    }
+
+    bool PriceLevel::empty() const
+    {
+        return head == NO_ORDER;
+    }
+
+    void PriceLevel::pushBack(OrderPool& pool, const OrderHandle handle)
+    {
+        auto& node = pool[handle];
+        node.prev = tail;
+        node.next = NO_ORDER;
+        if (tail == NO_ORDER)
+        {
+            head = handle;
+        }
+        else
+        {
+            pool[tail].next = handle;
+        }
+        tail = handle;
+        quantity += node.order.leaves();
+        ++count;
+    }
+
+    void PriceLevel::unlink(OrderPool& pool, const OrderHandle handle)
+    {
+        auto& node = pool[handle];
+        if (node.prev == NO_ORDER)
+        {
+            head = node.next;
+        }
+        else
+        {
+            pool[node.prev].next = node.next;
+        }
+        if (node.next == NO_ORDER)
+        {
+            tail = node.prev;
+        }
+        else
+        {
+            pool[node.next].prev = node.prev;
+        }
+        node.prev = node.next = NO_ORDER;
+        quantity -= node.order.leaves();
+        --count;
+    }
+
+    void PriceLevel::clear()
+    {
+        head = tail = NO_ORDER;
+        quantity = 0;
+        count = 0;
+    }
+
+    void PriceLevel::moveToBack(OrderPool& pool, const OrderHandle handle)
+    {
+        if (tail != handle)
+        {
+            unlink(pool, handle);
+            pushBack(pool, handle);
+        }
+    }
+
+    void PriceLevel::adjust(const OrderPool&, const OrderHandle, const int delta)
+    {
+        quantity += delta;
+    }
+
+    int PriceLevel::walk(const OrderPool& pool, const OrderHandle handle, int& quantityAhead) const
+    {
+        int position = 0;
+        quantityAhead = 0;
+        for (auto other = head; other != handle; other = pool[other].next)
+        {
+            ++position;
+            quantityAhead += pool[other].order.leaves();
+        }
+        return position;
+    }
+
+    std::size_t PriceLevel::memoryUsage() const
+    {
+        return 0;
+    }
+
+    const int RankedPriceLevel::RANK_DEPTH;
+
+    void RankedPriceLevel::pushBack(OrderPool& pool, const OrderHandle handle)
+    {
+        PriceLevel::pushBack(pool, handle);
+        if (rank)
+        {
+            if (!rank->hasRoom() && rank->used() < 2u * count)
+            {
+                rank->grow();
+            }
+            if (rank->hasRoom())
+            {
+                pool.rank(handle) = rank->append(pool[handle].order.leaves());
+            }
+            else
+            {
+                buildRank(pool);
+            }
+        }
+    }
+
+    void RankedPriceLevel::unlink(OrderPool& pool, const OrderHandle handle)
+    {
+        PriceLevel::unlink(pool, handle);
+        if (rank)
+        {
+            // well below the depth it was built at, so a level around RANK_DEPTH doesn't rebuild it on and off
+            if (count <= RANK_DEPTH / 2)
+            {
+                rank.reset();
+            }
+            else
+            {
+                rank->add(pool.rank(handle), -1, -pool[handle].order.leaves());
+            }
+        }
+    }
+
+    void RankedPriceLevel::clear()
+    {
+        PriceLevel::clear();
+        rank.reset();
+    }
+
+    void RankedPriceLevel::moveToBack(OrderPool& pool, const OrderHandle handle)
+    {
+        if (tail != handle)
+        {
+            unlink(pool, handle);
+            pushBack(pool, handle);
+        }
+    }
+
+    void RankedPriceLevel::adjust(const OrderPool& pool, const OrderHandle handle, const int delta)
+    {
+        PriceLevel::adjust(pool, handle, delta);
+        if (rank)
+        {
+            rank->add(pool.rank(handle), 0, delta);
+        }
+    }
+
+    int RankedPriceLevel::position(OrderPool& pool, const OrderHandle handle, int& quantityAhead)
+    {
+        if (!rank && count > RANK_DEPTH)
+        {
+            buildRank(pool);
+        }
+        if (rank)
+        {
+            int position;
+            rank->ahead(pool.rank(handle), position, quantityAhead);
+            return position;
+        }
+        return walk(pool, handle, quantityAhead);
+    }
+
+    std::size_t RankedPriceLevel::memoryUsage() const
+    {
+        return rank ? rank->memoryUsage() : 0;
+    }
+
+    void RankedPriceLevel::buildRank(OrderPool& pool)
+    {
+        rank.reset(new QueueRank(count));
+        for (auto handle = head; handle != NO_ORDER; handle = pool[handle].next)
+        {
+            pool.rank(handle) = rank->append(pool[handle].order.leaves());
+        }
+    }
+
+    int RankedQueue::position(Level& level, OrderPool& pool, const OrderHandle handle, int& quantityAhead)
+    {
+        return level.position(pool, handle, quantityAhead);
+    }
+
+    int PlainQueue::position(const Level& level, const OrderPool& pool, const OrderHandle handle,
+        int& quantityAhead)
+    {
+        return level.walk(pool, handle, quantityAhead);
+    }
+}
@@ -0,0 +1,142 @@
+#pragma once
+
+#include <memory>
+#include <vector>
+
+#include "OrderPool.hxx"
+
+namespace trading
+{
+    // Counts and leaves of the orders of a level by their slot, in time priority, as two Fenwick trees:
+    // how many orders and how much quantity are ahead of a slot is a sum over log(slots) entries.
+    // Slots are handed out in arrival order and renumbered from 0 once they run out. The trees only cover
+    // the slots handed out so far: a new slot's entry is summed from the entries just before it, so an
+    // arrival costs a write and rarely more, and changes stop at the last slot.
+    class QueueRank
+    {
+    public:
+        // slots for the given number of orders and as many arrivals again
+        explicit QueueRank(const std::size_t orders);
+
+        // false if there are no more slots, the index must grow or be rebuilt
+        bool hasRoom() const;
+
+        // slots handed out so far, including those of orders gone since
+        std::uint32_t used() const;
+
+        // twice the slots, keeping those handed out
+        void grow();
+
+        // the slot of an order at the back of the queue
+        std::uint32_t append(const int quantity);
+
+        void add(const std::uint32_t slot, const int count, const int quantity);
+
+        // orders and quantity in the slots before the given one
+        void ahead(const std::uint32_t slot, int& count, int& quantity) const;
+
+        std::size_t memoryUsage() const;
+
+    private:
+        // both trees in one array, a lookup touches half the cache lines
+        struct Node
+        {
+            int count;
+            int quantity;
+        };
+
+        std::vector<Node> nodes;
+        std::uint32_t next = 0;
+    };
+
+    // Orders resting at one price, in time priority, as an intrusive list threaded through the pool
+    struct PriceLevel
+    {
+        OrderHandle head = NO_ORDER;
+        OrderHandle tail = NO_ORDER;
+        // total leaves and number of orders, kept up to date as orders come, trade, change and go
+        int quantity = 0;
+        int count = 0;
+
+        bool empty() const;
+
+        void pushBack(OrderPool& pool, const OrderHandle handle);
+
+        void unlink(OrderPool& pool, const OrderHandle handle);
+
+        // forgets the orders all at once, for dropping the whole level; they stay in the pool
+        void clear();
+
+        // moves an order of this level to the back of the queue
+        void moveToBack(OrderPool& pool, const OrderHandle handle);
+
+        // the leaves of an order of this level change by delta, call before changing the order
+        void adjust(const OrderPool& pool, const OrderHandle handle, const int delta);
+
+        // orders ahead of one of this level, and their quantity, by walking the queue from the front
+        int walk(const OrderPool& pool, const OrderHandle handle, int& quantityAhead) const;
+
+        // bytes held outside the level itself
+        std::size_t memoryUsage() const;
+    };
+
+    // A PriceLevel which keeps a QueueRank once asked for a position while deeper than RANK_DEPTH, so that
+    // later positions are found in logarithmic time; every change to the queue updates it from then on
+    struct RankedPriceLevel: PriceLevel
+    {
+        // below this many orders a position is found by walking the queue
+        static const int RANK_DEPTH = 16;
+
+        // built by position(), dropped once the level is down to half of RANK_DEPTH; once out of slots it
+        // grows, or is rebuilt if most of its slots belong to orders gone since
+        std::unique_ptr<QueueRank> rank;
+
+        void pushBack(OrderPool& pool, const OrderHandle handle);
+
+        void unlink(OrderPool& pool, const OrderHandle handle);
+
+        void clear();
+
+        void moveToBack(OrderPool& pool, const OrderHandle handle);
+
+        void adjust(const OrderPool& pool, const OrderHandle handle, const int delta);
+
+        // orders ahead of one of this level, and their quantity; builds the rank index the first time the
+        // level is deep enough for it
+        int position(OrderPool& pool, const OrderHandle handle, int& quantityAhead);
+
+        // bytes held outside the level itself, by its rank index
+        std::size_t memoryUsage() const;
+
+    private:
+        // numbers the orders from the front and indexes them
+        void buildRank(OrderPool& pool);
+    };
+
+    // The QueueT of BasicOrderBook decides the levels of the book and how they find the position of an order in
+    // their queue. RankedQueue keeps a QueueRank on the deep levels once asked, so later queries are logarithmic,
+    // at the cost of keeping it up to date as orders come and go.
+    struct RankedQueue
+    {
+        using Level = RankedPriceLevel;
+
+        static int position(Level& level, OrderPool& pool, const OrderHandle handle, int& quantityAhead);
+    };
+
+    // PlainQueue has plain levels and always walks the queue from the front, for books which are rarely asked
+    // for positions; nothing but the list is kept up to date
+    struct PlainQueue
+    {
+        using Level = PriceLevel;
+
+        static int position(const Level& level, const OrderPool& pool, const OrderHandle handle,
+            int& quantityAhead);
+    };
+
+    // a price level as seen when walking a book side from the top
+    struct LevelRef
+    {
+        int ticks;
+        const PriceLevel* level;
+    };
+}
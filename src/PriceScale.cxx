@@ -0,0 +1,80 @@
+#include <cmath>
+#include <limits>
+
+#include "Common.hxx"
+#include "PriceScale.hxx"
+
+namespace trading
+{
+    namespace
+    {
+        const double POWERS_OF_TEN[] = { 1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9 };
+    }
+
+    PriceScale::PriceScale(const double _tickSize):
+        tickSize(_tickSize),
+        ticksPerUnit(0.0),
+        tickUnits(0),
+        decimalCount(0)
+    {
+        if (tickSize <= 0.0)
+        {
+            LOG_AND_THROW("Tick size must be positive, but is " << tickSize);
+        }
+
+        for (; decimalCount <= MAX_DECIMALS; ++decimalCount)
+        {
+            const auto scaled = tickSize * POWERS_OF_TEN[decimalCount];
+            const auto units = std::round(scaled);
+            if (units >= 1.0 && essentiallyEqual(scaled, units))
+            {
+                tickUnits = static_cast<std::int64_t>(units);
+                ticksPerUnit = POWERS_OF_TEN[decimalCount] / units;
+                return;
+            }
+        }
+        LOG_AND_THROW("Tick size must have at most " << MAX_DECIMALS << " decimals, but is " << tickSize);
+    }
+
+    bool PriceScale::toTicks(const double price, int& ticks) const
+    {
+        const auto exact = price * ticksPerUnit;
+        if (!(std::abs(exact) < std::numeric_limits<int>::max()))
+        {
+            return false;
+        }
+        const auto rounded = std::round(exact);
+        if (rounded != exact && !essentiallyEqual(exact, rounded))
+        {
+            return false;
+        }
+        ticks = static_cast<int>(rounded);
+        return true;
+    }
+
+    int PriceScale::toTicks(const double price) const
+    {
+        int ticks;
+        if (!toTicks(price, ticks))
+        {
+            LOG_AND_THROW("Price must be of given tick size " << tickSize << ", but it's not: " << price);
+        }
+        return ticks;
+    }
+
+    double PriceScale::toPrice(const int ticks) const
+    {
+        // both are exact, so this is the double closest to the decimal price, as if parsed from text
+        return static_cast<double>(toFixed(ticks)) / POWERS_OF_TEN[decimalCount];
+    }
+
+    int PriceScale::decimals() const
+    {
+        return decimalCount;
+    }
+
+    double PriceScale::getTickSize() const
+    {
+        return tickSize;
+    }
+}
@@ -0,0 +1,43 @@
+#pragma once
+
+#include <cstdint>
+
+namespace trading
+{
+    // Prices in the book are whole ticks. The scale of a book converts between ticks and decimal prices,
+    // which is only needed where prices come in as text or go out as text.
+    // Tick sizes are decimal fractions, like 0.05 or 1, with at most MAX_DECIMALS decimals.
+    class PriceScale
+    {
+    public:
+        static const int MAX_DECIMALS = 9;
+
+        PriceScale(const double tickSize);
+
+        // the number of ticks of the price, false if it's not on a tick or out of range
+        bool toTicks(const double price, int& ticks) const;
+
+        // the same, throws if the price is not on a tick
+        int toTicks(const double price) const;
+
+        double toPrice(const int ticks) const;
+
+        // the price in units of 10^-decimals(), exact
+        std::int64_t toFixed(const int ticks) const
+        {
+            return ticks * tickUnits;
+        }
+
+        int decimals() const;
+
+        double getTickSize() const;
+
+    private:
+        double tickSize;
+        // ticks per 1.0, multiplying by it saves a divide
+        double ticksPerUnit;
+        // the tick in units of 10^-decimals
+        std::int64_t tickUnits;
+        int decimalCount;
+    };
+}
@@ -0,0 +1,45 @@
+#include "Reject.hxx"
+
+namespace trading
+{
+    const char* describe(const Reject reason)
+    {
+        switch (reason)
+        {
+            case Reject::None:
+                return "accepted";
+            case Reject::DuplicateId:
+                return "already exists";
+            case Reject::AlreadyCancelled:
+                return "was already cancelled";
+            case Reject::AlreadyFilled:
+                return "was already fully filled";
+            case Reject::IdReused:
+                return "was used before";
+            case Reject::UnknownOrder:
+                return "doesn't exist";
+            case Reject::OrderForgotten:
+                return "has ended and is no longer kept";
+            case Reject::BadSide:
+                return "side must be buy or sell";
+            case Reject::BadPrice:
+                return "price must be positive";
+            case Reject::OffTick:
+                return "price is not a whole number of ticks";
+            case Reject::PriceOutOfRange:
+                return "price is too far from the rest of its side";
+            case Reject::BadQuantity:
+                return "quantity must be positive";
+            case Reject::AmendBelowFilled:
+                return "cannot amend to below the filled quantity";
+            case Reject::NoSuchLevel:
+                return "no such level in the book";
+            case Reject::BadLevelCount:
+                return "level count must be non-negative";
+            case Reject::BadScope:
+                return "unknown kind of mass cancel";
+            default:
+                return "unknown reason";
+        }
+    }
+}
@@ -0,0 +1,40 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace trading
+{
+    // Why a book refused a command, see the try* members of BasicOrderBook. A rejected command changes nothing.
+    enum class Reject: std::uint8_t
+    {
+        // accepted
+        None,
+        // the id rests in the book
+        DuplicateId,
+        AlreadyCancelled,
+        AlreadyFilled,
+        // the order with the id ended and is no longer kept, but the id can't be used again
+        IdReused,
+        UnknownOrder,
+        // ended and no longer kept, so there is nothing to answer a query with
+        OrderForgotten,
+        BadSide,
+        BadPrice,
+        // a decimal price which is not a whole number of ticks of the book, rejected before it gets there
+        OffTick,
+        // too far from the other levels of its side for the book to hold, see LadderBookSide
+        PriceOutOfRange,
+        BadQuantity,
+        AmendBelowFilled,
+        NoSuchLevel,
+        // a depth query for fewer than no levels
+        BadLevelCount,
+        // a mass cancel of none of the kinds in CancelScope
+        BadScope
+    };
+
+    const std::size_t REJECT_REASONS = static_cast<std::size_t>(Reject::BadScope) + 1;
+
+    const char* describe(const Reject reason);
+}
@@ -0,0 +1,128 @@
+#include <string>
+
+#include "RejectLog.hxx"
+
+namespace trading
+{
+    namespace
+    {
+        const char* commandName(const CommandType command)
+        {
+            switch (command)
+            {
+                case CommandType::Order:
+                    return "order";
+                case CommandType::Amend:
+                    return "amend";
+                case CommandType::Cancel:
+                    return "cancel";
+                case CommandType::QueryLevel:
+                    return "level query";
+                case CommandType::QueryOrder:
+                    return "order query";
+                case CommandType::QueryDepth:
+                    return "depth query";
+                case CommandType::MassCancel:
+                    return "mass cancel";
+                default:
+                    return "command";
+            }
+        }
+    }
+
+    RejectLog::RejectLog(std::ostream& _out, const std::size_t _maxPerSecond, const std::size_t capacity):
+        out(_out),
+        maxPerSecond(_maxPerSecond),
+        queue(capacity),
+        writer(&RejectLog::run, this)
+    {}
+
+    RejectLog::~RejectLog()
+    {
+        stopping.store(true, std::memory_order_release);
+        writer.join();
+    }
+
+    void RejectLog::log(const Rejection& rejection)
+    {
+        if (!queue.push(rejection))
+        {
+            dropped.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+
+    std::unique_lock<std::mutex> RejectLog::pause()
+    {
+        return std::unique_lock<std::mutex>(writing);
+    }
+
+    std::uint64_t RejectLog::suppressed() const
+    {
+        return dropped.load(std::memory_order_relaxed) + skipped.load(std::memory_order_relaxed);
+    }
+
+    void RejectLog::run()
+    {
+        auto windowStart = std::chrono::steady_clock::now();
+        std::size_t written = 0;
+        std::uint64_t reported = 0;
+        Rejection rejection;
+        std::string line;
+        while (true)
+        {
+            // whatever stopping says, the queue is drained once more after it was seen
+            const auto last = stopping.load(std::memory_order_acquire);
+            {
+                // the lines are written while holding it, see pause()
+                std::lock_guard<std::mutex> guard(writing);
+                auto wrote = false;
+                while (queue.pop(rejection))
+                {
+                    if (written < maxPerSecond)
+                    {
+                        ++written;
+                        wrote = true;
+                        // one write per line, the stream may be shared with other threads, see SharedOutput
+                        line = "Rejected ";
+                        line += commandName(rejection.command);
+                        line += ' ';
+                        line += std::to_string(rejection.id);
+                        line += ": ";
+                        line += describe(rejection.reason);
+                        line += '\n';
+                        out.write(line.data(), line.size());
+                    }
+                    else
+                    {
+                        skipped.fetch_add(1, std::memory_order_relaxed);
+                    }
+                }
+
+                // what wasn't written is summed up once a second
+                const auto now = std::chrono::steady_clock::now();
+                const auto missing = suppressed();
+                if ((last || now - windowStart >= std::chrono::seconds(1)) && missing != reported)
+                {
+                    line = std::to_string(missing - reported) + " more rejections not logged\n";
+                    out.write(line.data(), line.size());
+                    reported = missing;
+                    wrote = true;
+                }
+                if (now - windowStart >= std::chrono::seconds(1))
+                {
+                    windowStart = now;
+                    written = 0;
+                }
+                if (wrote)
+                {
+                    out.flush();
+                }
+            }
+            if (last)
+            {
+                return;
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        }
+    }
+}
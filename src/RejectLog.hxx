@@ -0,0 +1,61 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <mutex>
+#include <thread>
+
+#include "Reject.hxx"
+#include "SpscRing.hxx"
+#include "TextParser.hxx"
+
+namespace trading
+{
+    struct Rejection
+    {
+        Reject reason;
+        CommandType command;
+        // the order id, the level of a level query or the level count of a depth query
+        int id;
+    };
+
+    // Writes the rejections of one thread to a stream from a thread of its own, so that the thread which
+    // rejected doesn't wait for the write. At most maxPerSecond lines a second are written, the rest only
+    // counted and summed up in a line of their own; so are those which don't fit in the queue.
+    class RejectLog
+    {
+    public:
+        explicit RejectLog(std::ostream& _out, const std::size_t _maxPerSecond = 100, const std::size_t capacity = 4096);
+
+        RejectLog(const RejectLog&) = delete;
+        RejectLog& operator=(const RejectLog&) = delete;
+
+        // writes what's queued and stops the thread
+        ~RejectLog();
+
+        // from the one thread that rejects
+        void log(const Rejection& rejection);
+
+        // rejections not written, so far
+        std::uint64_t suppressed() const;
+
+        // keeps the thread between two writes for as long as the lock is held, so that a fork() in the meantime
+        // doesn't leave the child with a lock the thread had taken, like the one of a SharedOutput
+        std::unique_lock<std::mutex> pause();
+
+    private:
+        std::ostream& out;
+        const std::size_t maxPerSecond;
+        SpscRing<Rejection> queue;
+        std::atomic<std::uint64_t> dropped { 0 };
+        std::atomic<std::uint64_t> skipped { 0 };
+        std::atomic<bool> stopping { false };
+        // held by the thread while it writes
+        std::mutex writing;
+        std::thread writer;
+
+        void run();
+    };
+}
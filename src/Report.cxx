@@ -0,0 +1,47 @@
+#include "Report.hxx"
+
+namespace trading
+{
+    namespace
+    {
+        FixedPoint decimal(const PriceScale& scale, const int ticks)
+        {
+            return FixedPoint { scale.toFixed(ticks), scale.decimals() };
+        }
+    }
+
+    void reportFill(OutputSink& out, const PriceScale& scale, const Fill& fill)
+    {
+        out << "Fill: " << fill.filledQty << '@' << decimal(scale, fill.filledPrice);
+        out.endLine();
+    }
+
+    void reportLevel(OutputSink& out, const PriceScale& scale, const char* side, const int level, const int price,
+        const int size)
+    {
+        out << side << ", " << level << ", " << decimal(scale, price) << ", " << size;
+        out.endLine();
+    }
+
+    void reportDepth(OutputSink& out, const PriceScale& scale, const DepthSnapshot& snapshot)
+    {
+        for (std::size_t level = 0; level < snapshot.bids.size(); ++level)
+        {
+            const auto& bid = snapshot.bids[level];
+            reportLevel(out, scale, "bid", static_cast<int>(level), bid.price, bid.quantity);
+        }
+        for (std::size_t level = 0; level < snapshot.asks.size(); ++level)
+        {
+            const auto& ask = snapshot.asks[level];
+            reportLevel(out, scale, "ask", static_cast<int>(level), ask.price, ask.quantity);
+        }
+    }
+
+    void reportOrder(OutputSink& out, const QueryResult& result)
+    {
+        const auto& order = *result.order;
+        out << order.status() << ", leaves=" << order.leaves() << ", filled=" << order.filledQty
+            << ", position=" << result.position;
+        out.endLine();
+    }
+}
@@ -0,0 +1,20 @@
+#pragma once
+
+#include "OrderBook.hxx"
+#include "OutputSink.hxx"
+
+namespace trading
+{
+    // Text responses, shared by the command processors so that every protocol prints the same.
+    // Prices are in ticks, printed as decimals of the given scale.
+
+    void reportFill(OutputSink& out, const PriceScale& scale, const Fill& fill);
+
+    // side is printed as given
+    void reportLevel(OutputSink& out, const PriceScale& scale, const char* side, const int level, const int price,
+        const int size);
+
+    void reportDepth(OutputSink& out, const PriceScale& scale, const DepthSnapshot& snapshot);
+
+    void reportOrder(OutputSink& out, const QueryResult& result);
+}
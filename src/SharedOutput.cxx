@@ -0,0 +1,43 @@
+#include "SharedOutput.hxx"
+
+namespace trading
+{
+    SharedOutput::SharedOutput(std::ostream& _target):
+        target(_target.rdbuf())
+    {}
+
+    std::streamsize SharedOutput::xsputn(const char* data, const std::streamsize size)
+    {
+        if (target == nullptr)
+        {
+            // a stream without a buffer, like ostream(nullptr), takes nothing
+            return 0;
+        }
+        std::lock_guard<std::mutex> guard(lock);
+        return target->sputn(data, size);
+    }
+
+    SharedOutput::int_type SharedOutput::overflow(const int_type c)
+    {
+        if (target == nullptr)
+        {
+            return traits_type::eof();
+        }
+        if (traits_type::eq_int_type(c, traits_type::eof()))
+        {
+            return traits_type::not_eof(c);
+        }
+        std::lock_guard<std::mutex> guard(lock);
+        return target->sputc(traits_type::to_char_type(c));
+    }
+
+    int SharedOutput::sync()
+    {
+        if (target == nullptr)
+        {
+            return 0;
+        }
+        std::lock_guard<std::mutex> guard(lock);
+        return target->pubsync();
+    }
+}
@@ -0,0 +1,28 @@
+#pragma once
+
+#include <iostream>
+#include <mutex>
+#include <streambuf>
+
+namespace trading
+{
+    // A stream buffer several threads can write to, each write goes to the target in one piece.
+    // Every thread has its own ostream over it, and writes whole lines or blocks of them at once, see
+    // OutputSink and LOG_LINE; a line written a piece at a time can have the lines of others in between.
+    class SharedOutput: public std::streambuf
+    {
+    public:
+        explicit SharedOutput(std::ostream& _target);
+
+    protected:
+        std::streamsize xsputn(const char* data, std::streamsize size) override;
+
+        int_type overflow(int_type c) override;
+
+        int sync() override;
+
+    private:
+        std::streambuf* target;
+        std::mutex lock;
+    };
+}
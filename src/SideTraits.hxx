@@ -0,0 +1,50 @@
+#pragma once
+
+#include <cstddef>
+
+#include "LimitOrder.hxx"
+
+namespace trading
+{
+    // What differs between the sides of a book, fixed at compile time, so that code written for one side
+    // has no branches on it: where the side is kept, where its best price is and which prices cross it.
+    template <Side S>
+    struct SideTraits;
+
+    template <>
+    struct SideTraits<Side::Buy>
+    {
+        static const Side OTHER = Side::Sell;
+        static const std::size_t INDEX = 0;
+
+        template <typename BookSide>
+        static int best(const BookSide& side)
+        {
+            return side.highest();
+        }
+
+        // an order of the other side at the limit takes from a level of this side at ticks
+        static bool crossedBy(const int limit, const int ticks)
+        {
+            return ticks >= limit;
+        }
+    };
+
+    template <>
+    struct SideTraits<Side::Sell>
+    {
+        static const Side OTHER = Side::Buy;
+        static const std::size_t INDEX = 1;
+
+        template <typename BookSide>
+        static int best(const BookSide& side)
+        {
+            return side.lowest();
+        }
+
+        static bool crossedBy(const int limit, const int ticks)
+        {
+            return ticks <= limit;
+        }
+    };
+}
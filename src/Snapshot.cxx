@@ -0,0 +1,259 @@
+#include <cerrno>
+#include <cstdio>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "Common.hxx"
+#include "OrderBook.hxx"
+#include "Snapshot.hxx"
+
+namespace trading
+{
+    namespace
+    {
+        const char MAGIC[8] = { 'O', 'B', 'S', 'N', 'A', 'P', 'S', 'H' };
+        const std::uint32_t BYTE_ORDER_MARK = 0x01020304;
+        const std::size_t BUFFER_SIZE = 1 << 20;
+    }
+
+    SnapshotWriter::SnapshotWriter(const std::string& _path):
+        path(_path),
+        temporary(_path + ".tmp"),
+        buffer(BUFFER_SIZE)
+    {
+        fd = ::open(temporary.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        if (fd < 0)
+        {
+            LOG_AND_THROW("Cannot create the snapshot " << temporary << ": " << std::strerror(errno));
+        }
+    }
+
+    SnapshotWriter::~SnapshotWriter()
+    {
+        if (fd >= 0)
+        {
+            ::close(fd);
+            std::remove(temporary.c_str());
+        }
+    }
+
+    void SnapshotWriter::write(const void* data, const std::size_t size)
+    {
+        if (used + size > buffer.size())
+        {
+            flush();
+            if (size > buffer.size())
+            {
+                buffer.resize(size);
+            }
+        }
+        std::memcpy(buffer.data() + used, data, size);
+        used += size;
+    }
+
+    void SnapshotWriter::flush()
+    {
+        std::size_t written = 0;
+        while (written < used)
+        {
+            const auto res = ::write(fd, buffer.data() + written, used - written);
+            if (res < 0)
+            {
+                if (errno == EINTR)
+                {
+                    continue;
+                }
+                LOG_AND_THROW("Cannot write the snapshot " << temporary << ": " << std::strerror(errno));
+            }
+            written += res;
+        }
+        used = 0;
+    }
+
+    void SnapshotWriter::finish()
+    {
+        flush();
+        if (::fsync(fd) != 0)
+        {
+            LOG_AND_THROW("Cannot sync the snapshot " << temporary << ": " << std::strerror(errno));
+        }
+        ::close(fd);
+        fd = -1;
+        if (std::rename(temporary.c_str(), path.c_str()) != 0)
+        {
+            std::remove(temporary.c_str());
+            LOG_AND_THROW("Cannot move the snapshot to " << path << ": " << std::strerror(errno));
+        }
+    }
+
+    SnapshotReader::SnapshotReader(const std::string& path)
+    {
+        const auto fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0)
+        {
+            LOG_AND_THROW("Cannot open the snapshot " << path << ": " << std::strerror(errno));
+        }
+        struct stat status;
+        if (::fstat(fd, &status) != 0 || status.st_size == 0)
+        {
+            ::close(fd);
+            LOG_AND_THROW("The snapshot " << path << " is empty or can't be read");
+        }
+        size = static_cast<std::size_t>(status.st_size);
+        const auto address = ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+        // the mapping keeps the file
+        ::close(fd);
+        if (address == MAP_FAILED)
+        {
+            LOG_AND_THROW("Cannot map the snapshot " << path << ": " << std::strerror(errno));
+        }
+        data = static_cast<char*>(address);
+        // it's read once, front to back
+        ::madvise(data, size, MADV_SEQUENTIAL);
+    }
+
+    SnapshotReader::~SnapshotReader()
+    {
+        ::munmap(data, size);
+    }
+
+    const char* SnapshotReader::read(const std::size_t bytes)
+    {
+        if (bytes > size - position)
+        {
+            LOG_AND_THROW("The snapshot ends unexpectedly at offset " << position);
+        }
+        const auto res = data + position;
+        position += bytes;
+        return res;
+    }
+
+    bool SnapshotReader::atEnd() const
+    {
+        return position == size;
+    }
+
+    template <typename Book>
+    void saveSnapshot(const Book& book, const std::string& path, const std::uint64_t journalSize)
+    {
+        SnapshotWriter out(path);
+        out.write(snapshot::Header { { MAGIC[0], MAGIC[1], MAGIC[2], MAGIC[3], MAGIC[4], MAGIC[5], MAGIC[6], MAGIC[7] },
+            snapshot::VERSION, BYTE_ORDER_MARK, book.getScale().decimals(), book.getScale().toFixed(1), journalSize });
+        book.save(out);
+        out.finish();
+    }
+
+    template <typename Book>
+    std::uint64_t loadSnapshot(const std::string& path, Book& book)
+    {
+        SnapshotReader in(path);
+        const auto header = in.read<snapshot::Header>();
+        if (std::memcmp(header.magic, MAGIC, sizeof(MAGIC)) != 0 || header.version != snapshot::VERSION
+            || header.byteOrder != BYTE_ORDER_MARK)
+        {
+            LOG_AND_THROW(path << " is not a snapshot of this version and byte order");
+        }
+        if (header.decimals != book.getScale().decimals() || header.tickUnits != book.getScale().toFixed(1))
+        {
+            LOG_AND_THROW("The snapshot " << path << " has prices of a different tick size");
+        }
+        book.restore(in);
+        if (!in.atEnd())
+        {
+            LOG_AND_THROW("The snapshot " << path << " has data after its end");
+        }
+        return header.journalSize;
+    }
+
+    BackgroundSnapshot::~BackgroundSnapshot()
+    {
+        wait();
+    }
+
+    template <typename Book>
+    bool BackgroundSnapshot::start(const Book& book, const std::string& path, const std::uint64_t journalSize)
+    {
+        if (busy())
+        {
+            return false;
+        }
+        const auto pid = ::fork();
+        if (pid < 0)
+        {
+            LOG_AND_THROW("Cannot fork for the snapshot: " << std::strerror(errno));
+        }
+        if (pid == 0)
+        {
+            // the child has the book as it was at the fork, whatever the parent does to it now
+            auto res = 0;
+            try
+            {
+                saveSnapshot(book, path, journalSize);
+            }
+            catch (const TradingError&)
+            {
+                res = 1;
+            }
+            // no destructors, no atexit handlers: they belong to the parent
+            ::_exit(res);
+        }
+        child = pid;
+        return true;
+    }
+
+    bool BackgroundSnapshot::busy()
+    {
+        if (child < 0)
+        {
+            return false;
+        }
+        int status = 0;
+        if (::waitpid(child, &status, WNOHANG) == 0)
+        {
+            return true;
+        }
+        child = -1;
+        return false;
+    }
+
+    bool BackgroundSnapshot::wait()
+    {
+        if (child < 0)
+        {
+            return true;
+        }
+        int status = 0;
+        const auto res = ::waitpid(child, &status, 0);
+        child = -1;
+        return res > 0 && WIFEXITED(status) && WEXITSTATUS(status) == 0;
+    }
+
+    template void saveSnapshot<OrderBook>(const OrderBook& book, const std::string& path,
+        const std::uint64_t journalSize);
+    template void saveSnapshot<LadderOrderBook>(const LadderOrderBook& book, const std::string& path,
+        const std::uint64_t journalSize);
+    template void saveSnapshot<PlainOrderBook>(const PlainOrderBook& book, const std::string& path,
+        const std::uint64_t journalSize);
+    template void saveSnapshot<PlainLadderOrderBook>(const PlainLadderOrderBook& book, const std::string& path,
+        const std::uint64_t journalSize);
+    template void saveSnapshot<SequentialIdOrderBook>(const SequentialIdOrderBook& book, const std::string& path,
+        const std::uint64_t journalSize);
+    template std::uint64_t loadSnapshot<OrderBook>(const std::string& path, OrderBook& book);
+    template std::uint64_t loadSnapshot<LadderOrderBook>(const std::string& path, LadderOrderBook& book);
+    template std::uint64_t loadSnapshot<PlainOrderBook>(const std::string& path, PlainOrderBook& book);
+    template std::uint64_t loadSnapshot<PlainLadderOrderBook>(const std::string& path, PlainLadderOrderBook& book);
+    template std::uint64_t loadSnapshot<SequentialIdOrderBook>(const std::string& path, SequentialIdOrderBook& book);
+    template bool BackgroundSnapshot::start<OrderBook>(const OrderBook& book, const std::string& path,
+        const std::uint64_t journalSize);
+    template bool BackgroundSnapshot::start<LadderOrderBook>(const LadderOrderBook& book, const std::string& path,
+        const std::uint64_t journalSize);
+    template bool BackgroundSnapshot::start<PlainOrderBook>(const PlainOrderBook& book, const std::string& path,
+        const std::uint64_t journalSize);
+    template bool BackgroundSnapshot::start<PlainLadderOrderBook>(const PlainLadderOrderBook& book, const std::string& path,
+        const std::uint64_t journalSize);
+    template bool BackgroundSnapshot::start<SequentialIdOrderBook>(const SequentialIdOrderBook& book,
+        const std::string& path, const std::uint64_t journalSize);
+}
@@ -0,0 +1,156 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <sys/types.h>
+#include <vector>
+
+namespace trading
+{
+    // Binary snapshot of a book, for starting without replaying the day.  After the header come the resting
+    // orders, level by level and in queue order within a level, then the retained terminal orders, oldest
+    // first, then the pages of the filter of dropped ids; each section starts with its record count.
+    // Records are packed and in the byte order of the host, which the header checks, so that loading is a
+    // walk over the mapped file.
+    namespace snapshot
+    {
+        // 2 added the owner of the resting orders
+        const std::uint32_t VERSION = 2;
+
+#pragma pack(push, 1)
+        struct Header
+        {
+            char magic[8];
+            std::uint32_t version;
+            // BYTE_ORDER as written by the host
+            std::uint32_t byteOrder;
+            // the price scale of the book
+            std::int32_t decimals;
+            std::int64_t tickUnits;
+            // bytes of the journal the book had applied, the rest of it comes after the snapshot
+            std::uint64_t journalSize;
+        };
+
+        struct OrderRecord
+        {
+            std::int32_t id;
+            std::uint8_t side;
+            std::int32_t price;
+            std::int32_t quantity;
+            std::int32_t filledQty;
+            std::int32_t owner;
+        };
+
+        struct TerminalRecord
+        {
+            std::int32_t id;
+            std::uint8_t side;
+            std::uint8_t cancelled;
+            std::int32_t quantity;
+            std::int32_t filledQty;
+        };
+#pragma pack(pop)
+    }
+
+    // Buffered writer of a snapshot file.  It goes to a temporary file which replaces the target only once
+    // it's complete and synced, so that a crash never leaves half a snapshot behind.
+    class SnapshotWriter
+    {
+    public:
+        explicit SnapshotWriter(const std::string& _path);
+
+        SnapshotWriter(const SnapshotWriter&) = delete;
+        SnapshotWriter& operator=(const SnapshotWriter&) = delete;
+
+        // drops the temporary file unless finish() was called
+        ~SnapshotWriter();
+
+        void write(const void* data, const std::size_t size);
+
+        template <typename Record>
+        void write(const Record& record)
+        {
+            write(&record, sizeof(Record));
+        }
+
+        // syncs the file and moves it into place
+        void finish();
+
+    private:
+        const std::string path;
+        const std::string temporary;
+        int fd = -1;
+        std::vector<char> buffer;
+        std::size_t used = 0;
+
+        void flush();
+    };
+
+    // A snapshot file mapped into memory and read front to back
+    class SnapshotReader
+    {
+    public:
+        explicit SnapshotReader(const std::string& path);
+
+        SnapshotReader(const SnapshotReader&) = delete;
+        SnapshotReader& operator=(const SnapshotReader&) = delete;
+
+        ~SnapshotReader();
+
+        // the next size bytes, throws if the file ends before them
+        const char* read(const std::size_t size);
+
+        template <typename Record>
+        Record read()
+        {
+            Record record;
+            std::memcpy(&record, read(sizeof(Record)), sizeof(Record));
+            return record;
+        }
+
+        bool atEnd() const;
+
+    private:
+        char* data = nullptr;
+        std::size_t size = 0;
+        std::size_t position = 0;
+    };
+
+    // writes the book's state, with the size of the journal it corresponds to
+    template <typename Book>
+    void saveSnapshot(const Book& book, const std::string& path, const std::uint64_t journalSize = 0);
+
+    // restores an empty book from a snapshot taken with the same tick size, returns the journal size in it
+    template <typename Book>
+    std::uint64_t loadSnapshot(const std::string& path, Book& book);
+
+    // Snapshots taken by a forked child from its copy-on-write image of the book, while the parent carries on
+    // matching; only the fork itself stalls the caller. The child has only the thread that forked, so any other
+    // thread must be kept away from locks while start() forks, as RejectLog::pause() does for its thread;
+    // otherwise the child may wait for ever on one of them, the stderr lock when it reports an error.
+    class BackgroundSnapshot
+    {
+    public:
+        BackgroundSnapshot() = default;
+        BackgroundSnapshot(const BackgroundSnapshot&) = delete;
+        BackgroundSnapshot& operator=(const BackgroundSnapshot&) = delete;
+
+        // waits for the one under way
+        ~BackgroundSnapshot();
+
+        // false if the last one is still being written, then no new one is started
+        template <typename Book>
+        bool start(const Book& book, const std::string& path, const std::uint64_t journalSize = 0);
+
+        // whether one is being written
+        bool busy();
+
+        // waits for the one under way, returns whether it succeeded; true if there was none
+        bool wait();
+
+    private:
+        pid_t child = -1;
+    };
+}
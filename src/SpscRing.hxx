@@ -0,0 +1,99 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+
+namespace trading
+{
+    // Bounded queue between exactly one producer thread and one consumer thread, without locks.
+    // The capacity is rounded up to a power of two. Each side caches the other side's index and only
+    // reloads it when the ring looks full or empty, so the two cache lines are touched rarely.
+    template <typename T>
+    class SpscRing
+    {
+    public:
+        explicit SpscRing(const std::size_t capacity):
+            mask(roundUp(capacity) - 1),
+            slots(new T[mask + 1])
+        {}
+
+        SpscRing(const SpscRing&) = delete;
+        SpscRing& operator=(const SpscRing&) = delete;
+
+        // producer side, false if the ring is full
+        bool push(const T& value)
+        {
+            const auto tail = producer.index.load(std::memory_order_relaxed);
+            if (tail - producer.cached > mask)
+            {
+                producer.cached = consumer.index.load(std::memory_order_acquire);
+                if (tail - producer.cached > mask)
+                {
+                    return false;
+                }
+            }
+            slots[tail & mask] = value;
+            producer.index.store(tail + 1, std::memory_order_release);
+            return true;
+        }
+
+        // consumer side, false if the ring is empty
+        bool pop(T& value)
+        {
+            const auto head = consumer.index.load(std::memory_order_relaxed);
+            if (head == consumer.cached)
+            {
+                consumer.cached = producer.index.load(std::memory_order_acquire);
+                if (head == consumer.cached)
+                {
+                    return false;
+                }
+            }
+            value = slots[head & mask];
+            consumer.index.store(head + 1, std::memory_order_release);
+            return true;
+        }
+
+        // either side, a snapshot which may be stale by the time it's used
+        bool empty() const
+        {
+            return consumer.index.load(std::memory_order_acquire) == producer.index.load(std::memory_order_acquire);
+        }
+
+        bool full() const
+        {
+            return producer.index.load(std::memory_order_acquire) - consumer.index.load(std::memory_order_acquire) > mask;
+        }
+
+        std::size_t capacity() const
+        {
+            return mask + 1;
+        }
+
+    private:
+        static const std::size_t CACHE_LINE = 64;
+
+        // the index one side writes, with its copy of the other side's index, on a cache line of its own
+        struct alignas(CACHE_LINE) Side
+        {
+            std::atomic<std::size_t> index { 0 };
+            std::size_t cached = 0;
+        };
+
+        const std::size_t mask;
+        const std::unique_ptr<T[]> slots;
+        Side producer;
+        Side consumer;
+
+        static std::size_t roundUp(const std::size_t capacity)
+        {
+            std::size_t res = 1;
+            while (res < capacity)
+            {
+                res <<= 1;
+            }
+            return res;
+        }
+    };
+}
@@ -0,0 +1,288 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <iomanip>
+#include <thread>
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+#include "Stats.hxx"
+
+namespace trading
+{
+    namespace
+    {
+        const char* COMMAND_NAMES[] = { "order", "amend", "cancel", "level", "query", "depth", "mass" };
+        const char* OUTCOME_NAMES[] = { "passive", "aggressive", "rejected" };
+
+        double measureTick()
+        {
+#ifdef ORDER_BOOK_STATS_TSC
+            const auto startTime = std::chrono::steady_clock::now();
+            const auto startTicks = timestamp();
+            std::this_thread::sleep_for(std::chrono::milliseconds(20));
+            const auto ticks = timestamp() - startTicks;
+            const std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - startTime;
+            return ticks > 0 ? elapsed.count() / ticks : 1.0;
+#else
+            return 1.0;
+#endif
+        }
+
+        void reportLine(std::ostream& out, const char* name, const char* detail, const LatencyHistogram& histogram)
+        {
+            if (histogram.count() == 0)
+            {
+                return;
+            }
+            const auto nanos = [](const std::uint64_t ticks) { return std::llround(ticks * nanosPerTick()); };
+            out << std::left << std::setw(8) << name << std::setw(12) << detail << std::right
+                << std::setw(12) << histogram.count()
+                << std::setw(10) << nanos(histogram.percentile(0.5))
+                << std::setw(10) << nanos(histogram.percentile(0.99))
+                << std::setw(10) << nanos(histogram.percentile(0.999))
+                << std::setw(12) << nanos(histogram.max()) << '\n';
+        }
+
+#ifdef __linux__
+        int openCounter(const std::uint64_t config)
+        {
+            perf_event_attr attr {};
+            attr.size = sizeof(attr);
+            attr.type = PERF_TYPE_HARDWARE;
+            attr.config = config;
+            attr.exclude_kernel = 1;
+            attr.exclude_hv = 1;
+            return static_cast<int>(syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0));
+        }
+
+        std::uint64_t readCounter(const int fd)
+        {
+            std::uint64_t value = 0;
+            if (fd < 0 || ::read(fd, &value, sizeof(value)) != sizeof(value))
+            {
+                return 0;
+            }
+            return value;
+        }
+#endif
+    }
+
+    double nanosPerTick()
+    {
+        static const double tick = measureTick();
+        return tick;
+    }
+
+    std::size_t LatencyHistogram::bucket(const std::uint64_t value)
+    {
+        if (value < SUB_BUCKETS)
+        {
+            return value;
+        }
+        // the top SUB_BITS + 1 bits of the value: its power of two and where it is within it
+        const int shift = 63 - __builtin_clzll(value) - SUB_BITS;
+        return (shift + 1) * SUB_BUCKETS + (value >> shift) - SUB_BUCKETS;
+    }
+
+    std::uint64_t LatencyHistogram::bucketTop(const std::size_t bucket)
+    {
+        if (bucket < SUB_BUCKETS)
+        {
+            return bucket;
+        }
+        const auto shift = bucket / SUB_BUCKETS - 1;
+        const std::uint64_t mantissa = bucket % SUB_BUCKETS + SUB_BUCKETS;
+        return ((mantissa + 1) << shift) - 1;
+    }
+
+    void LatencyHistogram::record(const std::uint64_t value)
+    {
+        ++counts[bucket(value)];
+        ++total;
+        largest = std::max(largest, value);
+    }
+
+    std::uint64_t LatencyHistogram::count() const
+    {
+        return total;
+    }
+
+    std::uint64_t LatencyHistogram::max() const
+    {
+        return largest;
+    }
+
+    std::uint64_t LatencyHistogram::percentile(const double fraction) const
+    {
+        if (total == 0)
+        {
+            return 0;
+        }
+        const auto rank = std::max<std::uint64_t>(1, static_cast<std::uint64_t>(std::ceil(fraction * total)));
+        std::uint64_t seen = 0;
+        for (std::size_t i = 0; i < BUCKETS; ++i)
+        {
+            seen += counts[i];
+            if (seen >= rank)
+            {
+                return std::min(bucketTop(i), largest);
+            }
+        }
+        return largest;
+    }
+
+    PerfCounters::~PerfCounters()
+    {
+        close();
+    }
+
+    void PerfCounters::close()
+    {
+#ifdef __linux__
+        if (cyclesFd >= 0)
+        {
+            ::close(cyclesFd);
+        }
+        if (missesFd >= 0)
+        {
+            ::close(missesFd);
+        }
+#endif
+        cyclesFd = -1;
+        missesFd = -1;
+    }
+
+    bool PerfCounters::open()
+    {
+#ifdef __linux__
+        if (!isOpen())
+        {
+            cyclesFd = openCounter(PERF_COUNT_HW_CPU_CYCLES);
+            missesFd = openCounter(PERF_COUNT_HW_CACHE_MISSES);
+            // both or none
+            if (!isOpen())
+            {
+                close();
+            }
+        }
+#endif
+        return isOpen();
+    }
+
+    bool PerfCounters::isOpen() const
+    {
+        return cyclesFd >= 0 && missesFd >= 0;
+    }
+
+    void PerfCounters::read(std::uint64_t& cycles, std::uint64_t& cacheMisses) const
+    {
+#ifdef __linux__
+        cycles = readCounter(cyclesFd);
+        cacheMisses = readCounter(missesFd);
+#else
+        cycles = 0;
+        cacheMisses = 0;
+#endif
+    }
+
+    bool CommandStats::enablePerf()
+    {
+        return perf.open();
+    }
+
+    void CommandStats::recordUnparsed(const std::uint64_t start, const std::uint64_t parsed)
+    {
+        unparsed.record(parsed - start);
+        parsing.record(parsed - start);
+    }
+
+    void CommandStats::record(const CommandType type, const Outcome outcome, const std::uint64_t start,
+        const std::uint64_t parsed, const std::uint64_t matched, const std::uint64_t end)
+    {
+        latencies[static_cast<std::size_t>(type)][static_cast<std::size_t>(outcome)].record(end - start);
+        parsing.record(parsed - start);
+        matching.record(matched - parsed);
+        output.record(end - matched);
+    }
+
+    void CommandStats::recordAdd(const int _fills, const int levels)
+    {
+        ++adds;
+        fills += _fills;
+        levelsSwept += levels;
+        mostFills = std::max(mostFills, _fills);
+        mostLevels = std::max(mostLevels, levels);
+    }
+
+    void CommandStats::startCommand()
+    {
+        if (perf.isOpen())
+        {
+            perf.read(startCycles, startMisses);
+        }
+    }
+
+    void CommandStats::endCommand(const CommandType type)
+    {
+        if (perf.isOpen())
+        {
+            std::uint64_t cycles;
+            std::uint64_t misses;
+            perf.read(cycles, misses);
+            auto& totals = perfTotals[static_cast<std::size_t>(type)];
+            ++totals.commands;
+            totals.cycles += cycles - startCycles;
+            totals.cacheMisses += misses - startMisses;
+        }
+    }
+
+    const LatencyHistogram& CommandStats::latency(const CommandType type, const Outcome outcome) const
+    {
+        return latencies[static_cast<std::size_t>(type)][static_cast<std::size_t>(outcome)];
+    }
+
+    void CommandStats::report(std::ostream& out) const
+    {
+        const auto flags = out.flags();
+        const auto precision = out.precision();
+        out << std::left << std::setw(20) << "latency ns" << std::right << std::setw(12) << "count"
+            << std::setw(10) << "p50" << std::setw(10) << "p99" << std::setw(10) << "p99.9" << std::setw(12) << "max" << '\n';
+        for (std::size_t type = 0; type < COMMAND_TYPES; ++type)
+        {
+            for (std::size_t outcome = 0; outcome < latencies[type].size(); ++outcome)
+            {
+                reportLine(out, COMMAND_NAMES[type], OUTCOME_NAMES[outcome], latencies[type][outcome]);
+            }
+        }
+        reportLine(out, "bad", "line", unparsed);
+        reportLine(out, "phase", "parse", parsing);
+        reportLine(out, "phase", "match", matching);
+        reportLine(out, "phase", "output", output);
+
+        if (adds > 0)
+        {
+            out << std::fixed << std::setprecision(2)
+                << "adds " << adds << ", fills " << fills << " (" << static_cast<double>(fills) / adds
+                << " per add, at most " << mostFills << "), levels swept " << levelsSwept << " ("
+                << static_cast<double>(levelsSwept) / adds << " per add, at most " << mostLevels << ")\n";
+        }
+        for (std::size_t type = 0; type < COMMAND_TYPES; ++type)
+        {
+            const auto& totals = perfTotals[type];
+            if (totals.commands > 0)
+            {
+                out << std::fixed << std::setprecision(1) << COMMAND_NAMES[type] << ": "
+                    << static_cast<double>(totals.cycles) / totals.commands << " cycles, "
+                    << static_cast<double>(totals.cacheMisses) / totals.commands << " cache misses per command\n";
+            }
+        }
+        out.flags(flags);
+        out.precision(precision);
+        out.flush();
+    }
+}
@@ -0,0 +1,160 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <iostream>
+
+#include "TextParser.hxx"
+
+#ifdef ORDER_BOOK_STATS
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define ORDER_BOOK_STATS_TSC
+#else
+#include <chrono>
+#endif
+#endif
+
+namespace trading
+{
+    // the instrumentation is compiled out unless ORDER_BOOK_STATS is defined, see CMakeLists.txt
+#ifdef ORDER_BOOK_STATS
+    constexpr bool STATS_ENABLED = true;
+#else
+    constexpr bool STATS_ENABLED = false;
+#endif
+
+    // a cheap timestamp: the TSC on x86, steady_clock nanoseconds elsewhere; see nanosPerTick()
+    inline std::uint64_t timestamp()
+    {
+#if defined(ORDER_BOOK_STATS_TSC)
+        return __rdtsc();
+#elif defined(ORDER_BOOK_STATS)
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+#else
+        return 0;
+#endif
+    }
+
+    // length of a timestamp tick, measured against steady_clock the first time it's asked for
+    double nanosPerTick();
+
+    // Counts of values in log-linear buckets: exact below 16, then 16 buckets per power of two, so any value
+    // is known to within 1/16. Recording is a couple of instructions and never allocates.
+    class LatencyHistogram
+    {
+    public:
+        void record(const std::uint64_t value);
+
+        std::uint64_t count() const;
+
+        std::uint64_t max() const;
+
+        // the value below which the given fraction of the recorded ones are, as the top of its bucket
+        std::uint64_t percentile(const double fraction) const;
+
+    private:
+        static const int SUB_BITS = 4;
+        static const std::uint64_t SUB_BUCKETS = 1 << SUB_BITS;
+        static const std::size_t BUCKETS = (64 - SUB_BITS + 1) * SUB_BUCKETS;
+
+        std::array<std::uint64_t, BUCKETS> counts {};
+        std::uint64_t total = 0;
+        std::uint64_t largest = 0;
+
+        static std::size_t bucket(const std::uint64_t value);
+
+        static std::uint64_t bucketTop(const std::size_t bucket);
+    };
+
+    // how a command ended: an order resting without trading or any other accepted command is passive,
+    // an order that traded is aggressive, and whatever the parser or the book refused is rejected
+    enum class Outcome: std::uint8_t
+    {
+        Passive,
+        Aggressive,
+        Rejected
+    };
+
+    // Hardware counters of the calling thread through perf_event_open, Linux only: cycles and cache misses.
+    // Opening may fail, without the permission to use them for instance, then they read as zero.
+    class PerfCounters
+    {
+    public:
+        PerfCounters() = default;
+        PerfCounters(const PerfCounters&) = delete;
+        PerfCounters& operator=(const PerfCounters&) = delete;
+
+        ~PerfCounters();
+
+        // false if the counters aren't available
+        bool open();
+
+        bool isOpen() const;
+
+        // current values, cycles and cache misses
+        void read(std::uint64_t& cycles, std::uint64_t& cacheMisses) const;
+
+    private:
+        int cyclesFd = -1;
+        int missesFd = -1;
+
+        void close();
+    };
+
+    // What CommandProcessor measures when it is given one: the time of every command from the start of
+    // parsing to the end of its output, by command type and outcome, the time of each phase, what adds did,
+    // and optionally the hardware counters per command type.
+    class CommandStats
+    {
+    public:
+        static const std::size_t COMMAND_TYPES = static_cast<std::size_t>(CommandType::MassCancel) + 1;
+
+        // samples the hardware counters too, false if they can't be had
+        bool enablePerf();
+
+        // a line that didn't parse
+        void recordUnparsed(const std::uint64_t start, const std::uint64_t parsed);
+
+        // timestamps at the start, after parsing, after the book and at the end
+        void record(const CommandType type, const Outcome outcome, const std::uint64_t start,
+            const std::uint64_t parsed, const std::uint64_t matched, const std::uint64_t end);
+
+        void recordAdd(const int fills, const int levels);
+
+        // around a command, for the hardware counters
+        void startCommand();
+
+        void endCommand(const CommandType type);
+
+        const LatencyHistogram& latency(const CommandType type, const Outcome outcome) const;
+
+        // p50, p99, p99.9 and max in nanoseconds of what was recorded, and the counters
+        void report(std::ostream& out) const;
+
+    private:
+        struct PerfTotals
+        {
+            std::uint64_t commands = 0;
+            std::uint64_t cycles = 0;
+            std::uint64_t cacheMisses = 0;
+        };
+
+        std::array<std::array<LatencyHistogram, 3>, COMMAND_TYPES> latencies;
+        LatencyHistogram unparsed;
+        LatencyHistogram parsing;
+        LatencyHistogram matching;
+        LatencyHistogram output;
+        std::uint64_t adds = 0;
+        std::uint64_t fills = 0;
+        std::uint64_t levelsSwept = 0;
+        int mostFills = 0;
+        int mostLevels = 0;
+
+        PerfCounters perf;
+        std::array<PerfTotals, COMMAND_TYPES> perfTotals {};
+        std::uint64_t startCycles = 0;
+        std::uint64_t startMisses = 0;
+    };
+}
@@ -0,0 +1,283 @@
+#include <algorithm>
+#include <cstring>
+
+#include "TerminalStore.hxx"
+#include "Common.hxx"
+
+namespace trading
+{
+    namespace
+    {
+        const std::size_t MIN_RECORDS = 64;
+
+        std::size_t roundUpToPowerOfTwo(const std::size_t n)
+        {
+            std::size_t res = 1;
+            while (res < n)
+            {
+                res <<= 1;
+            }
+            return res;
+        }
+    }
+
+    LimitOrder TerminalRecord::toOrder() const
+    {
+        return LimitOrder { id, side, 0, quantity, filledQty, cancelled };
+    }
+
+    const int IdFilter::PAGE_BITS;
+    const std::uint32_t IdFilter::PAGE_WORDS;
+
+    void IdFilter::insert(const int id)
+    {
+        const auto bit = static_cast<std::uint32_t>(id);
+        const auto page = bit >> PAGE_BITS;
+        if (page >= pages.size())
+        {
+            pages.resize(page + 1);
+        }
+        if (!pages[page])
+        {
+            pages[page].reset(new std::uint64_t[PAGE_WORDS]());
+        }
+        const auto offset = bit & ((1u << PAGE_BITS) - 1);
+        pages[page][offset / 64] |= std::uint64_t(1) << (offset % 64);
+        lowest = std::min(lowest, bit);
+        highest = std::max(highest, bit);
+    }
+
+    bool IdFilter::contains(const int id) const
+    {
+        const auto bit = static_cast<std::uint32_t>(id);
+        if (bit < lowest || bit > highest)
+        {
+            return false;
+        }
+        const auto page = bit >> PAGE_BITS;
+        if (page >= pages.size() || !pages[page])
+        {
+            return false;
+        }
+        const auto offset = bit & ((1u << PAGE_BITS) - 1);
+        return (pages[page][offset / 64] >> (offset % 64)) & 1;
+    }
+
+    std::size_t IdFilter::memoryUsage() const
+    {
+        std::size_t res = pages.capacity() * sizeof(pages[0]);
+        for (const auto& page: pages)
+        {
+            if (page)
+            {
+                res += PAGE_WORDS * sizeof(std::uint64_t);
+            }
+        }
+        return res;
+    }
+
+    void IdFilter::save(SnapshotWriter& out) const
+    {
+        std::uint64_t count = 0;
+        for (const auto& page: pages)
+        {
+            count += page != nullptr;
+        }
+        out.write(count);
+        for (std::uint32_t page = 0; page < pages.size(); ++page)
+        {
+            if (pages[page])
+            {
+                out.write(page);
+                out.write(pages[page].get(), PAGE_WORDS * sizeof(std::uint64_t));
+            }
+        }
+    }
+
+    void IdFilter::restore(SnapshotReader& in)
+    {
+        const auto count = in.read<std::uint64_t>();
+        for (std::uint64_t i = 0; i < count; ++i)
+        {
+            const auto page = in.read<std::uint32_t>();
+            const auto words = in.read(PAGE_WORDS * sizeof(std::uint64_t));
+            if (page >= pages.size())
+            {
+                pages.resize(page + 1);
+            }
+            if (!pages[page])
+            {
+                pages[page].reset(new std::uint64_t[PAGE_WORDS]());
+            }
+            // the whole page, which holds at least one id
+            lowest = std::min(lowest, page << PAGE_BITS);
+            highest = std::max(highest, page << PAGE_BITS | ((1u << PAGE_BITS) - 1));
+            for (std::uint32_t word = 0; word < PAGE_WORDS; ++word)
+            {
+                std::uint64_t bits;
+                std::memcpy(&bits, words + word * sizeof(bits), sizeof(bits));
+                pages[page][word] |= bits;
+            }
+        }
+    }
+
+    TerminalStore::TerminalStore(const RetentionConfig& _config):
+        config(_config)
+    {}
+
+    void TerminalStore::add(const LimitOrder& order)
+    {
+        if (config.maxAge.count() > 0)
+        {
+            const auto now = Clock::now();
+            while (first != next && now - times[first & (times.size() - 1)] >= config.maxAge)
+            {
+                evictOldest();
+            }
+        }
+        if (config.maxOrders != 0 && size() >= config.maxOrders)
+        {
+            evictOldest();
+        }
+        if (size() == records.size())
+        {
+            grow(std::max(MIN_RECORDS, 2 * records.size()));
+        }
+
+        const auto slot = next & (records.size() - 1);
+        records[slot] = TerminalRecord { order.id, order.quantity, order.filledQty, order.side, order.isCancelled };
+        if (config.maxAge.count() > 0)
+        {
+            times[slot] = Clock::now();
+        }
+        index.insert(order.id, static_cast<std::uint32_t>(next));
+        lowestId = std::min(lowestId, order.id);
+        highestId = std::max(highestId, order.id);
+        ++next;
+    }
+
+    const TerminalRecord* TerminalStore::find(const int id) const
+    {
+        if (id < lowestId || id > highestId)
+        {
+            return nullptr;
+        }
+        const auto number = index.find(id);
+        if (number == nullptr)
+        {
+            return nullptr;
+        }
+        return &records[*number & (records.size() - 1)];
+    }
+
+    bool TerminalStore::evicted(const int id) const
+    {
+        return config.filterEvicted && dropped.contains(id);
+    }
+
+    const TerminalRecord* TerminalStore::find(const int id, bool& wasEvicted) const
+    {
+        const auto record = find(id);
+        wasEvicted = record == nullptr && evicted(id);
+        return record;
+    }
+
+    void TerminalStore::prefetch(const int id) const
+    {
+        index.prefetch(id);
+        // and the slot of the record the next add() drops to make room
+        if (config.maxOrders != 0 && size() >= config.maxOrders)
+        {
+            index.prefetch(records[first & (records.size() - 1)].id);
+        }
+    }
+
+    void TerminalStore::reserve(const std::size_t count)
+    {
+        auto wanted = size() + count;
+        if (config.maxOrders != 0)
+        {
+            wanted = std::min(wanted, config.maxOrders);
+        }
+        if (wanted > records.size())
+        {
+            grow(wanted);
+        }
+        if (wanted > size())
+        {
+            index.reserve(wanted - size());
+        }
+    }
+
+    std::size_t TerminalStore::size() const
+    {
+        return static_cast<std::size_t>(next - first);
+    }
+
+    std::size_t TerminalStore::memoryUsage() const
+    {
+        return records.capacity() * sizeof(TerminalRecord) + times.capacity() * sizeof(Clock::time_point)
+            + index.memoryUsage() + dropped.memoryUsage();
+    }
+
+    void TerminalStore::save(SnapshotWriter& out) const
+    {
+        out.write<std::uint64_t>(size());
+        for (auto n = first; n != next; ++n)
+        {
+            const auto& record = records[n & (records.size() - 1)];
+            out.write(snapshot::TerminalRecord { record.id, static_cast<std::uint8_t>(record.side), record.cancelled,
+                record.quantity, record.filledQty });
+        }
+        dropped.save(out);
+    }
+
+    void TerminalStore::restore(SnapshotReader& in)
+    {
+        const auto count = in.read<std::uint64_t>();
+        reserve(count);
+        for (std::uint64_t i = 0; i < count; ++i)
+        {
+            const auto record = in.read<snapshot::TerminalRecord>();
+            add(LimitOrder { record.id, static_cast<Side>(record.side), 0, record.quantity, record.filledQty,
+                record.cancelled != 0 });
+        }
+        if (config.filterEvicted)
+        {
+            dropped.restore(in);
+        }
+        else
+        {
+            IdFilter ignored;
+            ignored.restore(in);
+        }
+    }
+
+    void TerminalStore::grow(const std::size_t capacity)
+    {
+        const auto size = roundUpToPowerOfTwo(capacity);
+        std::vector<TerminalRecord> grown(size);
+        std::vector<Clock::time_point> grownTimes(config.maxAge.count() > 0 ? size : 0);
+        for (auto n = first; n != next; ++n)
+        {
+            grown[n & (size - 1)] = records[n & (records.size() - 1)];
+            if (!grownTimes.empty())
+            {
+                grownTimes[n & (size - 1)] = times[n & (times.size() - 1)];
+            }
+        }
+        records.swap(grown);
+        times.swap(grownTimes);
+    }
+
+    void TerminalStore::evictOldest()
+    {
+        const auto& record = records[first & (records.size() - 1)];
+        index.erase(record.id);
+        if (config.filterEvicted)
+        {
+            dropped.insert(record.id);
+        }
+        ++first;
+    }
+}
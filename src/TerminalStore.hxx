@@ -0,0 +1,133 @@
+#pragma once
+
+#include <chrono>
+#include <climits>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "FlatIdMap.hxx"
+#include "LimitOrder.hxx"
+#include "Snapshot.hxx"
+
+namespace trading
+{
+    // the terminal orders a book keeps unless told otherwise, a few megabytes of records; the ids of older ones
+    // are still known to the IdFilter
+    constexpr std::size_t DEFAULT_KEPT_ORDERS = 1 << 18;
+
+    // How long the book remembers orders after they are cancelled or fully filled
+    struct RetentionConfig
+    {
+        // the most recent terminal orders kept, 0 keeps them all
+        std::size_t maxOrders = DEFAULT_KEPT_ORDERS;
+        // terminal orders older than this are dropped, 0 keeps them regardless of age
+        std::chrono::milliseconds maxAge = std::chrono::milliseconds::zero();
+        // remember the ids of dropped orders, so that they still can't be added again
+        bool filterEvicted = true;
+    };
+
+    // what is left of an order once it's done: enough to answer a query and to reject its id
+    struct TerminalRecord
+    {
+        int id;
+        int quantity;
+        int filledQty;
+        Side side;
+        bool cancelled;
+
+        // the order as a query sees it, the price is not kept
+        LimitOrder toOrder() const;
+    };
+
+    // Exact set of ids, one bit each in pages allocated on first use, compact for dense ids. An id outside
+    // the range of those inserted, like the next of ids handed out in sequence, is answered without a read.
+    class IdFilter
+    {
+    public:
+        void insert(const int id);
+
+        bool contains(const int id) const;
+
+        std::size_t memoryUsage() const;
+
+        // the pages in use, see Snapshot.hxx
+        void save(SnapshotWriter& out) const;
+
+        // adds the ids of saved pages
+        void restore(SnapshotReader& in);
+
+    private:
+        static const int PAGE_BITS = 15;
+        static const std::uint32_t PAGE_WORDS = (1 << PAGE_BITS) / 64;
+
+        std::vector<std::unique_ptr<std::uint64_t[]>> pages;
+        // the lowest and highest id inserted, as unsigned bits
+        std::uint32_t lowest = UINT32_MAX;
+        std::uint32_t highest = 0;
+    };
+
+    // Cancelled and fully filled orders, kept apart from the live ones, in the order they ended.
+    // The oldest go first once there are more than maxOrders or they are older than maxAge.
+    // Like IdFilter, an id outside the range of those ever added is known not to be there without a probe.
+    class TerminalStore
+    {
+    public:
+        explicit TerminalStore(const RetentionConfig& _config);
+
+        TerminalStore(const TerminalStore&) = delete;
+        TerminalStore& operator=(const TerminalStore&) = delete;
+
+        void add(const LimitOrder& order);
+
+        // the record of a recently ended order, nullptr if there is none
+        const TerminalRecord* find(const int id) const;
+
+        // the id belonged to an order whose record was dropped, only known with filterEvicted
+        bool evicted(const int id) const;
+
+        // find(), falling back to evicted() only for an id without a record: the book's one lookup of an id
+        // which isn't resting
+        const TerminalRecord* find(const int id, bool& wasEvicted) const;
+
+        // brings what find() and add() of the id touch first into the cache
+        void prefetch(const int id) const;
+
+        // makes room for the given number of new records, so that adding them doesn't call malloc
+        void reserve(const std::size_t count);
+
+        // records kept
+        std::size_t size() const;
+
+        // bytes held by the records, their index and the dropped ids
+        std::size_t memoryUsage() const;
+
+        // the records oldest first, then the dropped ids
+        void save(SnapshotWriter& out) const;
+
+        // adds saved records after the ones kept, dropping by this store's limits
+        void restore(SnapshotReader& in);
+
+    private:
+        using Clock = std::chrono::steady_clock;
+
+        const RetentionConfig config;
+        // a ring with a power of two size, record n lives at n & (size - 1)
+        std::vector<TerminalRecord> records;
+        // when each record was added, only with maxAge
+        std::vector<Clock::time_point> times;
+        // numbers of the oldest kept and of the next record
+        std::uint64_t first = 0;
+        std::uint64_t next = 0;
+        // id to the low bits of its record number, which are all the ring's position needs; the same flat table
+        // as the book's index of the resting orders, with slots of 8 bytes
+        FlatIdMap<std::uint32_t> index;
+        int lowestId = INT_MAX;
+        int highestId = INT_MIN;
+        IdFilter dropped;
+
+        void grow(const std::size_t capacity);
+
+        void evictOldest();
+    };
+}
@@ -0,0 +1,291 @@
+#include <charconv>
+#include <cstdlib>
+#include <cstring>
+
+#include "TextParser.hxx"
+
+namespace trading
+{
+    namespace
+    {
+        const double POWERS_OF_TEN[] = {
+            1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+            1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+        };
+
+        // integers up to this are exact doubles
+        const std::uint64_t MAX_EXACT = std::uint64_t(1) << 53;
+
+        bool isSpace(const char c)
+        {
+            return c == ' ' || c == '\t' || c == '\r' || c == '\n';
+        }
+
+        ParseResult parseInt(std::string_view& text, int& value)
+        {
+            const auto token = nextToken(text);
+            if (token.empty())
+            {
+                return ParseResult::MissingArgument;
+            }
+            const auto res = std::from_chars(token.data(), token.data() + token.size(), value);
+            if (res.ec != std::errc() || res.ptr != token.data() + token.size())
+            {
+                return ParseResult::BadNumber;
+            }
+            return ParseResult::Ok;
+        }
+
+        ParseResult parseSide(std::string_view& text, Side& side, const char*& name)
+        {
+            const auto token = nextToken(text);
+            if (token.empty())
+            {
+                return ParseResult::MissingArgument;
+            }
+            if (token == "buy")
+            {
+                side = Side::Buy;
+                name = "buy";
+            }
+            else if (token == "bid")
+            {
+                side = Side::Buy;
+                name = "bid";
+            }
+            else if (token == "sell")
+            {
+                side = Side::Sell;
+                name = "sell";
+            }
+            else if (token == "ask")
+            {
+                side = Side::Sell;
+                name = "ask";
+            }
+            else
+            {
+                return ParseResult::BadSide;
+            }
+            return ParseResult::Ok;
+        }
+
+        ParseResult parsePriceToken(std::string_view& text, double& price)
+        {
+            const auto token = nextToken(text);
+            if (token.empty())
+            {
+                return ParseResult::MissingArgument;
+            }
+            return parsePrice(token, price) ? ParseResult::Ok : ParseResult::BadNumber;
+        }
+    }
+
+    std::string_view nextToken(std::string_view& text)
+    {
+        std::size_t begin = 0;
+        while (begin < text.size() && isSpace(text[begin]))
+        {
+            ++begin;
+        }
+        auto end = begin;
+        while (end < text.size() && !isSpace(text[end]))
+        {
+            ++end;
+        }
+        const auto token = text.substr(begin, end - begin);
+        text.remove_prefix(end);
+        return token;
+    }
+
+    const char* describe(const ParseResult result)
+    {
+        switch (result)
+        {
+            case ParseResult::Ok:
+                return "ok";
+            case ParseResult::Empty:
+                return "empty line";
+            case ParseResult::UnknownCommand:
+                return "unknown command";
+            case ParseResult::BadSide:
+                return "unknown side";
+            case ParseResult::BadNumber:
+                return "bad number";
+            case ParseResult::MissingArgument:
+                return "missing argument";
+            case ParseResult::UnknownSymbol:
+                return "unknown symbol";
+            default:
+                return "unknown error";
+        }
+    }
+
+    bool parsePrice(std::string_view text, double& price)
+    {
+        std::size_t pos = 0;
+        const auto negative = !text.empty() && text[0] == '-';
+        if (negative)
+        {
+            ++pos;
+        }
+
+        std::uint64_t mantissa = 0;
+        int decimals = 0;
+        int digits = 0;
+        bool exact = true;
+        bool point = false;
+        for (; pos < text.size(); ++pos)
+        {
+            const auto c = text[pos];
+            if (c == '.' && !point)
+            {
+                point = true;
+                continue;
+            }
+            if (c < '0' || c > '9')
+            {
+                return false;
+            }
+            ++digits;
+            if (mantissa >= MAX_EXACT / 10)
+            {
+                exact = false;
+                continue;
+            }
+            mantissa = mantissa * 10 + (c - '0');
+            if (point)
+            {
+                ++decimals;
+            }
+        }
+        if (digits == 0)
+        {
+            return false;
+        }
+
+        if (exact && decimals < static_cast<int>(sizeof(POWERS_OF_TEN) / sizeof(POWERS_OF_TEN[0])))
+        {
+            // both are exact, so the division is rounded once, just like strtod
+            price = static_cast<double>(mantissa) / POWERS_OF_TEN[decimals];
+        }
+        else
+        {
+            // too many digits for the fast path, fall back on the C library
+            char buffer[64];
+            if (text.size() >= sizeof(buffer))
+            {
+                return false;
+            }
+            std::memcpy(buffer, text.data(), text.size());
+            buffer[text.size()] = 0;
+            price = std::strtod(buffer, nullptr);
+            return true;
+        }
+        if (negative)
+        {
+            price = -price;
+        }
+        return true;
+    }
+
+    ParseResult parse(std::string_view line, Command& command)
+    {
+        const auto cmd = nextToken(line);
+        if (cmd.empty())
+        {
+            return ParseResult::Empty;
+        }
+
+        command.id = 0;
+        command.sideName = nullptr;
+        command.quantity = 0;
+        command.price = 0.0;
+        command.owner = 0;
+
+        ParseResult res;
+        if (cmd == "order") {
+            command.type = CommandType::Order;
+            if ((res = parseInt(line, command.id)) != ParseResult::Ok
+                || (res = parseSide(line, command.side, command.sideName)) != ParseResult::Ok
+                || (res = parseInt(line, command.quantity)) != ParseResult::Ok
+                || (res = parsePriceToken(line, command.price)) != ParseResult::Ok)
+            {
+                return res;
+            }
+            auto rest = line;
+            if (!nextToken(rest).empty())
+            {
+                return parseInt(line, command.owner);
+            }
+        }
+        else if (cmd == "amend") {
+            command.type = CommandType::Amend;
+            if ((res = parseInt(line, command.id)) != ParseResult::Ok
+                || (res = parseInt(line, command.quantity)) != ParseResult::Ok)
+            {
+                return res;
+            }
+        }
+        else if (cmd == "cancel") {
+            auto rest = line;
+            const auto scope = nextToken(rest);
+            if (scope == "all") {
+                command.type = CommandType::MassCancel;
+                command.scope = CancelScope::Side;
+                return parseSide(rest, command.side, command.sideName);
+            }
+            else if (scope == "beyond") {
+                command.type = CommandType::MassCancel;
+                command.scope = CancelScope::Beyond;
+                if ((res = parseSide(rest, command.side, command.sideName)) != ParseResult::Ok)
+                {
+                    return res;
+                }
+                return parsePriceToken(rest, command.price);
+            }
+            else if (scope == "ids") {
+                command.type = CommandType::MassCancel;
+                command.scope = CancelScope::Ids;
+                if ((res = parseInt(rest, command.id)) != ParseResult::Ok)
+                {
+                    return res;
+                }
+                return parseInt(rest, command.quantity);
+            }
+            else if (scope == "owner") {
+                command.type = CommandType::MassCancel;
+                command.scope = CancelScope::Owner;
+                return parseInt(rest, command.id);
+            }
+            command.type = CommandType::Cancel;
+            return parseInt(line, command.id);
+        }
+        else if (cmd == "q") {
+            const auto subCmd = nextToken(line);
+            if (subCmd == "level") {
+                command.type = CommandType::QueryLevel;
+                if ((res = parseSide(line, command.side, command.sideName)) != ParseResult::Ok
+                    || (res = parseInt(line, command.id)) != ParseResult::Ok)
+                {
+                    return res;
+                }
+            }
+            else if (subCmd == "order") {
+                command.type = CommandType::QueryOrder;
+                return parseInt(line, command.id);
+            }
+            else if (subCmd == "depth") {
+                command.type = CommandType::QueryDepth;
+                return parseInt(line, command.id);
+            }
+            else {
+                return subCmd.empty() ? ParseResult::MissingArgument : ParseResult::UnknownCommand;
+            }
+        }
+        else {
+            return ParseResult::UnknownCommand;
+        }
+        return ParseResult::Ok;
+    }
+}
@@ -0,0 +1,67 @@
+#pragma once
+
+#include <cstdint>
+#include <string_view>
+
+#include "LimitOrder.hxx"
+#include "MassCancel.hxx"
+
+namespace trading
+{
+    enum class CommandType: std::uint8_t
+    {
+        Order,
+        Amend,
+        Cancel,
+        QueryLevel,
+        QueryOrder,
+        QueryDepth,
+        MassCancel
+    };
+
+
+    // One parsed command, whichever protocol it came from
+    struct Command
+    {
+        CommandType type;
+        Side side;
+        // order id, or the level, or the number of levels for the level queries, or the first id or the owner
+        // of a mass cancel
+        int id;
+        // or the last id of a mass cancel
+        int quantity;
+        double price;
+        // of an order, 0 if none is given
+        int owner;
+        CancelScope scope;
+        // the side as it was written, level queries answer with it
+        const char* sideName;
+    };
+
+    enum class ParseResult: std::uint8_t
+    {
+        Ok,
+        // nothing but white space, not an error
+        Empty,
+        UnknownCommand,
+        BadSide,
+        BadNumber,
+        MissingArgument,
+        // multi-symbol commands only, see Engine
+        UnknownSymbol
+    };
+
+    const char* describe(const ParseResult result);
+
+    // Parses one line of the text protocol, without allocating and without throwing.
+    // Anything after the last argument is ignored, but for the optional owner after the price of an order.
+    // Besides cancel <id>, a mass cancel is one of: cancel all <side>, cancel beyond <side> <price>,
+    // cancel ids <first> <last>, cancel owner <owner>.
+    ParseResult parse(std::string_view line, Command& command);
+
+    // cuts the next white space separated token off the front of text, empty if there is none
+    std::string_view nextToken(std::string_view& text);
+
+    // parses a price like 12.30 or 12, exactly like strtod would, but without locale or allocations
+    bool parsePrice(std::string_view text, double& price);
+}
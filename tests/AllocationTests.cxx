@@ -0,0 +1,125 @@
+#include <atomic>
+#include <cstdlib>
+#include <new>
+#include <gtest/gtest.h>
+
+#include "OrderBook.hxx"
+
+using namespace trading;
+
+// counts every call to the global allocator of the test binary
+namespace
+{
+    std::atomic<long> g_allocations(0);
+}
+
+void* operator new(std::size_t size)
+{
+    ++g_allocations;
+    if (auto p = std::malloc(size == 0 ? 1 : size))
+    {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+
+void* operator new[](std::size_t size)
+{
+    return operator new(size);
+}
+
+void operator delete(void* p) noexcept
+{
+    std::free(p);
+}
+
+void operator delete[](void* p) noexcept
+{
+    std::free(p);
+}
+
+void operator delete(void* p, std::size_t) noexcept
+{
+    std::free(p);
+}
+
+void operator delete[](void* p, std::size_t) noexcept
+{
+    std::free(p);
+}
+
+namespace
+{
+    template <typename Book>
+    class AllocationTest: public ::testing::Test
+    {};
+
+    using BookTypes = ::testing::Types<OrderBook, LadderOrderBook, PlainOrderBook, PlainLadderOrderBook,
+    SequentialIdOrderBook>;
+}
+
+TYPED_TEST_SUITE(AllocationTest, BookTypes);
+
+TYPED_TEST(AllocationTest, no_allocations_after_warm_up)
+{
+    TypeParam book(0.05);
+    book.reserve(10000);
+
+    // prices in ticks of 0.05
+    int id = 0;
+    for (int level = 0; level < 10; ++level)
+    {
+        book.add(LimitOrder { ++id, Side::Buy, 200 - level, 100, 0 });
+        book.add(LimitOrder { ++id, Side::Sell, 220 + level, 100, 0 });
+    }
+    // a level which comes and goes
+    book.add(LimitOrder { ++id, Side::Buy, 180, 10, 0 });
+    book.cancel(id);
+
+    const auto before = g_allocations.load();
+    for (int i = 0; i < 1000; ++i)
+    {
+        book.add(LimitOrder { ++id, i % 2 ? Side::Buy : Side::Sell, i % 2 ? 200 : 220, 100, 0 });
+        book.amend(id, 150);
+        book.amend(id, 50);
+        book.query(id);
+        book.cancel(id);
+
+        book.add(LimitOrder { ++id, Side::Buy, 180, 10, 0 });
+        book.cancel(id);
+    }
+    const auto after = g_allocations.load();
+
+    ASSERT_EQ(before, after);
+    ASSERT_EQ(100, book.sizeAt(Side::Buy, 0));
+    ASSERT_EQ("cancelled", book.query(id).order->status());
+}
+
+TYPED_TEST(AllocationTest, no_allocations_in_a_large_sweep)
+{
+    TypeParam book(0.05);
+    book.reserve(2000);
+    FillBuffer fills(1000);
+
+    int id = 0;
+    for (int level = 0; level < 100; ++level)
+    {
+        for (int i = 0; i < 10; ++i)
+        {
+            book.add(LimitOrder { ++id, Side::Sell, 200 + level, 10, 0 });
+        }
+    }
+    // a first level of the other side, for the one the buy will rest at
+    book.add(LimitOrder { ++id, Side::Buy, 100, 10, 0 });
+    book.cancel(id);
+
+    const auto before = g_allocations.load();
+    // takes all of them and rests with the rest
+    book.add(LimitOrder { ++id, Side::Buy, 400, 10005, 0 }, fills);
+    const auto after = g_allocations.load();
+
+    ASSERT_EQ(before, after);
+    ASSERT_EQ(1000u, fills.size());
+    ASSERT_EQ(299, fills[999].filledPrice);
+    ASSERT_EQ(5, book.sizeAt(Side::Buy, 0));
+}
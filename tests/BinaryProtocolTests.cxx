@@ -0,0 +1,77 @@
+#include <sstream>
+#include <vector>
+#include <gtest/gtest.h>
+
+#include "Common.hxx"
+#include "OrderBook.hxx"
+#include "CommandProcessor.hxx"
+#include "BinaryProtocol.hxx"
+#include "BinaryProcessor.hxx"
+#include "Session.hxx"
+
+using namespace trading;
+
+TEST(BinaryProtocolTest, encode_and_decode)
+{
+    char buffer[binary::MAX_MESSAGE_SIZE];
+    ASSERT_EQ(sizeof(binary::OrderMessage), binary::fromText("order 7 sell 25 10.10", 0.05, buffer));
+    ASSERT_EQ(sizeof(binary::OrderMessage), binary::messageSize(buffer));
+
+    binary::OrderMessage order;
+    binary::decode(buffer, order);
+    ASSERT_EQ(static_cast<std::uint8_t>(binary::MessageType::Order), order.type);
+    ASSERT_EQ(static_cast<std::uint8_t>(Side::Sell), order.side);
+    ASSERT_EQ(7, order.id);
+    ASSERT_EQ(25, order.quantity);
+    ASSERT_EQ(202, order.price);
+    // the id is little-endian on the wire
+    ASSERT_EQ(7, buffer[2]);
+    ASSERT_EQ(0, buffer[5]);
+
+    ASSERT_EQ(0, binary::fromText("order 7 sell 25 10.11", 0.05, buffer));
+    ASSERT_EQ(0, binary::fromText("order 7 short 25 10.10", 0.05, buffer));
+    ASSERT_EQ(0, binary::fromText("hello", 0.05, buffer));
+
+    buffer[0] = 42;
+    ASSERT_EQ(0, binary::messageSize(buffer));
+}
+
+TEST(BinaryProtocolTest, same_output_as_text)
+{
+    OrderBook textBook(0.05);
+    std::ostringstream textOut;
+    OutputSink textSink(textOut);
+    CommandProcessor text(textBook, textSink);
+    std::string stream;
+    for (const auto& line: SESSION)
+    {
+        try
+        {
+            text.handle(line);
+        }
+        catch (const TradingError&)
+        {}
+
+        char buffer[binary::MAX_MESSAGE_SIZE];
+        stream.append(buffer, binary::fromText(line, 0.05, buffer));
+    }
+
+    OrderBook binaryBook(0.05);
+    std::ostringstream binaryOut;
+    OutputSink binarySink(binaryOut);
+    BinaryProcessor processor(binaryBook, binarySink);
+    // split in two, so that a message is cut in half
+    const auto half = stream.size() / 2;
+    const auto used = processor.handleAll(stream.data(), half);
+    ASSERT_GE(half, used);
+    const auto rest = stream.substr(used);
+    ASSERT_EQ(rest.size(), processor.handleAll(rest.data(), rest.size()));
+
+    textSink.flush();
+    binarySink.flush();
+    ASSERT_FALSE(textOut.str().empty());
+    ASSERT_EQ(textOut.str(), binaryOut.str());
+
+    const char garbage[] = { 99, 0, 0, 0, 0 };
+    ASSERT_THROW(processor.handleAll(garbage, sizeof(garbage)), TradingError);
+}
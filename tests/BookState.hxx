@@ -0,0 +1,39 @@
+#pragma once
+
+#include <sstream>
+#include <string>
+
+#include "Common.hxx"
+#include "OrderBook.hxx"
+#include "OutputSink.hxx"
+#include "Report.hxx"
+
+namespace
+{
+    // status, fills and queue position of the orders with ids in [first, last] the book knows, then its depth,
+    // for comparing books which should be the same
+    template <typename Book>
+    std::string describeBook(Book& book, const int first, const int last)
+    {
+        std::ostringstream text;
+        trading::OutputSink out(text);
+        for (int id = first; id <= last; ++id)
+        {
+            try
+            {
+                out << id << ": ";
+                trading::reportOrder(out, book.query(id));
+            }
+            catch (const trading::TradingError&)
+            {
+                out << "unknown";
+                out.endLine();
+            }
+        }
+        trading::DepthSnapshot snapshot;
+        book.depth(1000, snapshot);
+        trading::reportDepth(out, book.getScale(), snapshot);
+        out.flush();
+        return text.str();
+    }
+}
@@ -0,0 +1,221 @@
+#include <chrono>
+#include <ctime>
+#include <map>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+#include <gtest/gtest.h>
+
+#include "Common.hxx"
+#include "OrderBook.hxx"
+#include "CommandProcessor.hxx"
+#include "Engine.hxx"
+#include "SharedOutput.hxx"
+#include "SpscRing.hxx"
+#include "Session.hxx"
+
+using namespace trading;
+
+namespace
+{
+    // the session on a book of its own, each answer prefixed by the symbol
+    std::vector<std::string> expected(const std::string& symbol, const double tickSize)
+    {
+        OrderBook book(tickSize);
+        std::ostringstream text;
+        {
+            OutputSink out(text);
+            CommandProcessor processor(book, out);
+            for (const auto& line: SESSION)
+            {
+                try
+                {
+                    processor.handle(line);
+                }
+                catch (const TradingError&)
+                {}
+            }
+        }
+        std::vector<std::string> lines;
+        std::istringstream in(text.str());
+        for (std::string line; std::getline(in, line);)
+        {
+            lines.push_back(symbol + " " + line);
+        }
+        return lines;
+    }
+}
+
+TEST(SpscRingTest, wraps_around_and_fills_up)
+{
+    SpscRing<int> ring(5);
+    ASSERT_EQ(8, ring.capacity());
+    ASSERT_TRUE(ring.empty());
+
+    int value = 0;
+    for (int round = 0; round < 3; ++round)
+    {
+        for (int i = 0; i < 8; ++i)
+        {
+            ASSERT_TRUE(ring.push(round * 10 + i));
+        }
+        ASSERT_FALSE(ring.push(99));
+        for (int i = 0; i < 8; ++i)
+        {
+            ASSERT_TRUE(ring.pop(value));
+            ASSERT_EQ(round * 10 + i, value);
+        }
+        ASSERT_FALSE(ring.pop(value));
+    }
+}
+
+TEST(SpscRingTest, keeps_order_across_threads)
+{
+    SpscRing<int> ring(64);
+    const int count = 100000;
+    std::thread producer([&ring] {
+        for (int i = 0; i < count; ++i)
+        {
+            while (!ring.push(i))
+            {
+                std::this_thread::yield();
+            }
+        }
+    });
+
+    int value;
+    for (int i = 0; i < count; ++i)
+    {
+        while (!ring.pop(value))
+        {
+            std::this_thread::yield();
+        }
+        ASSERT_EQ(i, value);
+    }
+    producer.join();
+}
+
+TEST(EngineTest, symbols_on_shards_answer_in_order)
+{
+    // the same ids and prices on every symbol; 12.15 is off the tick of C
+    const std::map<std::string, double> ticks = { { "A", 0.05 }, { "B", 0.01 }, { "C", 0.1 }, { "D", 0.05 } };
+
+    std::ostringstream text;
+    {
+        EngineConfig config;
+        config.shards = 3;
+        config.queueCapacity = 4;
+        Engine engine(text, config);
+        for (const auto& symbol: ticks)
+        {
+            std::ostringstream definition;
+            definition << "symbol " << symbol.first << " " << symbol.second;
+            ASSERT_EQ(ParseResult::Ok, engine.handle(definition.str()));
+        }
+        ASSERT_EQ(4, engine.symbolCount());
+
+        // interleaved, a line for each symbol in turn
+        for (const auto& line: SESSION)
+        {
+            for (const auto& symbol: ticks)
+            {
+                ASSERT_EQ(ParseResult::Ok, engine.handle(symbol.first + " " + line));
+            }
+        }
+        engine.drain();
+    }
+
+    std::map<std::string, std::vector<std::string>> bySymbol;
+    std::istringstream in(text.str());
+    for (std::string line; std::getline(in, line);)
+    {
+        bySymbol[line.substr(0, line.find(' '))].push_back(line);
+    }
+    for (const auto& symbol: ticks)
+    {
+        ASSERT_EQ(expected(symbol.first, symbol.second), bySymbol[symbol.first]) << symbol.first;
+    }
+}
+
+TEST(EngineTest, symbol_errors)
+{
+    std::ostringstream text;
+    Engine engine(text, EngineConfig {});
+    ASSERT_EQ(ParseResult::Ok, engine.handle("symbol X 0.5"));
+    ASSERT_THROW(engine.handle("symbol X 0.1"), TradingError);
+    ASSERT_THROW(engine.handle("symbol Y 0"), TradingError);
+    ASSERT_EQ(ParseResult::MissingArgument, engine.handle("symbol Z"));
+    ASSERT_EQ(ParseResult::BadNumber, engine.handle("symbol Z abc"));
+    ASSERT_EQ(ParseResult::UnknownSymbol, engine.handle("Z order 1 buy 10 1.0"));
+    ASSERT_EQ(ParseResult::UnknownCommand, engine.handle("X hello"));
+    ASSERT_EQ(ParseResult::Empty, engine.handle("  "));
+
+    ASSERT_EQ(ParseResult::Ok, engine.handle("X order 1 buy 10 1.5"));
+    ASSERT_EQ(ParseResult::Ok, engine.handle("X order 2 buy 10 1.2"));
+    ASSERT_EQ(ParseResult::Ok, engine.handle("X q level bid 0"));
+    engine.drain();
+    ASSERT_EQ("X bid, 0, 1.5, 10\n", text.str());
+
+    ASSERT_THROW(Engine(text, EngineConfig { 0 }), TradingError);
+}
+
+TEST(EngineTest, idle_shards_leave_their_cores)
+{
+    std::ostringstream text;
+    EngineConfig config;
+    config.shards = 4;
+    Engine engine(text, config);
+    ASSERT_EQ(ParseResult::Ok, engine.handle("symbol X 0.5"));
+
+    // four spinning shards would take about a second of processor time in a quarter of a second
+    const auto before = std::clock();
+    std::this_thread::sleep_for(std::chrono::milliseconds(250));
+    const auto used = static_cast<double>(std::clock() - before) / CLOCKS_PER_SEC;
+    ASSERT_GT(0.1, used);
+
+    // and they wake up for the next command
+    ASSERT_EQ(ParseResult::Ok, engine.handle("X order 1 buy 10 1.5"));
+    ASSERT_EQ(ParseResult::Ok, engine.handle("X q level bid 0"));
+    engine.drain();
+    ASSERT_EQ("X bid, 0, 1.5, 10\n", text.str());
+}
+
+TEST(SharedOutputTest, lines_from_threads_stay_whole)
+{
+    std::ostringstream target;
+    {
+        SharedOutput shared(target);
+        std::vector<std::thread> writers;
+        for (int t = 0; t < 4; ++t)
+        {
+            writers.emplace_back([&shared, t]
+            {
+                std::ostream out(&shared);
+                for (int i = 0; i < 1000; ++i)
+                {
+                    LOG_LINE(out, "thread " << t << " line " << i << " of " << 1000);
+                }
+            });
+        }
+        for (auto& writer: writers)
+        {
+            writer.join();
+        }
+    }
+
+    std::vector<int> next(4, 0);
+    std::istringstream in(target.str());
+    for (std::string line; std::getline(in, line);)
+    {
+        std::istringstream words(line);
+        std::string thread, lineWord, of;
+        int t = -1;
+        int i = -1;
+        int total = -1;
+        words >> thread >> t >> lineWord >> i >> of >> total;
+        ASSERT_TRUE(words.eof() && thread == "thread" && lineWord == "line" && of == "of" && total == 1000) << line;
+        ASSERT_EQ(next[t]++, i) << line;
+    }
+    ASSERT_EQ(std::vector<int>(4, 1000), next);
+}
@@ -0,0 +1,183 @@
+#include <csignal>
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <gtest/gtest.h>
+#include <sys/resource.h>
+
+#include "Common.hxx"
+#include "OrderBook.hxx"
+#include "CommandProcessor.hxx"
+#include "Journal.hxx"
+#include "BinaryProtocol.hxx"
+#include "BookState.hxx"
+#include "Session.hxx"
+
+using namespace trading;
+
+namespace
+{
+    std::string journalPath(const char* name)
+    {
+        const auto path = ::testing::TempDir() + name;
+        std::remove(path.c_str());
+        return path;
+    }
+}
+
+TEST(JournalTest, replays_into_an_empty_book)
+{
+    const auto path = journalPath("replays_into_an_empty_book.journal");
+    JournalConfig config;
+    // small, so that it has to grow
+    config.preallocate = 64;
+
+    OrderBook book(0.05);
+    std::ostringstream text;
+    OutputSink out(text);
+    CommandProcessor processor(book, out);
+    std::size_t size = 0;
+    {
+        Journal journal(path, book.getScale(), config);
+        processor.setJournal(&journal);
+        for (const auto& line: SESSION)
+        {
+            try
+            {
+                processor.handle(line);
+            }
+            catch (const TradingError&)
+            {}
+        }
+        journal.commit();
+        size = journal.size();
+        ASSERT_GT(size, config.preallocate);
+    }
+
+    Journal journal(path, 0.05, config);
+    ASSERT_EQ(size, journal.size());
+    LadderOrderBook recovered(0.05);
+    // the eleven orders the book took, one amend and one cancel
+    ASSERT_EQ(13, journal.replay(recovered));
+    ASSERT_EQ(describeBook(book, 1001, 1011), describeBook(recovered, 1001, 1011));
+
+    // appends after what is there
+    journal.cancel(1004);
+    ASSERT_EQ(size + sizeof(binary::CancelMessage), journal.size());
+}
+
+TEST(JournalTest, replays_owners_and_mass_cancels)
+{
+    const auto path = journalPath("replays_owners_and_mass_cancels.journal");
+    OrderBook book(0.05);
+    std::ostringstream text;
+    OutputSink out(text);
+    CommandProcessor processor(book, out);
+    {
+        Journal journal(path, book.getScale());
+        processor.setJournal(&journal);
+        for (const auto& line: { "order 1 buy 100 10.00 7", "order 2 buy 100 9.95", "order 3 buy 100 9.90 7",
+            "order 4 sell 100 10.10 8", "order 5 sell 100 10.20", "order 6 sell 100 10.25 8", "cancel owner 7",
+            "cancel beyond sell 10.20", "order 7 buy 50 10.10", "cancel ids 2 2" })
+        {
+            ASSERT_EQ(ParseResult::Ok, processor.handle(line)) << line;
+        }
+        journal.commit();
+    }
+
+    Journal journal(path, 0.05);
+    OrderBook recovered(0.05);
+    ASSERT_EQ(10u, journal.replay(recovered));
+    ASSERT_EQ(describeBook(book, 1, 7), describeBook(recovered, 1, 7));
+    // the owner came back with the order, 4 is the one of owner 8 still resting
+    ASSERT_EQ(1, recovered.cancelAll(MassCancel { CancelScope::Owner, Side::Buy, 8, 0 }));
+
+    // the one fill, 7 taking half of 4
+    FillBuffer fills(4);
+    ASSERT_EQ(1u, journal.fills(&FillBuffer::collect, &fills));
+    ASSERT_EQ(202, fills[0].filledPrice);
+    ASSERT_EQ(50, fills[0].filledQty);
+    ASSERT_EQ(4, fills[0].makerId);
+    ASSERT_EQ(7, fills[0].takerId);
+    ASSERT_EQ(50, fills[0].makerLeaves);
+}
+
+TEST(JournalTest, failing_to_grow_leaves_the_book_whole)
+{
+    const auto path = journalPath("failing_to_grow_leaves_the_book_whole.journal");
+    JournalConfig config;
+    // every record has to grow the file
+    config.preallocate = 1;
+
+    OrderBook book(0.05);
+    OrderBook expected(0.05);
+    std::ostringstream text;
+    OutputSink out(text);
+    CommandProcessor processor(book, out);
+    CommandProcessor reference(expected, out);
+    Journal journal(path, book.getScale(), config);
+    processor.setJournal(&journal);
+    for (const auto& line: { "order 1 sell 10 10.00", "order 2 sell 10 10.00", "order 3 sell 10 10.05" })
+    {
+        processor.handle(line);
+        reference.handle(line);
+    }
+    const auto size = journal.size();
+
+    // the file can't grow past what it has, so journaling the order taking 1 and half of 2 fails
+    rlimit limit;
+    ASSERT_EQ(0, ::getrlimit(RLIMIT_FSIZE, &limit));
+    const auto saved = limit;
+    const auto handler = std::signal(SIGXFSZ, SIG_IGN);
+    std::ifstream file(path, std::ios::binary | std::ios::ate);
+    limit.rlim_cur = static_cast<rlim_t>(file.tellg());
+    ASSERT_EQ(0, ::setrlimit(RLIMIT_FSIZE, &limit));
+    EXPECT_THROW(processor.handle("order 4 buy 15 10.00"), TradingError);
+    ::setrlimit(RLIMIT_FSIZE, &saved);
+    std::signal(SIGXFSZ, handler);
+    reference.handle("order 4 buy 15 10.00");
+
+    // the match was done whole: 1 and 4 filled and gone, 2 at the front with 5 left
+    ASSERT_EQ(describeBook(expected, 1, 4), describeBook(book, 1, 4));
+    ASSERT_EQ(Reject::None, book.tryCancel(2));
+    ASSERT_EQ(Reject::AlreadyFilled, book.tryCancel(4));
+    int price = 0;
+    int quantity = 0;
+    ASSERT_EQ(Reject::None, book.tryLevel(Side::Sell, 0, price, quantity));
+    ASSERT_EQ(201, price);
+    ASSERT_EQ(10, quantity);
+
+    // nothing of the order was written, and the journal takes the next one
+    ASSERT_EQ(size, journal.size());
+    ASSERT_EQ(ParseResult::Ok, processor.handle("order 5 buy 10 10.05"));
+    ASSERT_GT(journal.size(), size);
+}
+
+TEST(JournalTest, ends_at_a_torn_record)
+{
+    const auto path = journalPath("ends_at_a_torn_record.journal");
+    std::size_t size = 0;
+    {
+        Journal journal(path, 0.05);
+        journal.order(LimitOrder { 1, Side::Buy, 200, 10, 0 });
+        journal.fill(Fill { 200, 5 });
+        size = journal.size();
+    }
+    {
+        // a record whose type never made it
+        std::fstream file(path, std::ios::in | std::ios::out | std::ios::binary);
+        file.seekp(24 + size + 1);
+        file.write("\x07\x00\x00\x00", 4);
+    }
+
+    Journal journal(path, 0.05);
+    ASSERT_EQ(size, journal.size());
+    OrderBook book(0.05);
+    ASSERT_EQ(1, journal.replay(book));
+    ASSERT_EQ(10, book.sizeAt(Side::Buy, 0));
+
+    OrderBook other(0.01);
+    ASSERT_THROW(journal.replay(other), TradingError);
+    ASSERT_THROW(Journal(path, 0.01), TradingError);
+}
@@ -0,0 +1,195 @@
+#include <random>
+#include <vector>
+#include <gtest/gtest.h>
+
+#include "Common.hxx"
+#include "OrderBook.hxx"
+#include "MarketData.hxx"
+
+using namespace trading;
+
+namespace
+{
+    void collect(void* events, const BookEvent& event)
+    {
+        static_cast<std::vector<BookEvent>*>(events)->push_back(event);
+    }
+
+    void expectEvent(const BookEvent& event, const BookEventType type, const int id, const int price, const int quantity)
+    {
+        EXPECT_EQ(type, event.type);
+        EXPECT_EQ(id, event.id);
+        EXPECT_EQ(price, event.price);
+        EXPECT_EQ(quantity, event.quantity);
+    }
+
+    void expectSame(const DepthSnapshot& expected, const DepthSnapshot& actual)
+    {
+        ASSERT_EQ(expected.bids.size(), actual.bids.size());
+        ASSERT_EQ(expected.asks.size(), actual.asks.size());
+        for (std::size_t i = 0; i < expected.bids.size(); ++i)
+        {
+            ASSERT_EQ(expected.bids[i].price, actual.bids[i].price);
+            ASSERT_EQ(expected.bids[i].quantity, actual.bids[i].quantity);
+            ASSERT_EQ(expected.bids[i].orders, actual.bids[i].orders);
+        }
+        for (std::size_t i = 0; i < expected.asks.size(); ++i)
+        {
+            ASSERT_EQ(expected.asks[i].price, actual.asks[i].price);
+            ASSERT_EQ(expected.asks[i].quantity, actual.asks[i].quantity);
+            ASSERT_EQ(expected.asks[i].orders, actual.asks[i].orders);
+        }
+    }
+}
+
+template <typename Book>
+class MarketDataTest: public ::testing::Test
+{};
+
+using BookTypes = ::testing::Types<OrderBook, LadderOrderBook, PlainOrderBook, PlainLadderOrderBook,
+    SequentialIdOrderBook>;
+TYPED_TEST_SUITE(MarketDataTest, BookTypes);
+
+TYPED_TEST(MarketDataTest, events_of_every_change)
+{
+    TypeParam book(0.05);
+    std::vector<BookEvent> events;
+    book.setListener(&collect, &events);
+
+    book.add(LimitOrder { 1, Side::Buy, 100, 10, 0 });
+    book.add(LimitOrder { 2, Side::Buy, 100, 5, 0 });
+    // takes all of 1 and 2 of 2
+    book.add(LimitOrder { 3, Side::Sell, 100, 12, 0 });
+    book.amend(2, 3);
+    book.amend(2, 8);
+    book.cancel(2);
+
+    ASSERT_EQ(17, events.size());
+    for (std::size_t i = 0; i < events.size(); ++i)
+    {
+        ASSERT_EQ(i + 1, events[i].sequence);
+    }
+    expectEvent(events[0], BookEventType::OrderAdded, 1, 100, 10);
+    expectEvent(events[1], BookEventType::LevelChanged, 0, 100, 10);
+    expectEvent(events[3], BookEventType::LevelChanged, 0, 100, 15);
+    ASSERT_EQ(2, events[3].orders);
+
+    expectEvent(events[4], BookEventType::Trade, 1, 100, 10);
+    ASSERT_EQ(3, events[4].otherId);
+    expectEvent(events[5], BookEventType::OrderRemoved, 1, 100, 0);
+    expectEvent(events[6], BookEventType::LevelChanged, 0, 100, 5);
+    expectEvent(events[7], BookEventType::Trade, 2, 100, 2);
+    expectEvent(events[8], BookEventType::OrderReduced, 2, 100, 3);
+    expectEvent(events[9], BookEventType::LevelChanged, 0, 100, 3);
+
+    // amend down, then up to the back of the level
+    expectEvent(events[10], BookEventType::OrderReduced, 2, 100, 1);
+    expectEvent(events[11], BookEventType::LevelChanged, 0, 100, 1);
+    expectEvent(events[12], BookEventType::OrderRemoved, 2, 100, 1);
+    expectEvent(events[13], BookEventType::OrderAdded, 2, 100, 6);
+    expectEvent(events[14], BookEventType::LevelChanged, 0, 100, 6);
+
+    expectEvent(events[15], BookEventType::OrderRemoved, 2, 100, 6);
+    expectEvent(events[16], BookEventType::LevelChanged, 0, 100, 0);
+    ASSERT_EQ(0, events[16].orders);
+}
+
+TYPED_TEST(MarketDataTest, mass_cancels_remove_what_was_left)
+{
+    TypeParam book(0.05);
+    std::vector<BookEvent> events;
+    book.setListener(&collect, &events);
+
+    book.add(LimitOrder { 1, Side::Buy, 100, 10, 0 });
+    book.add(LimitOrder { 2, Side::Buy, 99, 5, 0 });
+    book.add(LimitOrder { 3, Side::Buy, 101, 7, 0, false, 9 });
+    // fills 3 and rests 3, then leaves 7 of 1
+    book.add(LimitOrder { 4, Side::Sell, 101, 10, 0 });
+    book.add(LimitOrder { 5, Side::Sell, 99, 3, 0 });
+    events.clear();
+
+    int cancelled = 0;
+    ASSERT_EQ(Reject::None, book.tryCancelAll(MassCancel { CancelScope::Beyond, Side::Buy, 100, 0 }, cancelled));
+    ASSERT_EQ(2, cancelled);
+    ASSERT_EQ(Reject::None, book.tryCancelAll(MassCancel { CancelScope::Owner, Side::Buy, 9, 0 }, cancelled));
+    ASSERT_EQ(0, cancelled);
+    ASSERT_EQ(Reject::None, book.tryCancelAll(MassCancel { CancelScope::Ids, Side::Buy, 4, 4 }, cancelled));
+    ASSERT_EQ(1, cancelled);
+
+    ASSERT_EQ(6, events.size());
+    expectEvent(events[0], BookEventType::OrderRemoved, 2, 99, 5);
+    expectEvent(events[1], BookEventType::LevelChanged, 0, 99, 0);
+    expectEvent(events[2], BookEventType::OrderRemoved, 1, 100, 7);
+    expectEvent(events[3], BookEventType::LevelChanged, 0, 100, 0);
+    expectEvent(events[4], BookEventType::OrderRemoved, 4, 101, 3);
+    expectEvent(events[5], BookEventType::LevelChanged, 0, 101, 0);
+}
+
+TYPED_TEST(MarketDataTest, l2_book_follows_the_book)
+{
+    TypeParam book(0.05);
+    L2Book l2;
+    book.setListener(&L2Book::onEvent, &l2);
+
+    std::mt19937 random(7);
+    std::vector<int> ids;
+    DepthSnapshot expected;
+    DepthSnapshot actual;
+    for (int id = 1; id <= 5000; ++id)
+    {
+        const auto pick = random() % 10;
+        try
+        {
+            if (pick < 2 && !ids.empty())
+            {
+                book.cancel(ids[random() % ids.size()]);
+            }
+            else if (pick < 3 && !ids.empty())
+            {
+                book.amend(ids[random() % ids.size()], 1 + random() % 20);
+            }
+            else
+            {
+                const auto side = random() % 2 ? Side::Buy : Side::Sell;
+                book.add(LimitOrder { id, side, 90 + static_cast<int>(random() % 20), 1 + static_cast<int>(random() % 20), 0 });
+                ids.push_back(id);
+            }
+        }
+        catch (const TradingError&)
+        {} // cancels and amends of orders which are gone
+
+        book.depth(5, expected);
+        l2.top(5, actual);
+        expectSame(expected, actual);
+    }
+    book.depth(1000, expected);
+    l2.top(1000, actual);
+    expectSame(expected, actual);
+    ASSERT_EQ(0, l2.gaps());
+}
+
+TEST(MarketDataTest, ring_delivery_and_gaps)
+{
+    OrderBook book(0.05);
+    EventRing ring(16);
+    book.setListener(&pushToRing, &ring);
+    book.add(LimitOrder { 1, Side::Sell, 100, 10, 0 });
+    book.add(LimitOrder { 2, Side::Buy, 100, 4, 0 });
+
+    L2Book l2;
+    BookEvent event;
+    int count = 0;
+    while (ring.pop(event))
+    {
+        // one of them lost
+        if (++count != 3)
+        {
+            l2.apply(event);
+        }
+    }
+    ASSERT_EQ(5, count);
+    ASSERT_EQ(5, l2.lastSequence());
+    ASSERT_EQ(1, l2.gaps());
+    ASSERT_EQ(1, l2.depth(Side::Sell));
+    ASSERT_EQ(0, l2.depth(Side::Buy));
+}
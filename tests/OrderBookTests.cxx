@@ -1,9 +1,20 @@
 #include <atomic>
+#include <climits>
+#include <chrono>
+#include <map>
+#include <random>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <vector>
 #include <gtest/gtest.h>
 
 #include "Common.hxx"
 #include "OrderBook.hxx"
 #include "CommandProcessor.hxx"
+#include "MarketData.hxx"
+#include "BookState.hxx"
 
 using namespace trading;
 
@@ -11,42 +22,61 @@ namespace
 {
     static std::atomic<int> g_id(0);
 
-    auto makeOrder(const Side side, const double price, const int quantity)
+    // prices are in ticks
+    auto makeOrder(const Side side, const int price, const int quantity)
     {
-        return std::make_shared<LimitOrder>(LimitOrder{++g_id, side, price, quantity, 0 });
+        return LimitOrder{++g_id, side, price, quantity, 0 };
     }
 
-    auto buy(const double price, const int quantity = 10)
+    auto buy(const int price, const int quantity = 10)
     {
         return makeOrder(Side::Buy, price, quantity);
     }
 
-    auto sell(const double price, const int quantity = 10)
+    auto sell(const int price, const int quantity = 10)
     {
         return makeOrder(Side::Sell, price, quantity);
     }
+
+    // enough bids far below the prices of a test for apply() to look ahead, with ids of their own
+    template <typename Book>
+    void fillForLookAhead(Book& book)
+    {
+        for (std::size_t i = 0; i < BATCH_LOOK_AHEAD_ORDERS; ++i)
+        {
+            book.add(LimitOrder { 1000000 + static_cast<int>(i), Side::Buy, 1, 1, 0 });
+        }
+    }
 }
 
+template <typename Book>
+class OrderBookTest: public ::testing::Test
+{};
 
-TEST(OrderBookTest, create_order_book)
+using BookTypes = ::testing::Types<OrderBook, LadderOrderBook, PlainOrderBook, PlainLadderOrderBook,
+    SequentialIdOrderBook>;
+TYPED_TEST_SUITE(OrderBookTest, BookTypes);
+
+
+TYPED_TEST(OrderBookTest, create_order_book)
 {
-    ASSERT_NO_THROW(OrderBook(0.1));
-    ASSERT_NO_THROW(OrderBook(0.5));
-    ASSERT_NO_THROW(OrderBook(0.01));
-    ASSERT_NO_THROW(OrderBook(1));
-    ASSERT_NO_THROW(OrderBook(6));
+    ASSERT_NO_THROW(TypeParam(0.1));
+    ASSERT_NO_THROW(TypeParam(0.5));
+    ASSERT_NO_THROW(TypeParam(0.01));
+    ASSERT_NO_THROW(TypeParam(1));
+    ASSERT_NO_THROW(TypeParam(6));
 
-    ASSERT_THROW(OrderBook(0), TradingError);
-    ASSERT_THROW(OrderBook(-1), TradingError);
-    ASSERT_THROW(OrderBook(-10), TradingError);
+    ASSERT_THROW(TypeParam(0), TradingError);
+    ASSERT_THROW(TypeParam(-1), TradingError);
+    ASSERT_THROW(TypeParam(-10), TradingError);
 }
 
-TEST(OrderBookTest, insert_into_order_book)
+TYPED_TEST(OrderBookTest, insert_into_order_book)
 {
-    OrderBook book(0.1);
+    TypeParam book(0.1);
 
-    auto order1 = buy(2.0);
-    auto order2 = sell(2.0);
+    auto order1 = buy(20);
+    auto order2 = sell(20);
     book.add(order1);
     const auto&& fills = book.add(order2);
 	ASSERT_EQ(1, fills.size());
@@ -55,23 +85,23 @@ TEST(OrderBookTest, insert_into_order_book)
 
     ASSERT_THROW(book.add(order1), TradingError);
     ASSERT_THROW(book.add(order2), TradingError);
-    ASSERT_THROW(book.add(buy(0.0)), TradingError);
-    ASSERT_THROW(book.add(buy(1.0, -1)), TradingError);
+    ASSERT_THROW(book.add(buy(0)), TradingError);
+    ASSERT_THROW(book.add(buy(10, -1)), TradingError);
 
-	auto result = book.query(order1->id);
+	auto result = book.query(order1.id);
 	ASSERT_EQ("filled", result.order->status());
-	ASSERT_EQ("filled", book.query(order2->id).order->status());
+	ASSERT_EQ("filled", book.query(order2.id).order->status());
 
-    order1->side = order2->side;
+    order1.side = order2.side;
     ASSERT_THROW(book.add(order1), TradingError);
     ASSERT_THROW(book.add(order2), TradingError);
 }
 
-TEST(OrderBookTest, fills_in_order_book)
+TYPED_TEST(OrderBookTest, fills_in_order_book)
 {
-    OrderBook book(0.1);
-	auto o3 = buy(10.0, 100);
-	auto o4 = sell(10, 250);
+    TypeParam book(0.1);
+	auto o3 = buy(100, 100);
+	auto o4 = sell(100, 250);
 	ASSERT_EQ(0, book.add(o3).size());
 	ASSERT_EQ(100, book.sizeAt(Side::Buy, 0));
 	ASSERT_THROW(book.sizeAt(Side::Sell, 0), TradingError);
@@ -81,17 +111,17 @@ TEST(OrderBookTest, fills_in_order_book)
 	ASSERT_EQ(150, book.sizeAt(Side::Sell, 0));
 	ASSERT_THROW(book.sizeAt(Side::Buy, 0), TradingError);
 
-	auto result = book.query(o4->id);
+	auto result = book.query(o4.id);
 	ASSERT_EQ("partial", result.order->status());
 	ASSERT_EQ(100, result.order->filledQty);
 	ASSERT_EQ(150, result.order->leaves());
 }
 
-TEST(OrderBookTest, fills_in_order_book1)
+TYPED_TEST(OrderBookTest, fills_in_order_book1)
 {
-    OrderBook book(0.1);
-	auto o3 = buy(10.0, 100);
-	auto o4 = sell(10, 250);
+    TypeParam book(0.1);
+	auto o3 = buy(100, 100);
+	auto o4 = sell(100, 250);
 	ASSERT_EQ(0, book.add(o4).size());
 	auto&& fills = book.add(o3);
 	ASSERT_EQ(1, fills.size());
@@ -99,110 +129,208 @@ TEST(OrderBookTest, fills_in_order_book1)
 	ASSERT_EQ(150, book.sizeAt(Side::Sell, 0));
 	ASSERT_THROW(book.sizeAt(Side::Buy, 0), TradingError);
 
-	auto result = book.query(o4->id);
+	auto result = book.query(o4.id);
 	ASSERT_EQ("partial", result.order->status());
 	ASSERT_EQ(100, result.order->filledQty);
 	ASSERT_EQ(150, result.order->leaves());
 
-	auto result1 = book.query(o3->id);
+	auto result1 = book.query(o3.id);
 	ASSERT_EQ("filled", result1.order->status());
 }
 
-TEST(OrderBookTest, tick_size_into_order_book)
+TYPED_TEST(OrderBookTest, best_price_first_matching)
+{
+    TypeParam book(0.5);
+    auto bid1 = buy(20, 10);
+    auto bid2 = buy(24, 10);
+    auto bid3 = buy(22, 10);
+    auto bid4 = buy(24, 10);
+    book.add(bid1);
+    book.add(bid2);
+    book.add(bid3);
+    book.add(bid4);
+
+    // stops at the first level which doesn't cross
+    auto&& fills = book.add(sell(23, 30));
+    ASSERT_EQ(2, fills.size());
+    ASSERT_EQ(24, fills.front().filledPrice);
+    ASSERT_EQ(24, fills.back().filledPrice);
+    ASSERT_EQ("filled", book.query(bid2.id).order->status());
+    ASSERT_EQ("filled", book.query(bid4.id).order->status());
+    ASSERT_EQ(23, book.priceAt(Side::Sell, 0));
+    ASSERT_EQ(10, book.sizeAt(Side::Sell, 0));
+
+    // stops as soon as the order is filled
+    auto&& fills1 = book.add(sell(20, 15));
+    ASSERT_EQ(2, fills1.size());
+    ASSERT_EQ(22, fills1.front().filledPrice);
+    ASSERT_EQ(20, fills1.back().filledPrice);
+    ASSERT_EQ(5, fills1.back().filledQty);
+    ASSERT_EQ("partial", book.query(bid1.id).order->status());
+
+    // a buy sweeps the asks from the lowest price up
+    book.add(sell(26, 10));
+    auto&& fills2 = book.add(buy(26, 20));
+    ASSERT_EQ(2, fills2.size());
+    ASSERT_EQ(23, fills2.front().filledPrice);
+    ASSERT_EQ(26, fills2.back().filledPrice);
+}
+
+TYPED_TEST(OrderBookTest, tick_size_into_order_book)
 {
-    OrderBook book(0.2);
-    book.add(buy(1.0));
-    book.add(buy(1.2));
-    book.add(buy(1.4));
-    book.add(sell(1.4));
-    ASSERT_THROW(book.add(buy(1.1)), TradingError);
-    ASSERT_THROW(book.add(sell(1.1)), TradingError);
-    ASSERT_THROW(book.add(sell(3.5)), TradingError);
-    ASSERT_THROW(book.add(sell(-1)), TradingError);
+    TypeParam book(0.2);
+    const auto& scale = book.getScale();
+    book.add(buy(scale.toTicks(1.0)));
+    book.add(buy(scale.toTicks(1.2)));
+    book.add(buy(scale.toTicks(1.4)));
+    auto&& fills = book.add(sell(scale.toTicks(1.4)));
+    ASSERT_EQ(1, fills.size());
+    ASSERT_EQ(7, fills.front().filledPrice);
+    ASSERT_EQ(1.2, scale.toPrice(book.priceAt(Side::Buy, 0)));
+    ASSERT_THROW(scale.toTicks(1.1), TradingError);
+    ASSERT_THROW(scale.toTicks(3.5), TradingError);
+    ASSERT_THROW(book.add(sell(scale.toTicks(-1))), TradingError);
     ASSERT_THROW(book.add(sell(0)), TradingError);
 }
 
-TEST(OrderBookTest, cancel_from_order_book)
+TEST(PriceScaleTest, ticks_and_decimals)
 {
-    OrderBook book(0.5);
+    const PriceScale scale(0.05);
+    ASSERT_EQ(2, scale.decimals());
+    ASSERT_EQ(246, scale.toTicks(12.3));
+    ASSERT_EQ(243, scale.toTicks(12.15));
+    ASSERT_EQ(12.15, scale.toPrice(243));
+    ASSERT_EQ(1215, scale.toFixed(243));
+    // parsed prices which are not exact doubles still land on their tick
+    ASSERT_EQ(6, scale.toTicks(0.1 + 0.2));
+    ASSERT_EQ(0.3, scale.toPrice(6));
 
-    auto order1 = buy(2.0);
-    auto order2 = sell(2.5);
+    int ticks = 0;
+    ASSERT_FALSE(scale.toTicks(12.31, ticks));
+    ASSERT_FALSE(scale.toTicks(1e300, ticks));
+    ASSERT_TRUE(scale.toTicks(-0.05, ticks));
+    ASSERT_EQ(-1, ticks);
+
+    ASSERT_EQ(0, PriceScale(6).decimals());
+    ASSERT_EQ(1, PriceScale(0.5).decimals());
+    ASSERT_EQ(4, PriceScale(0.0001).decimals());
+    ASSERT_THROW(PriceScale(1e-12), TradingError);
+    ASSERT_THROW(PriceScale(0), TradingError);
+}
+
+TYPED_TEST(OrderBookTest, cancel_from_order_book)
+{
+    TypeParam book(0.5);
+
+    auto order1 = buy(4);
+    auto order2 = sell(5);
     book.add(order1);
     book.add(order2);
 
-    book.cancel(order1->id);
-    book.cancel(order2->id);
-    ASSERT_THROW(book.cancel(order1->id), TradingError);
-    ASSERT_THROW(book.cancel(order2->id), TradingError);
+    book.cancel(order1.id);
+    book.cancel(order2.id);
+    ASSERT_THROW(book.cancel(order1.id), TradingError);
+    ASSERT_THROW(book.cancel(order2.id), TradingError);
     ASSERT_THROW(book.add(order1), TradingError);
     ASSERT_THROW(book.add(order2), TradingError);
 }
 
-TEST(OrderBookTest, modify_in_order_book_and_query)
+TYPED_TEST(OrderBookTest, modify_in_order_book_and_query)
 {
-    OrderBook book(0.5);
+    TypeParam book(0.5);
 
-    auto order1 = buy(2.0, 20);
-    auto order2 = sell(2.5, 30);
+    auto order1 = buy(4, 20);
+    auto order2 = sell(5, 30);
     book.add(order1);
-	book.add(buy(order1->price));
-	book.add(buy(order1->price));
-	book.add(buy(order1->price));
-	book.add(buy(order1->price));
+	book.add(buy(order1.price));
+	book.add(buy(order1.price));
+	book.add(buy(order1.price));
+	book.add(buy(order1.price));
     book.add(order2);
 
-    book.amend(order1->id, 50);
-    ASSERT_THROW(book.amend(order1->id, 0), TradingError);
-    ASSERT_THROW(book.amend(order1->id, -10), TradingError);
-    book.amend(order2->id, 60);
+    book.amend(order1.id, 50);
+    ASSERT_THROW(book.amend(order1.id, 0), TradingError);
+    ASSERT_THROW(book.amend(order1.id, -10), TradingError);
+    book.amend(order2.id, 60);
 
-	const auto result1 = book.query(order1->id);
-	const auto result2 = book.query(order2->id);
+	const auto result1 = book.query(order1.id);
+	const auto result2 = book.query(order2.id);
     ASSERT_EQ(result1.order->quantity, 50);
     ASSERT_EQ(result1.position, 4);
     ASSERT_EQ(result2.order->quantity, 60);
     ASSERT_EQ(result2.position, 0);
 }
 
-TEST(OrderBookTest, data_at_level_of_order_book)
+TYPED_TEST(OrderBookTest, cancel_and_amend_inside_level)
+{
+    TypeParam book(0.5);
+
+    auto order1 = buy(4, 10);
+    auto order2 = buy(4, 20);
+    auto order3 = buy(4, 30);
+    auto order4 = buy(4, 40);
+    book.add(order1);
+    book.add(order2);
+    book.add(order3);
+    book.add(order4);
+
+    book.cancel(order2.id);
+    ASSERT_EQ(80, book.sizeAt(Side::Buy, 0));
+    ASSERT_EQ(1, book.query(order3.id).position);
+
+    // amending down keeps the place, amending up goes to the back
+    book.amend(order3.id, 25);
+    ASSERT_EQ(1, book.query(order3.id).position);
+    book.amend(order1.id, 15);
+    ASSERT_EQ(2, book.query(order1.id).position);
+    ASSERT_EQ(0, book.query(order3.id).position);
+    ASSERT_EQ(80, book.sizeAt(Side::Buy, 0));
+
+    // the amended order still trades
+    const auto&& fills = book.add(sell(4, 80));
+    ASSERT_EQ(3, fills.size());
+    ASSERT_EQ("filled", book.query(order1.id).order->status());
+    ASSERT_THROW(book.sizeAt(Side::Buy, 0), TradingError);
+}
+
+TYPED_TEST(OrderBookTest, data_at_level_of_order_book)
 {
-    OrderBook book(0.5);
+    TypeParam book(0.5);
     ASSERT_THROW(book.priceAt(Side::Buy, 0), TradingError);
 
-    book.add(buy(20.0, 5));
-    book.add(buy(20.0, 15));
-    book.add(buy(20.0, 1));
-    book.add(buy(19.0, 5));
-    book.add(buy(19.0, 5));
-    book.add(buy(18.0, 5));
-    book.add(buy(17.0, 5));
-    book.add(buy(17.0, 5));
-    book.add(buy(16.0, 5));
-    book.add(buy(15.0, 5));
+    book.add(buy(40, 5));
+    book.add(buy(40, 15));
+    book.add(buy(40, 1));
+    book.add(buy(38, 5));
+    book.add(buy(38, 5));
+    book.add(buy(36, 5));
+    book.add(buy(34, 5));
+    book.add(buy(34, 5));
+    book.add(buy(32, 5));
+    book.add(buy(30, 5));
 
     ASSERT_THROW(book.priceAt(Side::Sell, 0), TradingError);
 
-    book.add(sell(21.0, 5));
-    book.add(sell(21.0, 15));
-    book.add(sell(21.0, 1));
-    book.add(sell(22.0, 5));
-    book.add(sell(22.0, 5));
-    book.add(sell(23.0, 5));
-    book.add(sell(23.0, 5));
-    book.add(sell(23.0, 5));
-    book.add(sell(24.0, 5));
-    book.add(sell(24.0, 5));
-
-    ASSERT_EQ(book.priceAt(Side::Buy, 0), 20.0);
-    ASSERT_EQ(book.priceAt(Side::Buy, 1), 19.0);
-    ASSERT_EQ(book.priceAt(Side::Buy, 2), 18.0);
+    book.add(sell(42, 5));
+    book.add(sell(42, 15));
+    book.add(sell(42, 1));
+    book.add(sell(44, 5));
+    book.add(sell(44, 5));
+    book.add(sell(46, 5));
+    book.add(sell(46, 5));
+    book.add(sell(46, 5));
+    book.add(sell(48, 5));
+    book.add(sell(48, 5));
+
+    ASSERT_EQ(book.priceAt(Side::Buy, 0), 40);
+    ASSERT_EQ(book.priceAt(Side::Buy, 1), 38);
+    ASSERT_EQ(book.priceAt(Side::Buy, 2), 36);
     ASSERT_EQ(book.sizeAt(Side::Buy, 0), 21);
     ASSERT_EQ(book.sizeAt(Side::Buy, 1), 10);
 
-    ASSERT_EQ(book.priceAt(Side::Sell, 0), 21.0);
-    ASSERT_EQ(book.priceAt(Side::Sell, 1), 22.0);
-    ASSERT_EQ(book.priceAt(Side::Sell, 2), 23.0);
+    ASSERT_EQ(book.priceAt(Side::Sell, 0), 42);
+    ASSERT_EQ(book.priceAt(Side::Sell, 1), 44);
+    ASSERT_EQ(book.priceAt(Side::Sell, 2), 46);
     ASSERT_EQ(book.sizeAt(Side::Sell, 0), 21);
     ASSERT_EQ(book.sizeAt(Side::Sell, 2), 15);
 
@@ -210,15 +338,849 @@ TEST(OrderBookTest, data_at_level_of_order_book)
     ASSERT_THROW(book.priceAt(Side::Sell, 10), TradingError);
     ASSERT_THROW(book.sizeAt(Side::Buy, 10), TradingError);
 }
+TYPED_TEST(OrderBookTest, level_totals_and_depth)
+{
+    TypeParam book(0.5);
+
+    auto bid1 = buy(40, 5);
+    auto bid2 = buy(40, 15);
+    book.add(bid1);
+    book.add(bid2);
+    book.add(buy(38, 7));
+    book.add(buy(36, 3));
+    book.add(sell(42, 4));
+    book.add(sell(44, 6));
+
+    DepthSnapshot snapshot;
+    book.depth(2, snapshot);
+    ASSERT_EQ(2, snapshot.bids.size());
+    ASSERT_EQ(40, snapshot.bids[0].price);
+    ASSERT_EQ(20, snapshot.bids[0].quantity);
+    ASSERT_EQ(2, snapshot.bids[0].orders);
+    ASSERT_EQ(38, snapshot.bids[1].price);
+    ASSERT_EQ(2, snapshot.asks.size());
+    ASSERT_EQ(42, snapshot.asks[0].price);
+    ASSERT_EQ(44, snapshot.asks[1].price);
+    ASSERT_EQ(6, snapshot.asks[1].quantity);
+
+    // partial fill, amend up and down, cancel
+    book.add(sell(40, 3));
+    ASSERT_EQ(17, book.sizeAt(Side::Buy, 0));
+    book.amend(bid2.id, 25);
+    ASSERT_EQ(27, book.sizeAt(Side::Buy, 0));
+    book.amend(bid2.id, 10);
+    ASSERT_EQ(12, book.sizeAt(Side::Buy, 0));
+    book.cancel(bid1.id);
+    ASSERT_EQ(10, book.sizeAt(Side::Buy, 0));
+
+    book.depth(10, snapshot);
+    ASSERT_EQ(3, snapshot.bids.size());
+    ASSERT_EQ(1, snapshot.bids[0].orders);
+    ASSERT_EQ(36, snapshot.bids[2].price);
+    ASSERT_EQ(2, snapshot.asks.size());
+
+    // more levels than the book has are only as many as it has, fewer than none are rejected
+    const auto before = book.memoryUsage().other;
+    ASSERT_EQ(Reject::None, book.tryDepth(INT_MAX, snapshot));
+    ASSERT_EQ(3, snapshot.bids.size());
+    ASSERT_EQ(2, snapshot.asks.size());
+    ASSERT_EQ(before, book.memoryUsage().other);
+    ASSERT_EQ(Reject::BadLevelCount, book.tryDepth(-1, snapshot));
+    ASSERT_EQ(1u, book.rejections(Reject::BadLevelCount));
+    ASSERT_THROW(book.depth(-1, snapshot), TradingError);
+}
 
+TYPED_TEST(OrderBookTest, terminal_orders_kept_up_to_limit)
+{
+    RetentionConfig retention;
+    retention.maxOrders = 2;
+    TypeParam book(0.5, retention);
+
+    auto first = buy(40);
+    auto second = buy(40);
+    auto taker = sell(40, 15);
+    book.add(first);
+    book.add(second);
+    book.cancel(first.id);
+    ASSERT_EQ("cancelled", book.query(first.id).order->status());
+
+    // fills second, the taker rests with 5
+    book.add(taker);
+    ASSERT_EQ("filled", book.query(second.id).order->status());
+    ASSERT_EQ(10, book.query(second.id).order->filledQty);
+    ASSERT_EQ(-1, book.query(second.id).position);
+
+    book.cancel(taker.id);
+    const auto result = book.query(taker.id);
+    ASSERT_EQ("cancelled", result.order->status());
+    ASSERT_EQ(10, result.order->filledQty);
+    ASSERT_EQ(0, result.order->leaves());
+
+    // first was dropped, its id still can't come back
+    ASSERT_THROW(book.query(first.id), TradingError);
+    ASSERT_THROW(book.add(first), TradingError);
+    ASSERT_THROW(book.add(second), TradingError);
+    ASSERT_THROW(book.cancel(second.id), TradingError);
+}
+
+TYPED_TEST(OrderBookTest, fills_name_maker_and_taker)
+{
+    TypeParam book(0.5);
+    const auto first = sell(40, 10);
+    const auto second = sell(41, 10);
+    book.add(first);
+    book.add(second);
+
+    FillBuffer fills(2);
+    const auto taker = buy(41, 15);
+    book.add(taker, fills);
+    ASSERT_EQ(2u, fills.size());
+    ASSERT_EQ(0u, fills.dropped());
+    ASSERT_EQ(40, fills[0].filledPrice);
+    ASSERT_EQ(10, fills[0].filledQty);
+    ASSERT_EQ(first.id, fills[0].makerId);
+    ASSERT_EQ(taker.id, fills[0].takerId);
+    ASSERT_EQ(0, fills[0].makerLeaves);
+    ASSERT_EQ(41, fills[1].filledPrice);
+    ASSERT_EQ(5, fills[1].filledQty);
+    ASSERT_EQ(second.id, fills[1].makerId);
+    ASSERT_EQ(5, fills[1].makerLeaves);
+
+    // cleared by the next add, and what doesn't fit is counted
+    book.add(sell(30, 1), fills);
+    ASSERT_EQ(0u, fills.size());
+    FillBuffer small(1);
+    book.add(buy(40, 10));
+    book.add(buy(40, 10));
+    book.add(sell(40, 20), small);
+    ASSERT_EQ(1u, small.size());
+    ASSERT_EQ(1u, small.dropped());
+}
+
+TYPED_TEST(OrderBookTest, queue_position_on_deep_levels)
+{
+    TypeParam book(0.5);
+    // what the one level should look like, in time priority
+    std::vector<LimitOrder> queue;
+    std::mt19937 random(3);
+    int id = 0;
+    for (int step = 1; step <= 4000; ++step)
+    {
+        const auto pick = random() % 10;
+        if (pick < 6 || queue.empty())
+        {
+            queue.push_back(LimitOrder { ++id, Side::Buy, 40, 1 + static_cast<int>(random() % 20), 0 });
+            book.add(queue.back());
+        }
+        else if (pick < 7)
+        {
+            const auto i = random() % queue.size();
+            book.cancel(queue[i].id);
+            queue.erase(queue.begin() + i);
+        }
+        else if (pick < 9)
+        {
+            const auto i = random() % queue.size();
+            auto order = queue[i];
+            const auto quantity = order.filledQty + 1 + static_cast<int>(random() % 20);
+            book.amend(order.id, quantity);
+            if (quantity > order.quantity)
+            {
+                queue.erase(queue.begin() + i);
+                order.quantity = quantity;
+                queue.push_back(order);
+            }
+            else
+            {
+                queue[i].quantity = quantity;
+            }
+        }
+        else
+        {
+            auto quantity = 1 + static_cast<int>(random() % 30);
+            book.add(LimitOrder { ++id, Side::Sell, 40, quantity, 0 });
+            while (quantity > 0 && !queue.empty())
+            {
+                const auto fill = std::min(quantity, queue.front().leaves());
+                queue.front().addFill(fill);
+                quantity -= fill;
+                if (queue.front().fullyFilled())
+                {
+                    queue.erase(queue.begin());
+                }
+            }
+            if (quantity > 0)
+            {
+                // rested, take it out again
+                book.cancel(id);
+            }
+        }
+
+        if (step % 100 == 0)
+        {
+            int ahead = 0;
+            for (std::size_t i = 0; i < queue.size(); ++i)
+            {
+                const auto result = book.query(queue[i].id);
+                ASSERT_EQ(static_cast<int>(i), result.position) << step;
+                ASSERT_EQ(ahead, result.quantityAhead) << step;
+                ahead += queue[i].leaves();
+            }
+        }
+    }
+    // deep enough for the rank index
+    ASSERT_GT(queue.size(), static_cast<std::size_t>(RankedPriceLevel::RANK_DEPTH));
+}
+
+TYPED_TEST(OrderBookTest, queue_position_as_a_level_drains_and_fills_again)
+{
+    TypeParam book(0.5);
+    std::vector<int> queue;
+    int id = 0;
+    const auto check = [&]()
+    {
+        for (std::size_t i = 0; i < queue.size(); ++i)
+        {
+            const auto result = book.query(queue[i]);
+            ASSERT_EQ(static_cast<int>(i), result.position);
+            ASSERT_EQ(10 * static_cast<int>(i), result.quantityAhead);
+        }
+    };
+    for (int round = 0; round < 3; ++round)
+    {
+        // past the slots of the rank index the first query builds, so that it has to grow
+        while (queue.size() < 300)
+        {
+            queue.push_back(++id);
+            book.add(LimitOrder { id, Side::Buy, 40, 10, 0 });
+            if (id % 50 == 0)
+            {
+                check();
+            }
+        }
+        check();
+        // from the front, down to where the index is dropped
+        while (queue.size() > 5)
+        {
+            book.cancel(queue.front());
+            queue.erase(queue.begin());
+        }
+        check();
+    }
+}
+
+TYPED_TEST(OrderBookTest, rejects_without_throwing)
+{
+    RetentionConfig retention;
+    retention.maxOrders = 1;
+    TypeParam book(0.5, retention);
+
+    const auto ignore = [](void*, const Fill&) {};
+    auto first = buy(40);
+    auto second = buy(40);
+    ASSERT_EQ(Reject::None, book.tryAdd(first, ignore, nullptr));
+    ASSERT_EQ(Reject::DuplicateId, book.tryAdd(first, ignore, nullptr));
+    ASSERT_EQ(Reject::BadPrice, book.tryAdd(LimitOrder { 100, Side::Buy, 0, 10, 0 }, ignore, nullptr));
+    ASSERT_EQ(Reject::BadQuantity, book.tryAdd(LimitOrder { 100, Side::Buy, 40, 0, 0 }, ignore, nullptr));
+    ASSERT_EQ(Reject::BadSide, book.tryAdd(LimitOrder { 100, static_cast<Side>('X'), 40, 10, 0 }, ignore, nullptr));
+
+    ASSERT_EQ(Reject::None, book.tryAdd(second, ignore, nullptr));
+    // fills 3 of the first
+    ASSERT_EQ(Reject::None, book.tryAdd(sell(40, 3), ignore, nullptr));
+    ASSERT_EQ(Reject::AmendBelowFilled, book.tryAmend(first.id, 3));
+    ASSERT_EQ(Reject::BadQuantity, book.tryAmend(first.id, 0));
+    ASSERT_EQ(Reject::None, book.tryCancel(first.id));
+    ASSERT_EQ(Reject::AlreadyCancelled, book.tryCancel(first.id));
+    ASSERT_EQ(Reject::AlreadyCancelled, book.tryAdd(first, ignore, nullptr));
+    ASSERT_EQ(Reject::UnknownOrder, book.tryAmend(12345, 5));
+
+    // the second one ending pushes the first out
+    ASSERT_EQ(Reject::None, book.tryCancel(second.id));
+    QueryResult result;
+    ASSERT_EQ(Reject::OrderForgotten, book.tryQuery(first.id, result));
+    ASSERT_EQ(Reject::IdReused, book.tryAdd(first, ignore, nullptr));
+    ASSERT_EQ(Reject::None, book.tryQuery(second.id, result));
+    ASSERT_EQ(-1, result.position);
+
+    int price = 0;
+    int quantity = 0;
+    ASSERT_EQ(Reject::NoSuchLevel, book.tryLevel(Side::Buy, 0, price, quantity));
+    ASSERT_EQ(Reject::NoSuchLevel, book.tryLevel(Side::Buy, -1, price, quantity));
+
+    ASSERT_EQ(1u, book.rejections(Reject::DuplicateId));
+    ASSERT_EQ(2u, book.rejections(Reject::AlreadyCancelled));
+    ASSERT_EQ(2u, book.rejections(Reject::NoSuchLevel));
+    ASSERT_EQ(0u, book.rejections(Reject::None));
+
+    // the throwing members are the same underneath
+    ASSERT_THROW(book.cancel(first.id), TradingError);
+    ASSERT_EQ(2u, book.rejections(Reject::OrderForgotten));
+}
+
+TYPED_TEST(OrderBookTest, batch_applies_like_single_calls)
+{
+    // random adds around 40, some crossing, cancels and amends of ids which may or may not rest, and duplicates
+    std::mt19937 random(5);
+    std::vector<BatchCommand> commands;
+    int id = 0;
+    for (int i = 0; i < 3000; ++i)
+    {
+        const auto pick = random() % 10;
+        const auto someId = 1 + static_cast<int>(random() % static_cast<unsigned>(id + 1));
+        if (pick < 5)
+        {
+            const auto side = random() % 2 == 0 ? Side::Buy : Side::Sell;
+            const auto price = 35 + static_cast<int>(random() % 11);
+            commands.push_back(BatchCommand { BatchOp::Add, side, ++id, price, 1 + static_cast<int>(random() % 20) });
+        }
+        else if (pick < 8)
+        {
+            commands.push_back(BatchCommand { BatchOp::Cancel, Side::Buy, someId, 0, 0 });
+        }
+        else if (pick < 9)
+        {
+            commands.push_back(BatchCommand { BatchOp::Amend, Side::Buy, someId, 0, static_cast<int>(random() % 25) });
+        }
+        else
+        {
+            commands.push_back(BatchCommand { BatchOp::Add, Side::Sell, someId, 40, 5 });
+        }
+    }
+
+    TypeParam single(0.5);
+    L2Book singleL2;
+    single.setListener(&L2Book::onEvent, &singleL2);
+    fillForLookAhead(single);
+    std::vector<BatchResult> expected;
+    std::vector<Fill> expectedFills;
+    FillBuffer fills(1000);
+    for (const auto& command: commands)
+    {
+        auto reason = Reject::None;
+        fills.clear();
+        switch (command.op)
+        {
+            case BatchOp::Add:
+                reason = single.tryAdd(LimitOrder { command.id, command.side, command.price, command.quantity, 0 },
+                    &FillBuffer::collect, &fills);
+                break;
+
+            case BatchOp::Cancel:
+                reason = single.tryCancel(command.id);
+                break;
+
+            case BatchOp::Amend:
+                reason = single.tryAmend(command.id, command.quantity);
+                break;
+        }
+        expected.push_back(BatchResult { reason, static_cast<std::uint32_t>(fills.size()) });
+        expectedFills.insert(expectedFills.end(), fills.begin(), fills.end());
+    }
+
+    // in batches of 100, as a feed would deliver them
+    TypeParam batched(0.5);
+    L2Book batchedL2;
+    batched.setListener(&L2Book::onEvent, &batchedL2);
+    fillForLookAhead(batched);
+    std::vector<BatchResult> results(commands.size());
+    std::size_t rejected = 0;
+    std::size_t fillIndex = 0;
+    for (std::size_t first = 0; first < commands.size(); first += 100)
+    {
+        rejected += batched.apply(commands.data() + first, 100, results.data() + first, fills);
+        for (std::size_t i = first; i < first + 100; ++i)
+        {
+            ASSERT_EQ(expected[i].reason, results[i].reason) << i;
+            ASSERT_EQ(expected[i].fills, results[i].fills) << i;
+        }
+        ASSERT_EQ(0u, fills.dropped());
+        for (const auto& fill: fills)
+        {
+            const auto& other = expectedFills[fillIndex++];
+            ASSERT_EQ(other.makerId, fill.makerId);
+            ASSERT_EQ(other.takerId, fill.takerId);
+            ASSERT_EQ(other.filledPrice, fill.filledPrice);
+            ASSERT_EQ(other.filledQty, fill.filledQty);
+        }
+
+        // the levels are up to date at the end of every batch
+        DepthSnapshot fromEvents;
+        batchedL2.top(100, fromEvents);
+        DepthSnapshot fromBook;
+        batched.depth(100, fromBook);
+        ASSERT_EQ(fromBook.bids.size(), fromEvents.bids.size());
+        ASSERT_EQ(fromBook.asks.size(), fromEvents.asks.size());
+    }
+    ASSERT_EQ(expectedFills.size(), fillIndex);
+    ASSERT_GT(rejected, 0u);
+    ASSERT_EQ(describeBook(single, 1, id), describeBook(batched, 1, id));
+    ASSERT_EQ(0u, batchedL2.gaps());
+    // fewer events for the same book
+    ASSERT_LT(batchedL2.lastSequence(), singleL2.lastSequence());
+
+    DepthSnapshot singleTop;
+    singleL2.top(100, singleTop);
+    DepthSnapshot batchedTop;
+    batchedL2.top(100, batchedTop);
+    ASSERT_EQ(singleTop.bids.size(), batchedTop.bids.size());
+    for (std::size_t i = 0; i < singleTop.bids.size(); ++i)
+    {
+        ASSERT_EQ(singleTop.bids[i].price, batchedTop.bids[i].price);
+        ASSERT_EQ(singleTop.bids[i].quantity, batchedTop.bids[i].quantity);
+        ASSERT_EQ(singleTop.bids[i].orders, batchedTop.bids[i].orders);
+    }
+    ASSERT_EQ(singleTop.asks.size(), batchedTop.asks.size());
+    for (std::size_t i = 0; i < singleTop.asks.size(); ++i)
+    {
+        ASSERT_EQ(singleTop.asks[i].price, batchedTop.asks[i].price);
+        ASSERT_EQ(singleTop.asks[i].quantity, batchedTop.asks[i].quantity);
+        ASSERT_EQ(singleTop.asks[i].orders, batchedTop.asks[i].orders);
+    }
+}
+
+TYPED_TEST(OrderBookTest, batch_sees_what_earlier_commands_did)
+{
+    // each id is looked up a few commands before it's used, by which time the order may be filled, cancelled,
+    // or in the book only since
+    const std::vector<BatchCommand> commands {
+        { BatchOp::Add, Side::Buy, 10, 40, 5 },
+        { BatchOp::Cancel, Side::Buy, 2, 0, 0 },
+        { BatchOp::Add, Side::Buy, 11, 35, 5 },
+        { BatchOp::Cancel, Side::Sell, 1, 0, 0 },
+        { BatchOp::Cancel, Side::Buy, 2, 0, 0 },
+        { BatchOp::Amend, Side::Buy, 2, 0, 9 },
+        { BatchOp::Amend, Side::Buy, 11, 0, 7 },
+        { BatchOp::Cancel, Side::Buy, 11, 0, 0 },
+        { BatchOp::Amend, Side::Buy, 3, 0, 3 },
+    };
+    // in a book small enough not to look ahead, and in one which does
+    for (const auto lookAhead: { false, true })
+    {
+        TypeParam book(0.5);
+        if (lookAhead)
+        {
+            fillForLookAhead(book);
+        }
+        book.add(LimitOrder { 1, Side::Sell, 40, 5, 0 });
+        book.add(LimitOrder { 2, Side::Buy, 30, 5, 0 });
+        book.add(LimitOrder { 3, Side::Buy, 30, 5, 0 });
+
+        std::vector<BatchResult> results(commands.size());
+        FillBuffer fills(10);
+        ASSERT_EQ(3u, book.apply(commands.data(), commands.size(), results.data(), fills));
+        ASSERT_EQ(Reject::None, results[0].reason);
+        ASSERT_EQ(1u, results[0].fills);
+        ASSERT_EQ(Reject::None, results[1].reason);
+        ASSERT_EQ(Reject::None, results[2].reason);
+        ASSERT_EQ(Reject::AlreadyFilled, results[3].reason);
+        ASSERT_EQ(Reject::AlreadyCancelled, results[4].reason);
+        ASSERT_EQ(Reject::AlreadyCancelled, results[5].reason);
+        ASSERT_EQ(Reject::None, results[6].reason);
+        ASSERT_EQ(Reject::None, results[7].reason);
+        ASSERT_EQ(Reject::None, results[8].reason);
+        ASSERT_EQ(3, book.query(3).order->quantity);
+        ASSERT_EQ(-1, book.query(11).position);
+        ASSERT_EQ(30, book.priceAt(Side::Buy, 0));
+        ASSERT_EQ(3, book.sizeAt(Side::Buy, 0));
+    }
+}
+
+TYPED_TEST(OrderBookTest, mass_cancel)
+{
+    TypeParam book(0.5);
+    L2Book l2;
+    book.setListener(&L2Book::onEvent, &l2);
+    // three orders on each of the bids 36 to 40 and the asks 42 to 46, the middle one of owner 2, the others of 1
+    std::vector<LimitOrder> resting;
+    int id = 0;
+    for (int level = 0; level < 5; ++level)
+    {
+        for (int i = 0; i < 3; ++i)
+        {
+            for (const auto side: { Side::Buy, Side::Sell })
+            {
+                ++id;
+                resting.push_back(LimitOrder { id, side, side == Side::Buy ? 40 - level : 42 + level, 10, 0, false,
+                    i == 1 ? 2 : 1 });
+                book.add(resting.back());
+            }
+        }
+    }
+    const auto isCancelled = [&book](const int id) { return book.query(id).order->isCancelled; };
+    const auto levels = [&book](const Side side)
+    {
+        DepthSnapshot snapshot;
+        book.depth(10, snapshot);
+        return (side == Side::Buy ? snapshot.bids : snapshot.asks).size();
+    };
+
+    // the bids at 37 and below, the asks at 45 and above
+    ASSERT_EQ(6, book.cancelAll(MassCancel { CancelScope::Beyond, Side::Buy, 37, 0 }));
+    ASSERT_EQ(3u, levels(Side::Buy));
+    ASSERT_EQ(38, book.priceAt(Side::Buy, 2));
+    ASSERT_EQ(6, book.cancelAll(MassCancel { CancelScope::Beyond, Side::Sell, 45, 0 }));
+    ASSERT_EQ(44, book.priceAt(Side::Sell, 2));
+    for (const auto& order: resting)
+    {
+        ASSERT_EQ(order.side == Side::Buy ? order.price <= 37 : order.price >= 45, isCancelled(order.id)) << order.id;
+    }
+
+    // the orders of owner 2, a third of what's left, then the ids 1 to 10 of the rest
+    ASSERT_EQ(6, book.cancelAll(MassCancel { CancelScope::Owner, Side::Buy, 2, 0 }));
+    ASSERT_EQ(6, book.cancelAll(MassCancel { CancelScope::Ids, Side::Buy, 1, 10 }));
+    ASSERT_EQ(0, book.cancelAll(MassCancel { CancelScope::Ids, Side::Buy, 1, 10 }));
+    ASSERT_TRUE(isCancelled(9));
+    ASSERT_FALSE(isCancelled(11));
+    // more ids than orders, walks the book
+    ASSERT_EQ(2, book.cancelAll(MassCancel { CancelScope::Ids, Side::Buy, 17, INT_MAX }));
+    ASSERT_EQ(2, book.cancelAll(MassCancel { CancelScope::Side, Side::Sell, 0, 0 }));
+    ASSERT_EQ(0u, levels(Side::Sell));
+    ASSERT_EQ(2, book.cancelAll(MassCancel { CancelScope::Side, Side::Buy, 0, 0 }));
+    ASSERT_EQ(0u, levels(Side::Buy));
+    for (const auto& order: resting)
+    {
+        ASSERT_TRUE(isCancelled(order.id)) << order.id;
+    }
+
+    // what the events say agrees
+    DepthSnapshot top;
+    l2.top(10, top);
+    ASSERT_TRUE(top.bids.empty());
+    ASSERT_TRUE(top.asks.empty());
+    ASSERT_EQ(0u, l2.gaps());
+
+    int cancelled = 0;
+    ASSERT_EQ(Reject::BadSide, book.tryCancelAll(MassCancel { CancelScope::Side, static_cast<Side>('X'), 0, 0 }, cancelled));
+    ASSERT_EQ(Reject::BadPrice, book.tryCancelAll(MassCancel { CancelScope::Beyond, Side::Buy, 0, 0 }, cancelled));
+    ASSERT_EQ(Reject::BadScope, book.tryCancelAll(MassCancel { static_cast<CancelScope>(9), Side::Buy, 0, 0 }, cancelled));
+    ASSERT_THROW(book.cancelAll(MassCancel { CancelScope::Beyond, Side::Buy, -1, 0 }), TradingError);
+}
+
+TYPED_TEST(OrderBookTest, memory_usage_by_structure)
+{
+    TypeParam book(0.1);
+    const auto empty = book.memoryUsage();
+    ASSERT_EQ(0u, empty.restingOrders);
+    ASSERT_EQ(empty.orders + empty.index + empty.levels + empty.terminal + empty.other, empty.total());
+
+    int id = 0;
+    for (int i = 0; i < 10000; ++i)
+    {
+        book.add(LimitOrder { ++id, Side::Buy, 100 + i % 50, 10, 0 });
+    }
+    for (int cancelled = 1; cancelled <= 100; ++cancelled)
+    {
+        book.cancel(cancelled);
+    }
+
+    const auto usage = book.memoryUsage();
+    ASSERT_EQ(9900u, usage.restingOrders);
+    ASSERT_EQ(100u, usage.terminalOrders);
+    ASSERT_LE(10000 * sizeof(OrderNode), usage.orders);
+    ASSERT_LE(9900 * (sizeof(int) + sizeof(OrderHandle)), usage.index);
+    ASSERT_LE(empty.levels, usage.levels);
+    ASSERT_LT(empty.terminal, usage.terminal);
+    ASSERT_EQ(usage.orders + usage.index + usage.levels + usage.terminal + usage.other, usage.total());
+
+    // 200 orders a level is deep enough for rank indexes, which the levels account for
+    for (int level = 0; level < 50; ++level)
+    {
+        book.query(id - level);
+    }
+    if (std::is_same<TypeParam, PlainOrderBook>::value || std::is_same<TypeParam, PlainLadderOrderBook>::value)
+    {
+        ASSERT_EQ(usage.levels, book.memoryUsage().levels);
+    }
+    else
+    {
+        ASSERT_LT(usage.levels, book.memoryUsage().levels);
+    }
+
+    std::ostringstream out;
+    usage.report(out);
+    ASSERT_NE(std::string::npos, out.str().find("9900 resting orders, 100 cancelled or filled kept"));
+}
+
+TEST(OrderBookTest, memory_flat_under_churn_by_default)
+{
+    OrderBook book(0.05);
+    int id = 0;
+    const auto churn = [&book, &id](const std::size_t count)
+    {
+        for (std::size_t i = 0; i < count; ++i)
+        {
+            ++id;
+            book.add(LimitOrder { id, Side::Buy, 100 + id % 10, 10, 0 });
+            book.cancel(id);
+        }
+    };
+
+    churn(DEFAULT_KEPT_ORDERS + 1000);
+    const auto usage = book.memoryUsage();
+    ASSERT_EQ(DEFAULT_KEPT_ORDERS, usage.terminalOrders);
+    churn(DEFAULT_KEPT_ORDERS);
+    const auto after = book.memoryUsage();
+    ASSERT_EQ(DEFAULT_KEPT_ORDERS, after.terminalOrders);
+    // only the filter of forgotten ids grows, by a bit an id and a page at a time
+    ASSERT_LE(after.terminal, usage.terminal + DEFAULT_KEPT_ORDERS / 8 + 4096);
+    ASSERT_EQ(usage.orders, after.orders);
+    ASSERT_EQ(usage.index, after.index);
+    ASSERT_EQ(Reject::OrderForgotten, book.tryCancel(1));
+    ASSERT_EQ(Reject::IdReused, book.tryAdd(LimitOrder { 1, Side::Buy, 100, 10, 0 }, nullptr, nullptr));
+}
+
+TEST(TerminalStoreTest, drops_by_age_and_filters_ids)
+{
+    RetentionConfig retention;
+    retention.maxAge = std::chrono::milliseconds(20);
+    retention.filterEvicted = false;
+    TerminalStore store(retention);
+
+    store.add(LimitOrder { 1, Side::Buy, 10, 5, 5 });
+    std::this_thread::sleep_for(std::chrono::milliseconds(40));
+    store.add(LimitOrder { 2, Side::Sell, 10, 5, 2, true });
+    ASSERT_EQ(1, store.size());
+    ASSERT_EQ(nullptr, store.find(1));
+    ASSERT_FALSE(store.evicted(1));
+    ASSERT_TRUE(store.find(2)->cancelled);
+    ASSERT_EQ(2, store.find(2)->filledQty);
+
+    IdFilter filter;
+    filter.insert(7);
+    filter.insert(1 << 20);
+    filter.insert(-3);
+    ASSERT_TRUE(filter.contains(7));
+    ASSERT_TRUE(filter.contains(1 << 20));
+    ASSERT_TRUE(filter.contains(-3));
+    ASSERT_FALSE(filter.contains(8));
+    ASSERT_FALSE(filter.contains((1 << 20) + 1));
+}
+
+TEST(TerminalStoreTest, one_lookup_for_records_and_dropped_ids)
+{
+    RetentionConfig retention;
+    retention.maxOrders = 2;
+    TerminalStore store(retention);
+    store.reserve(3);
+    for (int id = 1; id <= 3; ++id)
+    {
+        store.add(LimitOrder { id, Side::Buy, 10, 5, 5 });
+    }
+
+    bool evicted = true;
+    ASSERT_EQ(3, store.find(3, evicted)->id);
+    ASSERT_FALSE(evicted);
+    ASSERT_EQ(nullptr, store.find(1, evicted));
+    ASSERT_TRUE(evicted);
+    ASSERT_EQ(nullptr, store.find(4, evicted));
+    ASSERT_FALSE(evicted);
+}
+
+template <typename Index>
+class IdIndexTest: public ::testing::Test
+{
+};
+
+using IdIndexTypes = ::testing::Types<FlatIdIndex, RingIdIndex>;
+TYPED_TEST_SUITE(IdIndexTest, IdIndexTypes);
+
+TYPED_TEST(IdIndexTest, agrees_with_a_map)
+{
+    TypeParam index;
+    std::map<int, OrderHandle> expected;
+    std::mt19937 random(7);
+    // mostly a sliding window of sequential ids with some left behind, plus stray ones far away
+    int nextId = 1;
+    for (int i = 0; i < 100000; ++i)
+    {
+        const auto roll = random() % 10;
+        if (roll < 5)
+        {
+            const auto id = roll == 0 ? static_cast<int>(random()) : nextId++;
+            const auto handle = static_cast<OrderHandle>(i);
+            ASSERT_EQ(expected.emplace(id, handle).second, index.insert(id, handle));
+        }
+        else if (!expected.empty())
+        {
+            auto iOrder = expected.lower_bound(nextId - static_cast<int>(random() % 3000));
+            if (iOrder == expected.end())
+            {
+                iOrder = expected.begin();
+            }
+            if (roll < 9)
+            {
+                index.erase(iOrder->first);
+                expected.erase(iOrder);
+            }
+            else
+            {
+                ASSERT_EQ(iOrder->second, index.find(iOrder->first));
+                ASSERT_EQ(NO_ORDER, index.find(nextId));
+            }
+        }
+    }
+    ASSERT_EQ(expected.size(), index.size());
+    for (const auto& entry: expected)
+    {
+        ASSERT_EQ(entry.second, index.find(entry.first));
+    }
+
+    // the id a flat table marks its free slots with is an id like any other
+    ASSERT_TRUE(index.insert(INT_MIN, 1));
+    ASSERT_FALSE(index.insert(INT_MIN, 2));
+    ASSERT_EQ(1u, index.find(INT_MIN));
+    index.erase(INT_MIN);
+    ASSERT_EQ(NO_ORDER, index.find(INT_MIN));
+    ASSERT_EQ(expected.size(), index.size());
+}
+
+TEST(LadderBookSideTest, next_levels_across_window_moves)
+{
+    LadderBookSide<PriceLevel> side(64);
+    ASSERT_TRUE(side.empty());
+
+    side.level(1000);
+    side.level(1010);
+    // far outside of the initial window, so it has to grow
+    side.level(1200);
+    // below everything, recenters again
+    side.level(900);
+    ASSERT_EQ(4, side.depth());
+    ASSERT_LE(301, side.capacity());
+    ASSERT_EQ(900, side.lowest());
+    ASSERT_EQ(1200, side.highest());
+
+    int ticks = side.lowest();
+    ASSERT_TRUE(side.nextAbove(ticks));
+    ASSERT_EQ(1000, ticks);
+    ASSERT_TRUE(side.nextAbove(ticks));
+    ASSERT_EQ(1010, ticks);
+    ASSERT_TRUE(side.nextAbove(ticks));
+    ASSERT_EQ(1200, ticks);
+    ASSERT_FALSE(side.nextAbove(ticks));
+    ASSERT_TRUE(side.nextBelow(ticks));
+    ASSERT_EQ(1010, ticks);
+
+    side.erase(900);
+    side.erase(1200);
+    ASSERT_EQ(1000, side.lowest());
+    ASSERT_EQ(1010, side.highest());
+    ASSERT_EQ(nullptr, side.find(1200));
+    ASSERT_NE(nullptr, side.find(1010));
+}
+
+TEST(LadderBookSideTest, levels_survive_relocation)
+{
+    LadderOrderBook book(1);
+    book.add(buy(100, 7));
+    book.add(sell(110, 3));
+    // moves the window a few times while orders are resting
+    book.add(buy(5, 1));
+    book.add(sell(5000, 2));
+
+    ASSERT_EQ(100, book.priceAt(Side::Buy, 0));
+    ASSERT_EQ(7, book.sizeAt(Side::Buy, 0));
+    ASSERT_EQ(5, book.priceAt(Side::Buy, 1));
+    ASSERT_EQ(110, book.priceAt(Side::Sell, 0));
+    ASSERT_EQ(5000, book.priceAt(Side::Sell, 1));
+}
+
+TEST(LadderBookSideTest, far_prices_rejected_without_growing)
+{
+    LadderOrderBook book(1);
+    const auto near = buy(1230, 100);
+    book.add(near);
+    const auto far = buy(1230 + MAX_LADDER_CAPACITY, 100);
+    ASSERT_EQ(Reject::PriceOutOfRange, book.tryAdd(far, [](void*, const Fill&) {}, nullptr));
+    ASSERT_EQ(1u, book.rejections(Reject::PriceOutOfRange));
+    ASSERT_THROW(book.add(buy(INT_MAX, 100)), TradingError);
+    // the widest window still takes the last tick that fits
+    const auto edge = buy(1230 + MAX_LADDER_CAPACITY - 1, 100);
+    book.add(edge);
+    ASSERT_EQ(edge.price, book.priceAt(Side::Buy, 0));
+    ASSERT_EQ(1230, book.priceAt(Side::Buy, 1));
+    ASSERT_GE(std::size_t(MAX_LADDER_CAPACITY) * sizeof(RankedPriceLevel) + (1 << 20), book.memoryUsage().levels);
+
+    // each side has a window of its own
+    book.add(sell(INT_MAX, 1));
+    ASSERT_EQ(INT_MAX, book.priceAt(Side::Sell, 0));
+    // and once a side is empty, it starts again wherever the next order is
+    book.cancel(near.id);
+    book.cancel(edge.id);
+    book.add(buy(INT_MAX - 1, 1));
+    ASSERT_EQ(INT_MAX - 1, book.priceAt(Side::Buy, 0));
+}
+
+TEST(LadderBookSideTest, capacity_is_bounded)
+{
+    ASSERT_THROW(LadderBookSide<PriceLevel>(0), TradingError);
+    ASSERT_THROW(LadderBookSide<PriceLevel>(MAX_LADDER_CAPACITY + 1), TradingError);
+    ASSERT_EQ(MAX_LADDER_CAPACITY, LadderBookSide<PriceLevel>(MAX_LADDER_CAPACITY).capacity());
+}
 
 TEST(CommandProcessorTest, process_standard_commands)
 {
 	OrderBook book(0.05);
-	CommandProcessor processor(book, std::cout);
+	OutputSink out(std::cout);
+	CommandProcessor processor(book, out);
 
 	processor.handle("order 1001 buy 100 12.30");
 	processor.handle("q order 1001");
 	processor.handle("q level bid 0");
-	ASSERT_THROW(processor.handle("q level ask 0"), TradingError);
+	// the book's rejections are counted, not thrown
+	ASSERT_EQ(ParseResult::Ok, processor.handle("q level ask 0"));
+	ASSERT_EQ(1u, book.rejections(Reject::NoSuchLevel));
+	// so is a depth of fewer than no levels, while a very deep one is only as deep as the book
+	ASSERT_EQ(ParseResult::Ok, processor.handle("q depth -1"));
+	ASSERT_EQ(1u, book.rejections(Reject::BadLevelCount));
+	ASSERT_EQ(ParseResult::Ok, processor.handle("q depth 1000000000"));
+}
+
+TEST(CommandProcessorTest, rejections_logged_at_a_limited_rate)
+{
+	std::ostringstream log;
+	{
+		OrderBook book(0.05);
+		std::ostringstream answers;
+		OutputSink out(answers);
+		CommandProcessor processor(book, out);
+		RejectLog rejectLog(log, 3);
+		processor.setRejectLog(&rejectLog);
+
+		processor.handle("order 1 buy 10 12.30");
+		processor.handle("order 1 buy 10 12.30");
+		for (int id = 2; id < 11; ++id)
+		{
+			processor.handle("cancel " + std::to_string(id));
+		}
+		ASSERT_EQ(9u, book.rejections(Reject::UnknownOrder));
+	}
+	ASSERT_EQ("Rejected order 1: already exists\n"
+		"Rejected cancel 2: doesn't exist\n"
+		"Rejected cancel 3: doesn't exist\n"
+		"7 more rejections not logged\n", log.str());
+}
+
+TEST(CommandProcessorTest, off_tick_prices_rejected_like_the_rest)
+{
+	std::ostringstream log;
+	{
+		OrderBook book(0.05);
+		std::ostringstream answers;
+		OutputSink out(answers);
+		CommandProcessor processor(book, out);
+		RejectLog rejectLog(log);
+		processor.setRejectLog(&rejectLog);
+
+		ASSERT_EQ(ParseResult::Ok, processor.handle("order 1 buy 10 12.31"));
+		ASSERT_EQ(ParseResult::Ok, processor.handle("order 2 buy 10 999999999999"));
+		ASSERT_EQ(ParseResult::Ok, processor.handle("cancel beyond sell 12.32"));
+		ASSERT_EQ(3u, book.rejections(Reject::OffTick));
+		// nothing got to the book, so the id is still free
+		ASSERT_EQ(ParseResult::Ok, processor.handle("order 1 buy 10 12.30"));
+		ASSERT_EQ(Reject::None, book.tryCancel(1));
+	}
+	ASSERT_EQ("Rejected order 1: price is not a whole number of ticks\n"
+		"Rejected order 2: price is not a whole number of ticks\n"
+		"Rejected mass cancel 0: price is not a whole number of ticks\n", log.str());
 }
@@ -0,0 +1,96 @@
+#include <sstream>
+#include <string>
+#include <gtest/gtest.h>
+
+#include "OutputSink.hxx"
+
+using namespace trading;
+
+TEST(OutputSinkTest, numbers_as_ostream)
+{
+    const double prices[] = { 12.3, 12.15, 12.0, 0.05, 0.0, 9999.95, 5000.0, 0.1 + 0.2 };
+    for (const auto price: prices)
+    {
+        std::ostringstream expected;
+        expected << price;
+
+        std::ostringstream actual;
+        {
+            OutputSink out(actual);
+            out << price;
+        }
+        ASSERT_EQ(expected.str(), actual.str()) << price;
+    }
+
+    std::ostringstream actual;
+    {
+        OutputSink out(actual);
+        out << 0 << ' ' << -42 << ' ' << 2147483647 << ' ' << 12.5 << ' ' << "text";
+    }
+    ASSERT_EQ("0 -42 2147483647 12.5 text", actual.str());
+
+    // exact to six decimals, where ostream would round to six digits
+    std::ostringstream exact;
+    {
+        OutputSink out(exact);
+        out << 99999.95 << ' ' << 1234567.8;
+    }
+    ASSERT_EQ("99999.95 1234567.8", exact.str());
+
+    std::ostringstream fixed;
+    {
+        OutputSink out(fixed);
+        out << FixedPoint { 1230, 2 } << ' ' << FixedPoint { 1215, 2 } << ' ' << FixedPoint { 5, 2 } << ' '
+            << FixedPoint { -7, 0 } << ' ' << FixedPoint { -150, 3 };
+    }
+    ASSERT_EQ("12.3 12.15 0.05 -7 -0.15", fixed.str());
+}
+
+TEST(OutputSinkTest, flushes_on_size)
+{
+    std::ostringstream actual;
+    OutputSink out(actual, 16);
+
+    out << "short";
+    out.endLine();
+    ASSERT_EQ("", actual.str());
+    ASSERT_EQ(6u, out.pending());
+
+    out << "long enough now";
+    out.endLine();
+    ASSERT_EQ("short\nlong enough now\n", actual.str());
+    ASSERT_EQ(0u, out.pending());
+
+    // a line longer than the buffer still comes out whole
+    const std::string line(20000, 'x');
+    out << line;
+    out.endLine();
+    out.flush();
+    ASSERT_EQ("short\nlong enough now\n" + line + "\n", actual.str());
+}
+
+TEST(OutputSinkTest, flushes_on_delay_and_request)
+{
+    std::ostringstream actual;
+    {
+        OutputSink out(actual);
+        out << "held";
+        out.endLine();
+        ASSERT_EQ("", actual.str());
+        out.flush();
+        ASSERT_EQ("held\n", actual.str());
+
+        out << "at exit";
+        out.endLine();
+    }
+    ASSERT_EQ("held\nat exit\n", actual.str());
+
+    std::ostringstream delayed;
+    OutputSink out(delayed, 1 << 20, std::chrono::microseconds(1));
+    out << "first";
+    const auto start = std::chrono::steady_clock::now();
+    while (std::chrono::steady_clock::now() - start < std::chrono::microseconds(10))
+    {}
+    out.endLine();
+    ASSERT_EQ("first\n", delayed.str());
+}
@@ -0,0 +1,110 @@
+#include <sstream>
+#include <string>
+#include <thread>
+#include <gtest/gtest.h>
+
+#include "Common.hxx"
+#include "OrderBook.hxx"
+#include "CommandProcessor.hxx"
+#include "Pipeline.hxx"
+#include "Channel.hxx"
+#include "RejectLog.hxx"
+#include "Session.hxx"
+
+using namespace trading;
+
+namespace
+{
+    std::string sessionText()
+    {
+        std::string text;
+        for (const auto& line: SESSION)
+        {
+            text += line + "\n";
+        }
+        // a few the parser rejects
+        return text + "order 1012 buy\nhello\nq level bid x\n";
+    }
+}
+
+TEST(ChannelTest, keeps_order_with_every_strategy)
+{
+    for (const auto strategy: { WaitStrategy::Spin, WaitStrategy::Yield, WaitStrategy::Block })
+    {
+        // spinning on a single core waits out whole time slices, so that one gets room to run ahead
+        Channel<int> channel(strategy == WaitStrategy::Spin ? 4096 : 16, strategy);
+        const int count = 20000;
+        std::thread producer([&channel] {
+            for (int i = 0; i < count; ++i)
+            {
+                channel.push(i);
+            }
+        });
+
+        int value;
+        for (int i = 0; i < count; ++i)
+        {
+            channel.pop(value);
+            ASSERT_EQ(i, value);
+        }
+        producer.join();
+        ASSERT_FALSE(channel.tryPop(value));
+    }
+}
+
+TEST(PipelineTest, same_output_as_command_processor)
+{
+    std::ostringstream expected;
+    {
+        OrderBook book(0.05);
+        OutputSink out(expected);
+        CommandProcessor processor(book, out);
+        for (const auto& line: SESSION)
+        {
+            try
+            {
+                processor.handle(line);
+            }
+            catch (const TradingError&)
+            {}
+        }
+    }
+
+    for (const auto strategy: { WaitStrategy::Spin, WaitStrategy::Yield, WaitStrategy::Block })
+    {
+        OrderBook book(0.05);
+        std::ostringstream actual;
+        OutputSink out(actual);
+        PipelineConfig config;
+        // small, so that the stages have to wait on each other
+        config.ringCapacity = 2;
+        config.wait = strategy;
+        Pipeline pipeline(book, out, config);
+
+        std::istringstream in(sessionText());
+        pipeline.run(in);
+        ASSERT_EQ(expected.str(), actual.str());
+    }
+}
+
+TEST(PipelineTest, rejections_counted_and_logged)
+{
+    std::ostringstream log;
+    OrderBook book(0.05);
+    std::ostringstream answers;
+    OutputSink out(answers);
+    {
+        RejectLog rejectLog(log);
+        Pipeline pipeline(book, out, PipelineConfig {});
+        pipeline.setRejectLog(&rejectLog);
+        std::istringstream in("order 1 buy 10 12.31\norder 1 buy 10 12.30\ncancel 7\nq depth -1\nq level bid 0\n");
+        pipeline.run(in);
+    }
+    ASSERT_EQ(1u, book.rejections(Reject::OffTick));
+    ASSERT_EQ(1u, book.rejections(Reject::UnknownOrder));
+    ASSERT_EQ(1u, book.rejections(Reject::BadLevelCount));
+    ASSERT_EQ("bid, 0, 12.3, 10\n", answers.str());
+    ASSERT_EQ("Rejected order 1: price is not a whole number of ticks\n"
+        "Rejected cancel 7: doesn't exist\n"
+        "Rejected depth query -1: level count must be non-negative\n", log.str());
+}
@@ -0,0 +1,168 @@
+#include <chrono>
+#include <csignal>
+#include <cstdio>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <gtest/gtest.h>
+
+#include "Common.hxx"
+#include "OrderBook.hxx"
+#include "Snapshot.hxx"
+#include "RejectLog.hxx"
+#include "SharedOutput.hxx"
+#include "BookState.hxx"
+
+using namespace trading;
+
+namespace
+{
+    std::string snapshotPath(const char* name)
+    {
+        const auto path = ::testing::TempDir() + name;
+        std::remove(path.c_str());
+        return path;
+    }
+
+    // prices are in ticks
+    template <typename Book>
+    void buildBook(Book& book)
+    {
+        int id = 0;
+        for (int level = 0; level < 5; ++level)
+        {
+            for (int i = 0; i < 3; ++i)
+            {
+                book.add(LimitOrder { ++id, Side::Buy, 100 - level, 10 + i, 0 });
+                book.add(LimitOrder { ++id, Side::Sell, 110 + level * 7, 10 + i, 0 });
+            }
+        }
+        // a partial fill, a full fill, cancels and an amend up, which moves to the back
+        book.add(LimitOrder { ++id, Side::Sell, 100, 15, 0 });
+        book.cancel(3);
+        book.cancel(8);
+        book.amend(9, 30);
+        book.add(LimitOrder { ++id, Side::Buy, 110, 10, 0 });
+    }
+}
+
+template <typename Book>
+class SnapshotTest: public ::testing::Test
+{};
+
+using BookTypes = ::testing::Types<OrderBook, LadderOrderBook, PlainOrderBook, PlainLadderOrderBook,
+    SequentialIdOrderBook>;
+TYPED_TEST_SUITE(SnapshotTest, BookTypes);
+
+TYPED_TEST(SnapshotTest, restores_queue_positions_and_terminal_orders)
+{
+    const auto path = snapshotPath("restores_queue_positions.snapshot");
+    RetentionConfig retention;
+    // so that some ids are only in the filter
+    retention.maxOrders = 3;
+    TypeParam book(0.05, retention);
+    buildBook(book);
+    saveSnapshot(book, path, 1234);
+
+    // into either kind of book
+    OrderBook restored(0.05, retention);
+    ASSERT_EQ(1234, loadSnapshot(path, restored));
+    LadderOrderBook ladder(0.05, retention);
+    loadSnapshot(path, ladder);
+    const auto expected = describeBook(book, 1, 32);
+    ASSERT_EQ(expected, describeBook(restored, 1, 32));
+    ASSERT_EQ(expected, describeBook(ladder, 1, 32));
+    ASSERT_EQ(2, restored.query(9).position);
+
+    // ended orders and dropped ids still can't come back
+    ASSERT_THROW(restored.add(LimitOrder { 1, Side::Buy, 90, 10, 0 }), TradingError);
+    ASSERT_THROW(restored.add(LimitOrder { 3, Side::Buy, 90, 10, 0 }), TradingError);
+
+    // and matching carries on the same
+    restored.add(LimitOrder { 100, Side::Sell, 99, 25, 0 });
+    book.add(LimitOrder { 100, Side::Sell, 99, 25, 0 });
+    ASSERT_EQ(describeBook(book, 1, 100), describeBook(restored, 1, 100));
+
+    ASSERT_THROW(loadSnapshot(path, restored), TradingError);
+    TypeParam other(0.01);
+    ASSERT_THROW(loadSnapshot(path, other), TradingError);
+}
+
+TYPED_TEST(SnapshotTest, background_snapshot_sees_the_book_at_the_fork)
+{
+    const auto path = snapshotPath("background_snapshot.snapshot");
+    TypeParam book(0.05);
+    buildBook(book);
+    const auto expected = describeBook(book, 1, 40);
+
+    BackgroundSnapshot background;
+    ASSERT_TRUE(background.start(book, path));
+    book.add(LimitOrder { 40, Side::Buy, 90, 10, 0 });
+    book.cancel(7);
+    ASSERT_TRUE(background.wait());
+
+    TypeParam restored(0.05);
+    loadSnapshot(path, restored);
+    ASSERT_EQ(expected, describeBook(restored, 1, 40));
+}
+
+TEST(BackgroundSnapshotTest, forks_while_the_reject_log_writes)
+{
+    // stderr shared with the log's thread, as order_book has it; a child forked while the thread holds the lock
+    // would wait for ever when it reports an error
+    std::ostringstream errors;
+    SharedOutput shared(errors);
+    const auto previous = std::cerr.rdbuf(&shared);
+    auto stuck = 0;
+    {
+        RejectLog log(std::cerr, 1 << 30);
+        OrderBook book(0.05);
+        buildBook(book);
+        for (int i = 0; i < 100 && stuck == 0; ++i)
+        {
+            for (int id = 0; id < 1000; ++id)
+            {
+                log.log(Rejection { Reject::UnknownOrder, CommandType::Cancel, id });
+            }
+            // let the thread get going on them
+            std::this_thread::sleep_for(std::chrono::microseconds(i * 100 % 3000));
+
+            pid_t pid = -1;
+            {
+                const auto paused = log.pause();
+                pid = ::fork();
+                if (pid == 0)
+                {
+                    try
+                    {
+                        // a directory that isn't there, so the child reports on stderr
+                        saveSnapshot(book, "/nonexistent/snapshot");
+                    }
+                    catch (const TradingError&)
+                    {}
+                    ::_exit(0);
+                }
+            }
+            ASSERT_LT(0, pid);
+
+            int status = 0;
+            const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+            while (::waitpid(pid, &status, WNOHANG) == 0)
+            {
+                if (std::chrono::steady_clock::now() > deadline)
+                {
+                    ::kill(pid, SIGKILL);
+                    ::waitpid(pid, &status, 0);
+                    ++stuck;
+                    break;
+                }
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            }
+        }
+    }
+    std::cerr.rdbuf(previous);
+    ASSERT_EQ(0, stuck);
+    ASSERT_NE(std::string::npos, errors.str().find("Rejected cancel 999: doesn't exist"));
+}
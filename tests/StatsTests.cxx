@@ -0,0 +1,88 @@
+#include <sstream>
+#include <string>
+#include <gtest/gtest.h>
+
+#include "Common.hxx"
+#include "CommandProcessor.hxx"
+#include "OrderBook.hxx"
+#include "OutputSink.hxx"
+#include "Stats.hxx"
+
+using namespace trading;
+
+TEST(StatsTest, histogram_percentiles)
+{
+    LatencyHistogram histogram;
+    ASSERT_EQ(0u, histogram.percentile(0.5));
+
+    for (std::uint64_t value = 1; value <= 1000; ++value)
+    {
+        histogram.record(value);
+    }
+    histogram.record(1000000);
+    ASSERT_EQ(1001u, histogram.count());
+    ASSERT_EQ(1000000u, histogram.max());
+
+    // within 1/16 above the exact value
+    const auto expectNear = [](const std::uint64_t exact, const std::uint64_t actual)
+    {
+        EXPECT_GE(actual, exact);
+        EXPECT_LE(actual, exact + exact / 16);
+    };
+    expectNear(501, histogram.percentile(0.5));
+    expectNear(991, histogram.percentile(0.99));
+    expectNear(1000, histogram.percentile(0.999));
+    ASSERT_EQ(1000000u, histogram.percentile(1.0));
+
+    // small values exactly
+    LatencyHistogram small;
+    small.record(3);
+    small.record(7);
+    ASSERT_EQ(3u, small.percentile(0.5));
+    ASSERT_EQ(7u, small.percentile(0.99));
+
+    LatencyHistogram huge;
+    huge.record(~std::uint64_t(0));
+    ASSERT_EQ(~std::uint64_t(0), huge.percentile(0.5));
+}
+
+TEST(StatsTest, commands_by_type_and_outcome)
+{
+    if (!STATS_ENABLED)
+    {
+        GTEST_SKIP() << "built without ORDER_BOOK_STATS";
+    }
+
+    OrderBook book(0.05);
+    std::ostringstream answers;
+    OutputSink out(answers);
+    CommandProcessor processor(book, out);
+    CommandStats stats;
+    processor.setStats(&stats);
+
+    processor.handle("order 1 sell 10 10.00");
+    processor.handle("order 2 sell 10 10.05");
+    processor.handle("order 3 sell 10 10.10");
+    // three levels, four fills with the one below
+    processor.handle("order 4 sell 5 10.10");
+    processor.handle("order 5 buy 33 10.10");
+    processor.handle("cancel 5");
+    processor.handle("cancel 4");
+    processor.handle("q order 1");
+    processor.handle("nonsense");
+
+    ASSERT_EQ(4u, stats.latency(CommandType::Order, Outcome::Passive).count());
+    ASSERT_EQ(1u, stats.latency(CommandType::Order, Outcome::Aggressive).count());
+    ASSERT_EQ(1u, stats.latency(CommandType::Cancel, Outcome::Rejected).count());
+    ASSERT_EQ(1u, stats.latency(CommandType::Cancel, Outcome::Passive).count());
+    ASSERT_EQ(1u, stats.latency(CommandType::QueryOrder, Outcome::Passive).count());
+
+    std::ostringstream report;
+    stats.report(report);
+    const auto text = report.str();
+    EXPECT_NE(std::string::npos, text.find("p99.9"));
+    EXPECT_NE(std::string::npos, text.find("order   aggressive"));
+    EXPECT_NE(std::string::npos, text.find("bad     line"));
+    EXPECT_NE(std::string::npos, text.find("fills 4 (0.80 per add, at most 4), levels swept 3 (0.60 per add, at most 3)"))
+        << text;
+}
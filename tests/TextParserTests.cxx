@@ -0,0 +1,177 @@
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <ext/stdio_filebuf.h>
+#include <unistd.h>
+#include <gtest/gtest.h>
+
+#include "TextParser.hxx"
+#include "LineReader.hxx"
+
+using namespace trading;
+
+TEST(TextParserTest, parse_commands)
+{
+    Command command;
+    ASSERT_EQ(ParseResult::Ok, parse("order 1001 buy 100 12.30", command));
+    ASSERT_EQ(CommandType::Order, command.type);
+    ASSERT_EQ(1001, command.id);
+    ASSERT_EQ(Side::Buy, command.side);
+    ASSERT_EQ(100, command.quantity);
+    ASSERT_EQ(12.3, command.price);
+
+    ASSERT_EQ(ParseResult::Ok, parse("  amend 1004\t600\r", command));
+    ASSERT_EQ(CommandType::Amend, command.type);
+    ASSERT_EQ(1004, command.id);
+    ASSERT_EQ(600, command.quantity);
+
+    ASSERT_EQ(ParseResult::Ok, parse("order 1002 sell 5 12.35 7", command));
+    ASSERT_EQ(7, command.owner);
+
+    ASSERT_EQ(ParseResult::Ok, parse("cancel 1003", command));
+    ASSERT_EQ(CommandType::Cancel, command.type);
+    ASSERT_EQ(1003, command.id);
+
+    ASSERT_EQ(ParseResult::Ok, parse("cancel all bid", command));
+    ASSERT_EQ(CommandType::MassCancel, command.type);
+    ASSERT_EQ(CancelScope::Side, command.scope);
+    ASSERT_EQ(Side::Buy, command.side);
+    ASSERT_EQ(ParseResult::Ok, parse("cancel beyond sell 12.50", command));
+    ASSERT_EQ(CancelScope::Beyond, command.scope);
+    ASSERT_EQ(Side::Sell, command.side);
+    ASSERT_EQ(12.5, command.price);
+    ASSERT_EQ(ParseResult::Ok, parse("cancel ids 1001 1010", command));
+    ASSERT_EQ(CancelScope::Ids, command.scope);
+    ASSERT_EQ(1001, command.id);
+    ASSERT_EQ(1010, command.quantity);
+    ASSERT_EQ(ParseResult::Ok, parse("cancel owner 7", command));
+    ASSERT_EQ(CancelScope::Owner, command.scope);
+    ASSERT_EQ(7, command.id);
+
+    ASSERT_EQ(ParseResult::Ok, parse("q level ask 2", command));
+    ASSERT_EQ(CommandType::QueryLevel, command.type);
+    ASSERT_EQ(Side::Sell, command.side);
+    ASSERT_STREQ("ask", command.sideName);
+    ASSERT_EQ(2, command.id);
+
+    ASSERT_EQ(ParseResult::Ok, parse("q order 2010", command));
+    ASSERT_EQ(CommandType::QueryOrder, command.type);
+    ASSERT_EQ(ParseResult::Ok, parse("q depth 10", command));
+    ASSERT_EQ(CommandType::QueryDepth, command.type);
+    ASSERT_EQ(10, command.id);
+}
+
+TEST(TextParserTest, parse_errors)
+{
+    Command command;
+    ASSERT_EQ(ParseResult::Empty, parse("", command));
+    ASSERT_EQ(ParseResult::Empty, parse(" \t", command));
+    ASSERT_EQ(ParseResult::UnknownCommand, parse("buy 1001", command));
+    ASSERT_EQ(ParseResult::UnknownCommand, parse("q everything", command));
+    ASSERT_EQ(ParseResult::MissingArgument, parse("q", command));
+    ASSERT_EQ(ParseResult::BadSide, parse("order 1001 short 100 12.30", command));
+    ASSERT_EQ(ParseResult::BadNumber, parse("order 1001 buy 1x0 12.30", command));
+    ASSERT_EQ(ParseResult::BadNumber, parse("order 1001 buy 100 12.3.0", command));
+    ASSERT_EQ(ParseResult::BadNumber, parse("order 99999999999 buy 100 12.30", command));
+    ASSERT_EQ(ParseResult::MissingArgument, parse("order 1001 buy 100", command));
+    ASSERT_EQ(ParseResult::MissingArgument, parse("cancel", command));
+    ASSERT_EQ(ParseResult::BadNumber, parse("order 1001 buy 100 12.30 me", command));
+    ASSERT_EQ(ParseResult::MissingArgument, parse("cancel ids 1001", command));
+    ASSERT_EQ(ParseResult::MissingArgument, parse("cancel all", command));
+    ASSERT_EQ(ParseResult::BadNumber, parse("cancel everything", command));
+}
+
+TEST(TextParserTest, prices_as_strtod)
+{
+    const char* prices[] = { "12.30", "12.0", "12", "0.05", "12.15", "-1", "0", "99999.95",
+        "1234567890.123456789", "0.1000000000000000000000001", "3." };
+    for (const auto price: prices)
+    {
+        double parsed;
+        ASSERT_TRUE(parsePrice(price, parsed)) << price;
+        ASSERT_EQ(std::strtod(price, nullptr), parsed) << price;
+    }
+
+    double parsed;
+    ASSERT_FALSE(parsePrice("", parsed));
+    ASSERT_FALSE(parsePrice(".", parsed));
+    ASSERT_FALSE(parsePrice("1e5", parsed));
+    ASSERT_FALSE(parsePrice("12,30", parsed));
+}
+
+TEST(LineReaderTest, lines_across_blocks)
+{
+    std::istringstream in("order 1 buy 1 1.0\n\nq order 1\r\na line longer than the block\nlast");
+    LineReader reader(in, 8);
+
+    std::string_view line;
+    ASSERT_TRUE(reader.next(line));
+    ASSERT_EQ("order 1 buy 1 1.0", line);
+    ASSERT_TRUE(reader.next(line));
+    ASSERT_EQ("", line);
+    ASSERT_TRUE(reader.next(line));
+    ASSERT_EQ("q order 1\r", line);
+    ASSERT_TRUE(reader.next(line));
+    ASSERT_EQ("a line longer than the block", line);
+    ASSERT_TRUE(reader.next(line));
+    ASSERT_EQ("last", line);
+    ASSERT_FALSE(reader.next(line));
+}
+
+TEST(LineReaderTest, end_of_batch)
+{
+    std::istringstream in("a\nb\nc\n");
+    LineReader reader(in, 4);
+
+    std::string_view line;
+    ASSERT_TRUE(reader.next(line));
+    ASSERT_EQ("a", line);
+    ASSERT_FALSE(reader.endOfBatch());
+    ASSERT_TRUE(reader.next(line));
+    ASSERT_EQ("b", line);
+    ASSERT_TRUE(reader.endOfBatch());
+    ASSERT_TRUE(reader.next(line));
+    ASSERT_EQ("c", line);
+    ASSERT_TRUE(reader.endOfBatch());
+    ASSERT_FALSE(reader.next(line));
+}
+
+TEST(LineReaderTest, lines_from_a_pipe_before_its_end)
+{
+    int fds[2];
+    ASSERT_EQ(0, pipe(fds));
+    std::atomic<bool> answered(false);
+    std::atomic<bool> closed(false);
+    // writes a line, then holds the pipe open until it's read or a few seconds passed
+    std::thread writer([&]
+    {
+        const std::string first = "q order 1\nq or";
+        static_cast<void>(write(fds[1], first.data(), first.size()));
+        const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+        while (!answered && std::chrono::steady_clock::now() < deadline)
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        const std::string rest = "der 2\n";
+        static_cast<void>(write(fds[1], rest.data(), rest.size()));
+        closed = true;
+        close(fds[1]);
+    });
+
+    __gnu_cxx::stdio_filebuf<char> buffer(fds[0], std::ios::in);
+    std::istream in(&buffer);
+    LineReader reader(in);
+    std::string_view line;
+    EXPECT_TRUE(reader.next(line));
+    EXPECT_EQ("q order 1", line);
+    EXPECT_FALSE(closed);
+    EXPECT_TRUE(reader.endOfBatch());
+    answered = true;
+    EXPECT_TRUE(reader.next(line));
+    EXPECT_EQ("q order 2", line);
+    EXPECT_FALSE(reader.next(line));
+    writer.join();
+}